@@ -0,0 +1,284 @@
+/**
+ * @file autoturn.c
+ * @author Keenan Alchaar (ka5nt@virginia.edu)
+ * @brief Detects the end of the human's turn from the stream of board readings, without buttons
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "autoturn.h"
+
+// Private functions
+static bool autoturn_get_candidate(uint64_t reading, uint64_t* p_intermediate);
+static bool autoturn_get_en_passant(uint64_t emptied, uint64_t filled, uint64_t* p_captured);
+static bool autoturn_is_half_castle(uint64_t emptied, uint64_t filled);
+static uint8_t autoturn_count_tiles(uint64_t tiles);
+static uint8_t autoturn_first_tile(uint64_t tiles);
+
+// The board at the start of the turn
+static uint64_t initial_presence = 0;
+static uint64_t initial_white    = 0;
+static uint64_t initial_black    = 0;
+static uint64_t initial_kings    = 0;
+
+// Turn tracking
+static uint64_t lifted                 = 0; // Initially occupied tiles seen empty since the start of the turn
+static uint64_t candidate              = 0; // Reading holding a single move
+static uint64_t candidate_intermediate = 0;
+static bool candidate_valid            = false;
+static uint32_t candidate_sequence     = 0; // Sequence number of the first reading of the candidate
+static uint32_t last_sequence          = 0;
+
+/**
+ * @brief Starts tracking a turn from the previous board
+ */
+void autoturn_start(void)
+{
+    uint64_t reading;
+    bool stable;
+
+    initial_white    = chessboard_get_previous_white_presence();
+    initial_black    = chessboard_get_previous_black_presence();
+    initial_presence = initial_white | initial_black;
+    initial_kings    = chessboard_get_previous_king_presence();
+
+    lifted          = 0;
+    candidate_valid = false;
+
+    // Only readings published from now on count
+    last_sequence = sensornetwork_get_snapshot(&reading, &stable);
+}
+
+/**
+ * @brief Takes the latest board reading into account (call on every EVENT_SCAN)
+ *
+ * @param p_capture Where to store whether the move was a capture (only written once done)
+ * @param p_intermediate Where to store the board once the captured piece was removed (only written once done)
+ * @param p_final Where to store the board after the move (only written once done)
+ * @return The progress of the turn
+ */
+autoturn_state_t autoturn_update(bool* p_capture, uint64_t* p_intermediate, uint64_t* p_final)
+{
+    uint64_t reading;
+    uint64_t intermediate;
+    bool stable;
+    uint32_t sequence = sensornetwork_get_snapshot(&reading, &stable);
+
+    // Only new readings count
+    if (sequence == last_sequence)
+    {
+        return (candidate_valid ? AUTOTURN_SETTLING : AUTOTURN_NONE);
+    }
+    last_sequence = sequence;
+
+    // Track lifted pieces, and forget them once every piece is back where it started
+    if (reading == initial_presence)
+    {
+        lifted = 0;
+    }
+    lifted |= (initial_presence & ~reading);
+
+    // Look for a single move
+    if ((!stable) || (!autoturn_get_candidate(reading, &intermediate)))
+    {
+        candidate_valid = false;
+        return AUTOTURN_NONE;
+    }
+
+    // Restart the wait whenever the candidate changes
+    if ((!candidate_valid) || (reading != candidate) || (intermediate != candidate_intermediate))
+    {
+        candidate_valid        = true;
+        candidate              = reading;
+        candidate_intermediate = intermediate;
+        candidate_sequence     = sequence;
+    }
+
+    if ((uint32_t) (sequence - candidate_sequence) < AUTOTURN_SETTLE_SCANS)
+    {
+        return AUTOTURN_SETTLING;
+    }
+
+    *p_capture      = (intermediate != initial_presence);
+    *p_intermediate = intermediate;
+    *p_final        = reading;
+    return AUTOTURN_DONE;
+}
+
+/**
+ * @brief Checks whether a reading differs from the start of the turn by exactly one move
+ *
+ * @param reading The reading
+ * @param p_intermediate Where to store the board once the captured piece was removed (the initial board if none was)
+ * @return Whether the reading holds a single move
+ */
+static bool autoturn_get_candidate(uint64_t reading, uint64_t* p_intermediate)
+{
+    uint64_t emptied  = initial_presence & ~reading;
+    uint64_t filled   = reading & ~initial_presence;
+    uint64_t captured = 0;
+    uint8_t num_emptied = autoturn_count_tiles(emptied);
+    uint8_t num_filled  = autoturn_count_tiles(filled);
+
+    *p_intermediate = initial_presence;
+
+    // Castling (king and rook both moved)
+    switch (emptied | filled)
+    {
+        case CASTLE_WHITE_K:
+        case CASTLE_WHITE_Q:
+        case CASTLE_BLACK_K:
+        case CASTLE_BLACK_Q:
+            return true;
+
+        default:
+        break;
+    }
+
+    // Non-special move (a king two files over from its home square is castling, so the rook has yet to move)
+    if ((num_emptied == 1) && (num_filled == 1))
+    {
+        return !autoturn_is_half_castle(emptied, filled);
+    }
+
+    // Capture, the mover took the place of a single opponent piece which was lifted
+    if ((num_emptied == 1) && (num_filled == 0))
+    {
+        uint64_t opponents = (emptied & initial_white) ? initial_black : initial_white;
+        captured = lifted & reading & opponents;
+
+        if (autoturn_count_tiles(captured) != 1)
+        {
+            return false;
+        }
+
+        *p_intermediate = initial_presence & ~captured;
+        return true;
+    }
+
+    // En passant
+    if ((num_emptied == 2) && (num_filled == 1) && autoturn_get_en_passant(emptied, filled, &captured))
+    {
+        *p_intermediate = initial_presence & ~captured;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Checks whether a single move is the king's part of castling
+ *
+ * @param emptied The emptied tile
+ * @param filled The filled tile
+ * @return Whether a king moved from its home square to the square it castles to
+ */
+static bool autoturn_is_half_castle(uint64_t emptied, uint64_t filled)
+{
+    if (!(emptied & initial_kings))
+    {
+        return false;
+    }
+
+    switch (emptied | filled)
+    {
+        case CASTLE_WHITE_K_KING:
+        case CASTLE_WHITE_Q_KING:
+        case CASTLE_BLACK_K_KING:
+        case CASTLE_BLACK_Q_KING:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Checks whether two emptied tiles and a filled one are an en passant capture
+ *
+ * @param emptied The two emptied tiles
+ * @param filled The filled tile
+ * @param p_captured Where to store the tile of the captured pawn
+ * @return Whether the tiles are an en passant capture
+ */
+static bool autoturn_get_en_passant(uint64_t emptied, uint64_t filled, uint64_t* p_captured)
+{
+    uint8_t target   = autoturn_first_tile(filled);
+    uint8_t tile_a   = autoturn_first_tile(emptied);
+    uint8_t tile_b   = autoturn_first_tile(emptied & ~(((uint64_t) 1) << tile_a));
+    uint8_t source   = tile_a;
+    uint8_t captured = tile_b;
+    bool source_white;
+
+    // The captured pawn is on the target's file (tile index = file index + 8 * rank index)
+    if ((tile_a % NUMBER_OF_COLS) == (target % NUMBER_OF_COLS))
+    {
+        source   = tile_b;
+        captured = tile_a;
+    }
+    else if ((tile_b % NUMBER_OF_COLS) != (target % NUMBER_OF_COLS))
+    {
+        return false;
+    }
+
+    // The pawns are side by side, and of opposite colors
+    source_white = ((initial_white >> source) & 0x01);
+    if (((source / NUMBER_OF_COLS) != (captured / NUMBER_OF_COLS)) ||
+        (((source % NUMBER_OF_COLS) + 1 != (captured % NUMBER_OF_COLS)) &&
+         ((captured % NUMBER_OF_COLS) + 1 != (source % NUMBER_OF_COLS))) ||
+        (source_white == ((initial_white >> captured) & 0x01)))
+    {
+        return false;
+    }
+
+    // The mover lands in front of the captured pawn (white moves up the ranks, black down)
+    if (target != (source_white ? (captured + NUMBER_OF_COLS) : (captured - NUMBER_OF_COLS)))
+    {
+        return false;
+    }
+
+    *p_captured = (((uint64_t) 1) << captured);
+    return true;
+}
+
+/**
+ * @brief Counts the tiles set in a mask
+ *
+ * @param tiles The mask
+ * @return The number of tiles
+ */
+static uint8_t autoturn_count_tiles(uint64_t tiles)
+{
+    uint8_t count = 0;
+
+    // Clear the lowest set tile until none are left
+    while (tiles)
+    {
+        tiles &= (tiles - 1);
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Finds the lowest tile set in a mask
+ *
+ * @param tiles The mask (must not be empty)
+ * @return The index of the tile
+ */
+static uint8_t autoturn_first_tile(uint64_t tiles)
+{
+    uint8_t index = 0;
+
+    while (!((tiles >> index) & 0x01) && (index < 63))
+    {
+        index++;
+    }
+
+    return index;
+}
+
+/* End autoturn.c */
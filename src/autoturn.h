@@ -0,0 +1,54 @@
+/**
+ * @file autoturn.h
+ * @author Keenan Alchaar (ka5nt@virginia.edu)
+ * @brief Detects the end of the human's turn from the stream of board readings, without buttons
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef AUTOTURN_H_
+#define AUTOTURN_H_
+
+// Note on automatic turns:
+//  - Only used when AUTO_TURN_ENABLED is defined (see utils.h). The capture tile and the "end turn" button are then
+//    ignored
+//  - autoturn_start() takes the board before the human's move from the chessboard module. Every debounced reading after
+//    that goes through autoturn_update(), which tracks the tiles lifted (occupied at the start of the turn, and empty in
+//    some reading since). Putting every piece back where it started forgets them
+//  - A stable reading (see sensornetwork.h) is a candidate when it differs from the start of the turn by exactly one
+//    move:
+//      - Move:       one tile emptied and one filled, unless it is a king moving two files from its home square (the
+//                    king's half of castling, which waits for the rook)
+//      - Capture:    one tile emptied (the source), and exactly one opponent tile lifted and filled again since
+//      - En passant: the source and the opponent pawn beside it emptied, and the tile in front of that pawn filled
+//      - Castling:   one of the CASTLE_* signatures (see chessboard.h)
+//    Promotions are moves or captures (the chessboard module queens the pawn)
+//  - The turn is over once the same candidate has been read for AUTOTURN_SETTLE_SCANS scans in a row, so a piece set
+//    down on its way somewhere does not end the turn
+//  - The result is given as the readings the buttons would have produced (the board once the captured piece is removed,
+//    and the final board), so the chessboard update is the same either way
+
+#include "chessboard.h"
+#include "sensornetwork.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Automatic turn defines
+#define AUTOTURN_SETTLE_MS          (750)
+#define AUTOTURN_SETTLE_SCANS       (AUTOTURN_SETTLE_MS * SENSORNETWORK_SCAN_FREQUENCY / 1000)
+
+// Progress of the turn
+typedef enum {
+    AUTOTURN_NONE = 0,              // The board does not hold a single move
+    AUTOTURN_SETTLING,              // The board holds a single move, which has not been there long enough
+    AUTOTURN_DONE                   // The move is complete
+} autoturn_state_t;
+
+// Function definitions
+void autoturn_start(void);
+autoturn_state_t autoturn_update(bool* p_capture, uint64_t* p_intermediate, uint64_t* p_final);
+
+#endif /* AUTOTURN_H_ */
@@ -607,10 +607,13 @@ static bool chessboard_update_from_presence_capture(chess_board_t* p_board, uint
     {
         uint8_t index_a = board_changes.presence_change_index_1;
 
-        // Clear this piece
+        // Clear this piece (the index converters pass an out-of-range index straight through)
         uint8_t captured_file_index = chessboard_presence_index_to_file_index(index_a);
         uint8_t captured_rank_index = chessboard_presence_index_to_rank_index(index_a);
-        p_curr_board->board_pieces[captured_rank_index][captured_file_index] = '\0';
+        if (index_a < 64)
+        {
+            p_curr_board->board_pieces[captured_rank_index][captured_file_index] = '\0';
+        }
 
         // Mark in the move when the piece is going to go to
         move[2] = chessboard_presence_index_to_file_index(index_a);
@@ -814,6 +817,31 @@ uint64_t chessboard_get_previous_white_presence()
     return mask;
 }
 
+/**
+ * @brief Public function to get the presence of both kings
+ *
+ * @returns A mask of the kings in their previous position
+ *
+ */
+uint64_t chessboard_get_previous_king_presence()
+{
+    int i,j; // i is the row (rank), j is the column (file)
+    uint64_t mask = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        for (j = 0; j < 8; j++)
+        {
+            if (p_prev_board->board_pieces[i][j] == 'K' || p_prev_board->board_pieces[i][j] == 'k')
+            {
+                mask |= ((uint64_t)1 << (i*8 + j));
+            }
+        }
+    }
+
+    return mask;
+}
+
 /**
  * @brief Public function to get the presence of all the black pieces
  *
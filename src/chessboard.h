@@ -30,6 +30,12 @@
 #define CASTLE_BLACK_K                      (0xF000000000000000)    // (e8g8)
 #define CASTLE_BLACK_Q                      (0x1D00000000000000)    // (e8c8)
 
+// King part of each castling signature (the king's home square, and the square it castles to)
+#define CASTLE_WHITE_K_KING                 (0x0000000000000050)    // (e1g1)
+#define CASTLE_WHITE_Q_KING                 (0x0000000000000014)    // (e1c1)
+#define CASTLE_BLACK_K_KING                 (0x5000000000000000)    // (e8g8)
+#define CASTLE_BLACK_Q_KING                 (0x1400000000000000)    // (e8c8)
+
 // Board state struct
 typedef struct {
     uint64_t board_presence;
@@ -75,6 +81,7 @@ void chessboard_update_previous_board_from_move(char move[5]);
 void chessboard_update_current_board_from_move(char move[5]);
 uint64_t chessboard_get_previous_black_presence();
 uint64_t chessboard_get_previous_white_presence();
+uint64_t chessboard_get_previous_king_presence();
 uint64_t chessboard_get_current_black_presence();
 uint64_t chessboard_get_current_white_presence();
 
@@ -56,12 +56,13 @@ void clock_timer0a_init(void)
     // Configure the timer for interrupts
     TIMER0->CTL  &= ~(TIMER_CTL_TAEN);                      // Disable the timer
     TIMER0->CFG   =  (0);                                   // Clear the configuration
-    TIMER0->TAMR  =  (TIMER_TAMR_TAMR_PERIOD);              // Configure for periodic interrupts
+    TIMER0->TAMR  =  (TIMER_TAMR_TAMR_PERIOD |              // Configure for periodic interrupts
+                        TIMER_TAMR_TAILD);                  // Load new intervals at time-out
     TIMER0->TAILR =  (TIMER_0A_RELOAD_VALUE);               // Set the interval value
     TIMER0->IMR  |=  (TIMER_IMR_TATOIM);                    // Set the interrupt mask
 
     // Configure the interrupt in the NVIC
-    utils_set_nvic(TIMER_0A_INTERRUPT_NUM, 5);
+    utils_set_nvic(TIMER_0A_INTERRUPT_NUM, 1);
 }
 
 /**
@@ -75,12 +76,13 @@ void clock_timer1a_init(void)
     // Configure the timer for interrupts
     TIMER1->CTL  &= ~(TIMER_CTL_TAEN);                      // Disable the timer
     TIMER1->CFG   =  (0);                                   // Clear the configuration
-    TIMER1->TAMR  =  (TIMER_TAMR_TAMR_PERIOD);              // Configure for periodic interrupts
+    TIMER1->TAMR  =  (TIMER_TAMR_TAMR_PERIOD |              // Configure for periodic interrupts
+                        TIMER_TAMR_TAILD);                  // Load new intervals at time-out
     TIMER1->TAILR =  (TIMER_1A_RELOAD_VALUE);               // Set the interval value
     TIMER1->IMR  |=  (TIMER_IMR_TATOIM);                    // Set the interrupt mask
 
     // Configure the interrupt in the NVIC
-    utils_set_nvic(TIMER_1A_INTERRUPT_NUM, 5);
+    utils_set_nvic(TIMER_1A_INTERRUPT_NUM, 1);
 }
 
 /**
@@ -94,12 +96,13 @@ void clock_timer2a_init(void)
     // Configure the timer for interrupts
     TIMER2->CTL  &= ~(TIMER_CTL_TAEN);                      // Disable the timer
     TIMER2->CFG   =  (0);                                   // Clear the configuration
-    TIMER2->TAMR  =  (TIMER_TAMR_TAMR_PERIOD);              // Configure for periodic interrupts
+    TIMER2->TAMR  =  (TIMER_TAMR_TAMR_PERIOD |              // Configure for periodic interrupts
+                        TIMER_TAMR_TAILD);                  // Load new intervals at time-out
     TIMER2->TAILR =  (TIMER_2A_RELOAD_VALUE);               // Set the interval value
     TIMER2->IMR  |=  (TIMER_IMR_TATOIM);                    // Set the interrupt mask
 
     // Configure the interrupt in the NVIC
-    utils_set_nvic(TIMER_2A_INTERRUPT_NUM, 5);
+    utils_set_nvic(TIMER_2A_INTERRUPT_NUM, 1);
 }
 
 /**
@@ -118,7 +121,7 @@ void clock_timer3a_init(void)
     TIMER3->IMR  |=  (TIMER_IMR_TATOIM);                    // Set the interrupt mask
 
     // Configure the interrupt in the NVIC
-    utils_set_nvic(TIMER_3A_INTERRUPT_NUM, 1);
+    utils_set_nvic(TIMER_3A_INTERRUPT_NUM, 2);
 }
 
 /**
@@ -137,7 +140,7 @@ void clock_timer4a_init(void)
     TIMER4->IMR  |=  (TIMER_IMR_TATOIM);                    // Set the interrupt mask
 
     // Configure the interrupt in the NVIC
-    utils_set_nvic(TIMER_4A_INTERRUPT_NUM, 2);
+    utils_set_nvic(TIMER_4A_INTERRUPT_NUM, 3);
 }
 
 /**
@@ -249,6 +252,21 @@ void clock_set_timer_period(TIMER0_Type* timer, uint32_t value)
 {
     timer->CTL  &= ~(TIMER_CTL_TAEN);                       // Disable the timer
     timer->TAILR =  value;                                  // Set the interval value
+    timer->TAV   =  value;                                  // Restart the count (timers using TIMER_TAMR_TAILD do not reload it)
+}
+
+/**
+ * @brief Queues the period of the next interval on a running timer, without stopping it
+ *
+ * Only valid for timers configured with TIMER_TAMR_TAILD, which take the new value at the next time-out. The current interval
+ * is left untouched, so interrupt latency does not add to the period.
+ *
+ * @param timer One of TIMERX for X={0,...,7}
+ * @param value The period
+ */
+void clock_load_timer_period(TIMER0_Type* timer, uint32_t value)
+{
+    timer->TAILR =  value;                                  // Set the interval value (loaded at time-out)
 }
 
 /**
@@ -291,4 +309,65 @@ void clock_trigger_interrupt(TIMER0_Type* timer)
     timer->CTL |= (TIMER_CTL_TAEN);                         // Enable the timer
 }
 
+/**
+ * @brief Configure SysTick (not started until clock_start_systick())
+ */
+void clock_systick_init(void)
+{
+    SysTick->CTRL =  (0);                                   // Disable SysTick
+    SysTick->LOAD =  (SYSTICK_PERIOD);                      // Set the interval value
+    SysTick->VAL  =  (0);                                   // Clear the value
+
+    // SysTick is a system exception, so it is not enabled through an ISER register
+    NVIC_SetPriority(SYSTICK_INTERRUPT_NUM, 4);
+}
+
+/**
+ * @brief Starts SysTick, with a full period before its first interrupt
+ */
+void clock_start_systick(void)
+{
+    SysTick->VAL   = (0);                                   // Reload on the next cycle
+    SysTick->CTRL |= (SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk);
+}
+
+/**
+ * @brief Restarts the SysTick period from now, with a new length
+ *
+ * @param period The reload value (the period is period + 1 core clock cycles)
+ */
+void clock_set_systick_period(uint32_t period)
+{
+    SysTick->LOAD = (period);                               // Set the interval value
+    SysTick->VAL  = (0);                                    // Reload on the next cycle
+}
+
+/**
+ * @brief Stops SysTick
+ */
+void clock_stop_systick(void)
+{
+    SysTick->CTRL &= ~(SysTick_CTRL_ENABLE_Msk);
+}
+
+/**
+ * @brief Starts the DWT cycle counter, which counts every core clock cycle (wraps about every 35.8 s at 120 MHz)
+ */
+void clock_cycle_counter_init(void)
+{
+    CoreDebug->DEMCR |= (CoreDebug_DEMCR_TRCENA_Msk);       // Enable the trace and debug blocks
+    DWT->CYCCNT       = 0;                                  // Clear the count
+    DWT->CTRL        |= (DWT_CTRL_CYCCNTENA_Msk);           // Start counting
+}
+
+/**
+ * @brief Gets the current value of the DWT cycle counter
+ *
+ * @return The number of core clock cycles since the counter started (modulo 2^32)
+ */
+uint32_t clock_get_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
 /* End clock.c */
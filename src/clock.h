@@ -57,6 +57,10 @@
 #define TIMER_7C_RELOAD_VALUE                   (TIMER_7C_PERIOD << NVIC_ST_RELOAD_S)
 #define TIMER_7C_INTERRUPT_NUM                  TIMER7A_IRQn
 
+// SysTick defines
+#define SYSTICK_PERIOD                          2399        // Period: 20us @ 120MHz (board sensor settling, until calibrated)
+#define SYSTICK_INTERRUPT_NUM                   SysTick_IRQn
+
 // Function definitions
 void clock_sys_init(void);
 void clock_timer0a_init(void);                       // X Stepper
@@ -67,14 +71,21 @@ void clock_timer4a_init(void);                       // Gantry
 void clock_timer5a_init(void);                       // Delay
 void clock_timer6a_init(void);                       // LED
 void clock_timer7c_init(void);                       // Communication Timeout
+void clock_cycle_counter_init(void);                 // DWT cycle counter (tracing)
+void clock_systick_init(void);                       // Board scan
 
 void clock_clear_interrupt(TIMER0_Type* timer);
 void clock_stop_timer(TIMER0_Type* timer);
 void clock_start_timer(TIMER0_Type* timer);
 bool clock_active(TIMER0_Type* timer);
 void clock_set_timer_period(TIMER0_Type* timer, uint32_t value);
+void clock_load_timer_period(TIMER0_Type* timer, uint32_t value);
 uint32_t clock_get_timer_period(TIMER0_Type* timer);
 void clock_reset_timer_value(TIMER0_Type* timer);
 void clock_trigger_interrupt(TIMER0_Type* timer);
+uint32_t clock_get_cycles(void);
+void clock_start_systick(void);
+void clock_stop_systick(void);
+void clock_set_systick_period(uint32_t period);
 
 #endif /* CLOCK_H_ */
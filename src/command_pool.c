@@ -0,0 +1,122 @@
+/**
+ * @file command_pool.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Fixed-block allocator for command objects
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "command_pool.h"
+#include "gantry.h"
+
+// A block is large enough for any command (add new command structs here)
+typedef union command_pool_block_t command_pool_block_t;
+union command_pool_block_t {
+    command_pool_block_t* p_next;           // Next free block (only while the block is free)
+    command_t command;
+    delay_command_t delay;
+    electromagnet_command_t electromagnet;
+    stepper_rel_command_t stepper_rel;
+    stepper_chess_command_t stepper_chess;
+    gantry_command_t gantry;
+    gantry_robot_command_t gantry_robot;
+    gantry_comm_command_t gantry_comm;
+    motionprogram_command_t motionprogram;
+};
+
+static command_pool_block_t blocks[COMMAND_POOL_SIZE];
+static command_pool_block_t* p_free;
+static command_pool_stats_t stats;
+
+/**
+ * @brief Initializes the pool. Starts with every block free
+ */
+void command_pool_init(void)
+{
+    uint16_t i = 0;
+
+    // Chain every block onto the free list
+    for (i = 0; i < (COMMAND_POOL_SIZE - 1); i++)
+    {
+        blocks[i].p_next = &blocks[i + 1];
+    }
+    blocks[COMMAND_POOL_SIZE - 1].p_next = NULL;
+    p_free = &blocks[0];
+
+    stats.in_use     = 0;
+    stats.high_water = 0;
+    stats.failures   = 0;
+}
+
+/**
+ * @brief Takes a block from the pool
+ *
+ * @param size Size of the command being built (must fit in a block)
+ * @return Pointer to the block, or NULL if the pool is empty
+ */
+command_t* command_pool_alloc(size_t size)
+{
+    command_pool_block_t* p_block = NULL;
+    uint32_t primask = utils_enter_critical();
+
+    if ((p_free != NULL) && (size <= sizeof(command_pool_block_t)))
+    {
+        // Pop the head of the free list
+        p_block = p_free;
+        p_free  = p_block->p_next;
+
+        // Update the statistics
+        stats.in_use++;
+        if (stats.in_use > stats.high_water)
+        {
+            stats.high_water = stats.in_use;
+        }
+    }
+    else
+    {
+        stats.failures++;
+    }
+
+    utils_exit_critical(primask);
+
+    return (command_t*) p_block;
+}
+
+/**
+ * @brief Returns a block to the pool. Pointers which did not come from the pool are ignored
+ *
+ * @param p_command The command to free
+ */
+void command_pool_free(command_t* p_command)
+{
+    command_pool_block_t* p_block = (command_pool_block_t*) p_command;
+    uint32_t primask;
+
+    if ((p_block < &blocks[0]) || (p_block >= &blocks[COMMAND_POOL_SIZE]))
+    {
+        return;
+    }
+
+    // Push the block onto the free list
+    primask = utils_enter_critical();
+    p_block->p_next = p_free;
+    p_free = p_block;
+    stats.in_use--;
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Gets the pool usage statistics
+ *
+ * @param p_stats Where to store the statistics
+ */
+void command_pool_get_stats(command_pool_stats_t* p_stats)
+{
+    uint32_t primask = utils_enter_critical();
+    *p_stats = stats;
+    utils_exit_critical(primask);
+}
+
+/* End command_pool.c */
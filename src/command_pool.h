@@ -0,0 +1,44 @@
+/**
+ * @file command_pool.h
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Fixed-block allocator for command objects
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef COMMAND_POOL_H_
+#define COMMAND_POOL_H_
+
+// Note on the command pool:
+//  - Every block is the size of the largest command struct (see command_pool.c), so any command fits in any block
+//  - Blocks are kept on a free list, so allocating and freeing are O(1) and never fragment
+//  - There are enough blocks to fill every lane of the command queue, plus the commands being run and some being built
+//  - When the pool is empty, command_pool_alloc() returns NULL and counts the failure. Builders then return NULL, and
+//    command_queue_push() rejects it
+//  - Safe to use from interrupts (the gantry interrupt builds and clears commands)
+
+#include "command_queue.h"
+#include "scheduler.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Command pool defines
+#define COMMAND_POOL_SIZE           (COMMAND_QUEUE_SIZE + SCHEDULER_MAX_ACTIVE + 4)
+
+// Pool usage statistics
+typedef struct command_pool_stats_t {
+    uint16_t in_use;                // Blocks currently allocated
+    uint16_t high_water;            // Most blocks ever allocated at once
+    uint16_t failures;              // Allocations refused because the pool was empty (or the request too large)
+} command_pool_stats_t;
+
+// Function definitions
+void command_pool_init(void);
+command_t* command_pool_alloc(size_t size);
+void command_pool_free(command_t* p_command);
+void command_pool_get_stats(command_pool_stats_t* p_stats);
+
+#endif /* COMMAND_POOL_H_ */
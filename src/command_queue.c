@@ -4,130 +4,362 @@
  * @brief Implements a First-In, First-Out (queue) data structure for commands
  * @version 0.1
  * @date 2022-10-22
- * 
+ *
  * @copyright Copyright (c) 2022
  */
 
 #include "command_queue.h"
+#include "command_pool.h"
+#include "event.h"
+
+// A ring of commands (main loop only)
+typedef struct command_ring_t {
+    command_t** p_slots;
+    uint16_t mask;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+} command_ring_t;
+
+// Private functions
+static void command_queue_service_requests(void);
+static bool command_ring_push(command_ring_t* p_ring, command_t* value);
+static command_t* command_ring_front(command_ring_t* p_ring);
+static command_t* command_ring_take(command_ring_t* p_ring);
+static void command_ring_clear(command_ring_t* p_ring);
+static command_ring_t* command_queue_get_ring(command_lane_t lane);
+
+// Make sure the masking works
+#if ((COMMAND_QUEUE_SIZE & COMMAND_QUEUE_MASK) != 0) || (COMMAND_QUEUE_SIZE > 32768)
+#error "COMMAND_QUEUE_SIZE must be a power of two, and at most 32768"
+#endif
+
+// Normal lane
+static command_t* normal_slots[COMMAND_QUEUE_SIZE];
+static command_ring_t normal_ring = {normal_slots, COMMAND_QUEUE_MASK, 0, 0};
 
-static command_t* queue[COMMAND_QUEUE_SIZE];
-static uint16_t head;
-static uint16_t tail;
+// Emergency lane (a mailbox) and clear request (written from interrupts)
+static command_t* volatile mailbox;
+static volatile bool clear_requested;
 
 /**
  * @brief Initializes the queue. Starts empty
  */
 void command_queue_init(void)
 {
-    head = 0;
-    tail = 0;
+    normal_ring.head = 0;
+    normal_ring.tail = 0;
+    mailbox = NULL;
+    clear_requested = false;
 }
 
 /**
- * @brief Pushes an element into the queue. If the queue is full, this will do nothing
- * 
+ * @brief Pushes an element into the normal lane. If the element is NULL or the lane is full, this will do nothing
+ *
  * @param value The value to be put on the queue
  * @return Whether the push was successful
  */
 bool command_queue_push(command_t* value)
 {
-    // If the queue is full, return
-    if (command_queue_get_size() == COMMAND_QUEUE_SIZE)
+    return command_ring_push(&normal_ring, value);
+}
+
+/**
+ * @brief Removes the value at the front of the highest priority lane that is not empty
+ *
+ * @param p_value Pointer to where the value will be stored
+ * @return Whether the pop was successful
+ */
+bool command_queue_pop(command_t** p_value)
+{
+    command_queue_service_requests();
+
+    // Interrupt commands jump the queue (the barrier orders the command's contents after the pointer)
+    if (mailbox != NULL)
     {
-        return false;
+        *p_value = mailbox;
+        __DMB();
+        mailbox = NULL;
+        return true;
     }
-    else
+
+    // If it's empty do nothing
+    if (normal_ring.head == normal_ring.tail)
     {
-        // Put the value in
-        queue[head] = value;
+        return false;
+    }
 
-        // Advance the head
-        head += 1;
-        if (head >= COMMAND_QUEUE_SIZE)
-        {
-            head = 0;
-        }
+    // Get the value, then free its slot by advancing the tail
+    *p_value = command_ring_take(&normal_ring);
 
-        // Success
-        return true;
-    }
+    // Success
+    return true;
 }
 
 /**
- * @brief Removes the value at the front of the queue. If there is nothing in the queue, the storage pointer is evaluated to NULL
- * 
+ * @brief Looks at the value that the next pop will return, without removing it
+ *
  * @param p_value Pointer to where the value will be stored
- * @return Whether the pop was successful
+ * @return Whether there was a value to look at
  */
-bool command_queue_pop(command_t** p_value)
+bool command_queue_peek(command_t** p_value)
 {
+    command_queue_service_requests();
+
+    if (mailbox != NULL)
+    {
+        *p_value = mailbox;
+        return true;
+    }
 
     // If it's empty do nothing
-    if (command_queue_is_empty())
+    if (normal_ring.head == normal_ring.tail)
     {
         return false;
     }
-    else 
-    {
-        // Get the value
-        *p_value = queue[tail];
 
-        // Advance the tail
-        tail++;
-        if (tail >= COMMAND_QUEUE_SIZE)
+    *p_value = command_ring_front(&normal_ring);
+    return true;
+}
+
+/**
+ * @brief Looks at a command anywhere in a lane, without removing it
+ *
+ * @param lane The lane to look in
+ * @param index Position in the lane (0 is the front)
+ * @param p_value Pointer to where the value will be stored
+ * @return Whether there was a value at that position
+ */
+bool command_queue_peek_at(command_lane_t lane, uint16_t index, command_t** p_value)
+{
+    command_ring_t* p_ring = command_queue_get_ring(lane);
+
+    command_queue_service_requests();
+
+    // The emergency lane only holds the mailbox
+    if (p_ring == NULL)
+    {
+        if ((lane != COMMAND_LANE_EMERGENCY) || (index != 0) || (mailbox == NULL))
         {
-            tail = 0;
+            return false;
         }
-        
-        // Success
+        *p_value = mailbox;
         return true;
     }
+
+    if (index >= (uint16_t) (p_ring->head - p_ring->tail))
+    {
+        return false;
+    }
+
+    *p_value = p_ring->p_slots[(uint16_t) (p_ring->tail + index) & p_ring->mask];
+    return true;
 }
 
 /**
- * @brief Gives the number of elements currently in the queue
- * 
- * @return The size of the queue
+ * @brief Removes a command from anywhere in a lane, keeping the order of the rest (main loop only)
+ *
+ * @param lane The lane to remove from
+ * @param index Position in the lane (0 is the front)
+ * @param p_value Pointer to where the value will be stored
+ * @return Whether there was a value at that position
  */
-uint16_t command_queue_get_size(void)
+bool command_queue_remove_at(command_lane_t lane, uint16_t index, command_t** p_value)
 {
-    // When (head==tail), the size is 0
-    if (head >= tail)
+    command_ring_t* p_ring = command_queue_get_ring(lane);
+    uint16_t i = 0;
+
+    if (!command_queue_peek_at(lane, index, p_value))
     {
-        return head - tail;
+        return false;
     }
-    else 
+
+    // Empty the mailbox
+    if (p_ring == NULL)
+    {
+        mailbox = NULL;
+        return true;
+    }
+
+    // Close the gap by shifting the commands in front of it back one slot, then advance the tail
+    for (i = index; i > 0; i--)
     {
-        return COMMAND_QUEUE_SIZE - (tail - head) + 1;
+        p_ring->p_slots[(uint16_t) (p_ring->tail + i) & p_ring->mask] = p_ring->p_slots[(uint16_t) (p_ring->tail + i - 1) & p_ring->mask];
     }
+    p_ring->tail = p_ring->tail + 1;
+
+    return true;
+}
+
+/**
+ * @brief Gives the number of elements currently in the normal lane
+ *
+ * @return The size of the queue
+ */
+uint16_t command_queue_get_size(void)
+{
+    // The counters wrap together, so the difference is always the size
+    return (uint16_t) (normal_ring.head - normal_ring.tail);
 }
 
 /**
  * @brief Checks if the queue is empty or not
- * 
- * @return True if the queue is empty, false otherwise
+ *
+ * @return True if every lane is empty, false otherwise
  */
 bool command_queue_is_empty(void)
 {
-    return head == tail;
+    return (normal_ring.head == normal_ring.tail) && (mailbox == NULL);
 }
 
 /**
- * @brief Clears the queue
+ * @brief Clears the normal lane (a command posted from an interrupt is kept)
  *
  * @return True always
  */
 bool command_queue_clear(void)
 {
-    command_t* p_command;
+    command_ring_clear(&normal_ring);
+
+    return true;
+}
+
+/**
+ * @brief Posts a command to the emergency lane from an interrupt. It preempts whatever is running
+ *
+ * @param value The command to post
+ * @return Whether the command was posted (if not, it is returned to the pool)
+ */
+bool command_queue_post_from_isr(command_t* value)
+{
+    uint32_t primask;
 
-    // Free all remaining commands
-    while (command_queue_pop(&p_command))
+    if (value == NULL)
     {
-        free(p_command);
+        return false;
     }
 
+    // Only one command may wait in the mailbox (masked, so a nested interrupt cannot post between the check and the write).
+    // A second post is refused, and the caller must fault rather than lose it
+    primask = utils_enter_critical();
+    if (mailbox != NULL)
+    {
+        utils_exit_critical(primask);
+        command_pool_free(value);
+        return false;
+    }
+
+    // Publish the command's contents before the pointer
+    __DMB();
+    mailbox = value;
+    utils_exit_critical(primask);
+
+    event_post(EVENT_COMMAND);
     return true;
 }
 
+/**
+ * @brief Asks the main loop to clear the queue the next time it pops or peeks (safe to call from interrupts)
+ */
+void command_queue_request_clear(void)
+{
+    clear_requested = true;
+    event_post(EVENT_COMMAND);
+}
+
+/**
+ * @brief Services a clear requested from an interrupt (main loop only)
+ */
+static void command_queue_service_requests(void)
+{
+    if (clear_requested)
+    {
+        clear_requested = false;
+        command_queue_clear();
+    }
+}
+
+/**
+ * @brief Pushes a command into a ring
+ *
+ * @param p_ring The ring to push into
+ * @param value The command
+ * @return Whether the push was successful (fails if the command is NULL or the ring is full)
+ */
+static bool command_ring_push(command_ring_t* p_ring, command_t* value)
+{
+    // If the command could not be built (out of memory), or the ring is full, return
+    if ((value == NULL) || ((uint16_t) (p_ring->head - p_ring->tail) > p_ring->mask))
+    {
+        return false;
+    }
+
+    // Put the value in, then publish it by advancing the head (the barriers keep the slot write between the two)
+    __DMB();
+    p_ring->p_slots[p_ring->head & p_ring->mask] = value;
+    __DMB();
+    p_ring->head = p_ring->head + 1;
+
+    return true;
+}
+
+/**
+ * @brief Gets the command at the front of a ring (the ring must not be empty)
+ *
+ * @param p_ring The ring
+ * @return The command at the front
+ */
+static command_t* command_ring_front(command_ring_t* p_ring)
+{
+    __DMB();
+    return p_ring->p_slots[p_ring->tail & p_ring->mask];
+}
+
+/**
+ * @brief Removes the command at the front of a ring (the ring must not be empty)
+ *
+ * @param p_ring The ring
+ * @return The command that was at the front
+ */
+static command_t* command_ring_take(command_ring_t* p_ring)
+{
+    command_t* value = command_ring_front(p_ring);
+
+    // Read the slot before handing it back to the producer
+    __DMB();
+    p_ring->tail = p_ring->tail + 1;
+
+    return value;
+}
+
+/**
+ * @brief Returns every command in a ring to the pool
+ *
+ * @param p_ring The ring to clear
+ */
+static void command_ring_clear(command_ring_t* p_ring)
+{
+    while (p_ring->head != p_ring->tail)
+    {
+        command_pool_free(command_ring_take(p_ring));
+    }
+}
+
+/**
+ * @brief Gets the ring backing a lane
+ *
+ * @param lane The lane
+ * @return The ring, or NULL for the emergency lane (the mailbox)
+ */
+static command_ring_t* command_queue_get_ring(command_lane_t lane)
+{
+    switch (lane)
+    {
+        case COMMAND_LANE_NORMAL:
+            return &normal_ring;
+
+        default:
+            return NULL;
+    }
+}
+
 /* End command_queue.c */
@@ -15,24 +15,105 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+// Note on the command queue:
+//  - A single-producer/single-consumer ring: only the main loop (and the commands it runs) may push, pop, peek or clear
+//  - Head and tail are free-running counters masked by (COMMAND_QUEUE_SIZE - 1), so every slot is usable
+//  - Interrupts never touch the ring:
+//      - command_queue_post_from_isr() places a command in a one-slot mailbox, which the next pop takes ahead of the ring
+//      - command_queue_request_clear() asks the main loop to clear the ring on its next pop/peek
+//  - Barriers (__DMB) order each slot access against the head/tail update, and a mailbox command's contents against its
+//    pointer, so the ring and the mailbox stay correct with the producer and consumer in different contexts (checked on
+//    the host by tools/host_tests/test_command_queue.c)
+
+// Note on lanes:
+//  - Commands run from two lanes, highest priority first:
+//      - Emergency: the interrupt mailbox (reset/start/home buttons). It holds one command, so a post that finds it full
+//        is refused, and the poster must treat that as a fault rather than lose the command
+//      - Normal: everything else (motion, delays, comm), pushed with command_queue_push()
+//  - While a command runs, the scheduler (scheduler.c) checks the higher lanes. If one has work, the running command's
+//    p_abort() is called in place of p_exit(), and the higher priority command runs next
+//  - Lower priority work still queued is resumed afterwards, unless the preempting command clears it (reset does)
+//  - p_abort() must leave the hardware safe (motors and timers stopped) and must not queue anything
+
+// Note on resources:
+//  - Every command declares the resources it uses (COMMAND_RESOURCE_*). The scheduler runs commands concurrently, and
+//    out of order, as long as they use different resources
+//  - A command never starts ahead of an earlier queued command it shares a resource with, so anything that must stay
+//    ordered with motion (delays, the magnet, homing flags) claims COMMAND_RESOURCE_MOTION
+//  - A command which must only wait for the work queued ahead of it, without holding that work's resources once it has
+//    started, lists them in after. The Pi commands wait for motion this way (the START message goes out once homing
+//    and the start position check are done) but only hold COMMAND_RESOURCE_RPI, so motion runs while they wait on the Pi
+//  - Commands share the main loop, so none may hold it. The Pi writes only queue bytes for the Tx interrupt (see
+//    rpi_transmit()), and the reads take what has arrived (see rpi_receive_frame()) and run again on EVENT_UART_RX
+
 // Command queue defines
-#define COMMAND_QUEUE_SIZE          (128) // Must be at least 1 and less than 65535
+#define COMMAND_QUEUE_SIZE          (128) // Must be a power of two, and at most 32768
+#define COMMAND_QUEUE_MASK          (COMMAND_QUEUE_SIZE - 1)
+
+// Resources a command may use
+#define COMMAND_RESOURCE_NONE       (0x00)
+#define COMMAND_RESOURCE_MOTION     (0x01) // Steppers, and anything ordered with them
+#define COMMAND_RESOURCE_RPI        (0x02) // Raspberry Pi UART
+#define COMMAND_RESOURCE_SCAN       (0x04) // Board sensors
+#define COMMAND_RESOURCE_MAGNET     (0x08) // Electromagnet
+#define COMMAND_RESOURCE_ALL        (0x0F)
+
+// Command type IDs (reported by the tracer, see trace.h)
+typedef enum {
+    COMMAND_ID_NONE = 0,
+    COMMAND_ID_DELAY,
+    COMMAND_ID_ELECTROMAGNET,
+    COMMAND_ID_STEPPER_REL,
+    COMMAND_ID_STEPPER_CHESS,
+    COMMAND_ID_STEPPER_HOME,
+    COMMAND_ID_START_STATE,
+    COMMAND_ID_RESET,
+    COMMAND_ID_HUMAN,
+    COMMAND_ID_COMM,
+    COMMAND_ID_ROBOT,
+    COMMAND_ID_HOME,
+    COMMAND_ID_MOTIONPROGRAM,
+    COMMAND_ID_METRICS
+} command_id_t;
+
+// Lanes, highest priority first
+typedef enum {
+    COMMAND_LANE_EMERGENCY = 0,
+    COMMAND_LANE_NORMAL
+} command_lane_t;
 
 // Node type for the command queue
 typedef struct command_t command_t;
-struct command_t {
+
+// Operations of a command type (every command of a type shares one static const table, so it lives in flash)
+typedef struct command_ops_t {
     void (*p_entry)(command_t* command);
     void (*p_action)(command_t* command);
     void (*p_exit)(command_t* command);
     bool (*p_is_done)(command_t* command);
+    void (*p_abort)(command_t* command);
+    uint8_t resources;
+    uint8_t after;                  // COMMAND_RESOURCE_* it waits for, without holding them (see above)
+    uint8_t events;
+    uint8_t id;                     // COMMAND_ID_*
+} command_ops_t;
+
+// Header of every command (concrete commands embed this as their first member, followed by their payload)
+struct command_t {
+    const command_ops_t* p_ops;
 };
 
 // Function definitions
 void command_queue_init(void);
 bool command_queue_push(command_t* value);
 bool command_queue_pop(command_t** p_value);
+bool command_queue_peek(command_t** p_value);
+bool command_queue_peek_at(command_lane_t lane, uint16_t index, command_t** p_value);
+bool command_queue_remove_at(command_lane_t lane, uint16_t index, command_t** p_value);
 uint16_t command_queue_get_size(void);
 bool command_queue_is_empty(void);
 bool command_queue_clear(void);
+bool command_queue_post_from_isr(command_t* value);
+void command_queue_request_clear(void);
 
 #endif /* COMMAND_QUEUE_H_ */
@@ -0,0 +1,135 @@
+/**
+ * @file cpuload.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Measures how much of the core each interrupt takes, and how long the main loop sleeps
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "cpuload.h"
+
+// Private functions
+static void cpuload_add(cpuload_usage_t* p_usage, uint32_t cycles);
+static void cpuload_clear(cpuload_usage_t* p_usage);
+static void cpuload_update_window(void);
+
+static cpuload_snapshot_t current;
+static uint32_t last_cycles;
+
+/**
+ * @brief Initializes the monitor and starts the first window (the cycle counter must already be running)
+ */
+void cpuload_init(void)
+{
+    cpuload_snapshot_t discard;
+    cpuload_take_snapshot(&discard);
+}
+
+/**
+ * @brief Extends the window up to now (called from the gantry interrupt, so the cycle counter never wraps unseen)
+ */
+void cpuload_tick(void)
+{
+    uint32_t primask = utils_enter_critical();
+    cpuload_update_window();
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Records a single invocation of an interrupt
+ *
+ * @param isr One of TRACE_ISR_*
+ * @param cycles Cycles the invocation took
+ */
+void cpuload_record_isr(uint8_t isr, uint32_t cycles)
+{
+    uint32_t primask;
+
+    if (isr >= CPULOAD_ISR_COUNT)
+    {
+        return;
+    }
+
+    primask = utils_enter_critical();
+    cpuload_add(&current.isr[isr], cycles);
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Records a single sleep of the main loop
+ *
+ * @param cycles Cycles spent asleep
+ */
+void cpuload_record_idle(uint32_t cycles)
+{
+    uint32_t primask = utils_enter_critical();
+    cpuload_add(&current.idle, cycles);
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Copies out everything measured since the last snapshot, then starts a new window
+ *
+ * @param p_snapshot Where to store the snapshot
+ */
+void cpuload_take_snapshot(cpuload_snapshot_t* p_snapshot)
+{
+    uint8_t i = 0;
+    uint32_t primask = utils_enter_critical();
+
+    cpuload_update_window();
+    *p_snapshot = current;
+
+    for (i = 0; i < CPULOAD_ISR_COUNT; i++)
+    {
+        cpuload_clear(&current.isr[i]);
+    }
+    cpuload_clear(&current.idle);
+    current.window_cycles = 0;
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Adds an invocation to a usage (call with interrupts masked)
+ *
+ * @param p_usage The usage
+ * @param cycles Cycles the invocation took
+ */
+static void cpuload_add(cpuload_usage_t* p_usage, uint32_t cycles)
+{
+    p_usage->count++;
+    p_usage->cycles += cycles;
+    if (cycles > p_usage->max_cycles)
+    {
+        p_usage->max_cycles = cycles;
+    }
+}
+
+/**
+ * @brief Zeroes a usage (call with interrupts masked)
+ *
+ * @param p_usage The usage
+ */
+static void cpuload_clear(cpuload_usage_t* p_usage)
+{
+    p_usage->count      = 0;
+    p_usage->cycles     = 0;
+    p_usage->max_cycles = 0;
+}
+
+/**
+ * @brief Adds the cycles since the last update to the window (call with interrupts masked)
+ */
+static void cpuload_update_window(void)
+{
+    uint32_t cycles = clock_get_cycles();
+
+    // Unsigned subtraction handles a single wrap
+    current.window_cycles += (uint32_t) (cycles - last_cycles);
+    last_cycles = cycles;
+}
+
+/* End cpuload.c */
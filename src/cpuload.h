@@ -0,0 +1,74 @@
+/**
+ * @file cpuload.h
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Measures how much of the core each interrupt takes, and how long the main loop sleeps
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef CPULOAD_H_
+#define CPULOAD_H_
+
+// Note on the load monitor:
+//  - Every interrupt handler starts with ISR_ENTER() and ends with ISR_EXIT(). Together they trace the interrupt (see
+//    trace.h) and time it with the DWT cycle counter
+//  - For each interrupt, the monitor keeps the number of invocations, the total cycles and the longest invocation
+//  - Interrupt times are inclusive: a handler preempted by a higher priority interrupt is charged for it too
+//  - The main loop's sleeps (WFI in event_wait()) are timed the same way, giving the idle time. The time an interrupt
+//    takes to wake the core is not counted as idle
+//  - The window runs from the last cpuload_take_snapshot() (or cpuload_init()). Its length is kept by cpuload_tick(),
+//    which the gantry interrupt calls well within the 35.8 s the cycle counter takes to wrap
+//  - The Pi requests a snapshot with the LOAD instruction (see raspberrypi.h). tools/cpuload_report.py prints it
+//  - tools/host_tests/test_cpuload.c runs the step interrupts at top speed through the monitor on a PC, and reports the
+//    interrupt rates and the cycles each step interrupt may take
+//  - The timing compiles away unless CPULOAD_ENABLED is defined (see utils.h). Tracing does not depend on it
+
+#include "msp.h"
+#include "clock.h"
+#include "trace.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Load monitor defines
+#define CPULOAD_ISR_COUNT           (TRACE_ISR_COUNT) // Interrupts are identified by TRACE_ISR_*
+
+// Usage of an interrupt, or of the idle loop
+typedef struct cpuload_usage_t {
+    uint32_t count;                 // Invocations (or sleeps)
+    uint64_t cycles;                // Total cycles
+    uint32_t max_cycles;            // Longest single invocation (or sleep)
+} cpuload_usage_t;
+
+// Everything measured over a window
+typedef struct cpuload_snapshot_t {
+    cpuload_usage_t isr[CPULOAD_ISR_COUNT];
+    cpuload_usage_t idle;
+    uint64_t window_cycles;         // Length of the window
+} cpuload_snapshot_t;
+
+// Interrupt hooks (ISR_ENTER() must be the first statement of the handler, and ISR_EXIT() the last)
+#ifdef CPULOAD_ENABLED
+#   define ISR_ENTER(isr, arg)              uint32_t isr_start_cycles = clock_get_cycles(); TRACE_ISR_ENTER((isr), (arg))
+#   define ISR_EXIT(isr, arg)               TRACE_ISR_EXIT((isr), (arg)); cpuload_record_isr((isr), clock_get_cycles() - isr_start_cycles)
+#   define CPULOAD_IDLE_ENTER()             uint32_t idle_start_cycles = clock_get_cycles()
+#   define CPULOAD_IDLE_EXIT()              cpuload_record_idle(clock_get_cycles() - idle_start_cycles)
+#   define CPULOAD_TICK()                   cpuload_tick()
+#else
+#   define ISR_ENTER(isr, arg)              TRACE_ISR_ENTER((isr), (arg))
+#   define ISR_EXIT(isr, arg)               TRACE_ISR_EXIT((isr), (arg))
+#   define CPULOAD_IDLE_ENTER()
+#   define CPULOAD_IDLE_EXIT()
+#   define CPULOAD_TICK()
+#endif
+
+// Function definitions
+void cpuload_init(void);
+void cpuload_tick(void);
+void cpuload_record_isr(uint8_t isr, uint32_t cycles);
+void cpuload_record_idle(uint32_t cycles);
+void cpuload_take_snapshot(cpuload_snapshot_t* p_snapshot);
+
+#endif /* CPULOAD_H_ */
@@ -13,6 +13,18 @@
 // Busy wait counter
 static uint32_t count;
 
+// Command operations (one table per command type, kept in flash)
+static const command_ops_t delay_ops = {
+    .p_entry   = &delay_entry,
+    .p_action  = &utils_empty_function,
+    .p_exit    = &utils_empty_function,
+    .p_is_done = &delay_is_done,
+    .p_abort   = &delay_abort,
+    .resources = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_DELAY,
+    .id        = COMMAND_ID_DELAY
+};
+
 /**
  * @brief Dynamically allocates a delay command
  * 
@@ -22,13 +34,14 @@ static uint32_t count;
 delay_command_t* delay_build_command(uint16_t time_ms)
 {
     // The thing to return
-    delay_command_t* p_command = (delay_command_t*) malloc(sizeof(delay_command_t));
+    delay_command_t* p_command = (delay_command_t*) command_pool_alloc(sizeof(delay_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &delay_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &utils_empty_function;
-    p_command->command.p_is_done = &delay_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &delay_ops;
 
     // Data
     p_command->time_ms = time_ms;
@@ -45,8 +58,29 @@ void delay_entry(command_t* command)
 {
     delay_command_t* p_delay_command = (delay_command_t*) command;
 
+    delay_start(p_delay_command->time_ms);
+}
+
+/**
+ * @brief Determines when the action function is complete
+ * 
+ * @param command A delay command from the command queue
+ * @return Whether time_ms has elapsed
+ */
+bool delay_is_done(command_t* command)
+{
+    return delay_is_expired();
+}
+
+/**
+ * @brief Starts the delay timer (used directly by commands which wait themselves)
+ * 
+ * @param time_ms The amount of time to wait in milliseconds (ms)
+ */
+void delay_start(uint16_t time_ms)
+{
     // Interrupts execute every 1ms
-    count = p_delay_command->time_ms;
+    count = time_ms;
 
     // Enable the timer
     clock_set_timer_period(DELAY_TIMER, DELAY_PERIOD);
@@ -54,21 +88,33 @@ void delay_entry(command_t* command)
 }
 
 /**
- * @brief Determines when the action function is complete
+ * @brief Checks if the delay started by delay_start() has elapsed
  * 
- * @param command A delay command from the command queue
- * @return Whether time_ms has elapsed
+ * @return Whether the time has elapsed
  */
-bool delay_is_done(command_t* command)
+bool delay_is_expired(void)
 {
     return (count == 0);
 }
 
+/**
+ * @brief Stops the delay early (the command was preempted)
+ * 
+ * @param command A delay command from the command queue
+ */
+void delay_abort(command_t* command)
+{
+    clock_stop_timer(DELAY_TIMER);
+    count = 0;
+}
+
 /**
  * @brief Decrements a counter to effectivly do a busy wait
  */
 __interrupt void DELAY_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_DELAY, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(DELAY_TIMER);
 
@@ -77,7 +123,10 @@ __interrupt void DELAY_HANDLER(void)
     if (count == 0)
     {
         clock_stop_timer(DELAY_TIMER);
+        event_post(EVENT_DELAY);
     }
+
+    ISR_EXIT(TRACE_ISR_DELAY, 0);
 }
 
 /* End delay.c */
@@ -13,7 +13,10 @@
 
 #include "msp.h"
 #include "clock.h"
+#include "command_pool.h"
 #include "command_queue.h"
+#include "cpuload.h"
+#include "event.h"
 #include "utils.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -34,5 +37,8 @@ typedef struct delay_command_t {
 delay_command_t* delay_build_command(uint16_t time_ms);
 void delay_entry(command_t* command);
 bool delay_is_done(command_t* command);
+void delay_abort(command_t* command);
+void delay_start(uint16_t time_ms);
+bool delay_is_expired(void);
 
 #endif /* DELAY_H_ */
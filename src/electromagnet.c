@@ -15,6 +15,18 @@ void electromagnet_attract(void);
 void electromagnet_repel(void);
 void electromagnet_disengage(void);
 
+// Command operations (one table per command type, kept in flash)
+static const command_ops_t electromagnet_ops = {
+    .p_entry   = &electromagnet_entry,
+    .p_action  = &utils_empty_function,
+    .p_exit    = &utils_empty_function,
+    .p_is_done = &electromagnet_is_done,
+    .p_abort   = &utils_empty_function,
+    .resources = COMMAND_RESOURCE_MOTION | COMMAND_RESOURCE_MAGNET,
+    .events    = EVENT_NONE,
+    .id        = COMMAND_ID_ELECTROMAGNET
+};
+
 /**
  * @brief Initialize the electromagnet
  */
@@ -65,13 +77,14 @@ void electromagnet_disengage(void)
 electromagnet_command_t* electromagnet_build_command(peripheral_state_t desired_state)
 {
     // The thing to return
-    electromagnet_command_t* p_command = (electromagnet_command_t*) malloc(sizeof(electromagnet_command_t));
+    electromagnet_command_t* p_command = (electromagnet_command_t*) command_pool_alloc(sizeof(electromagnet_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &electromagnet_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &utils_empty_function;
-    p_command->command.p_is_done = &electromagnet_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &electromagnet_ops;
 
     // Data
     p_command->desired_state = desired_state;
@@ -88,8 +101,18 @@ void electromagnet_entry(command_t* command)
 {
     electromagnet_command_t* p_command = (electromagnet_command_t*) command;
 
+    electromagnet_set(p_command->desired_state);
+}
+
+/**
+ * @brief Enables or disables the electromagnet (used directly by commands which drive the magnet themselves)
+ *
+ * @param desired_state One of {enabled, disabled}
+ */
+void electromagnet_set(peripheral_state_t desired_state)
+{
     // Enable or disable the electromagnet as desired
-    if (p_command->desired_state == enabled)
+    if (desired_state == enabled)
     {
         electromagnet_attract();
     }
@@ -12,7 +12,9 @@
 #define ELECTROMAGNET_H_
 
 #include "msp.h"
+#include "command_pool.h"
 #include "command_queue.h"
+#include "event.h"
 #include "pwm.h"
 #include "utils.h"
 #include <stdint.h>
@@ -35,6 +37,7 @@ typedef struct electromagnet_command_t {
 
 // Public functions
 void electromagnet_init(void);
+void electromagnet_set(peripheral_state_t desired_state);
 
 // Command Functions
 electromagnet_command_t* electromagnet_build_command(peripheral_state_t desired_state);
@@ -0,0 +1,66 @@
+/**
+ * @file event.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Event flags posted by interrupts, so the main loop can sleep until something relevant happens
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "event.h"
+#include "cpuload.h"
+
+static volatile uint8_t event_flags = EVENT_NONE;
+
+/**
+ * @brief Posts events (safe to call from interrupts)
+ *
+ * @param events Mask of EVENT_*
+ */
+void event_post(uint8_t events)
+{
+    uint32_t primask = utils_enter_critical();
+    event_flags |= events;
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Takes (reads and clears) posted events
+ *
+ * @param mask The events to take
+ * @return The events in mask that had been posted
+ */
+uint8_t event_take(uint8_t mask)
+{
+    uint8_t events;
+    uint32_t primask = utils_enter_critical();
+
+    events = event_flags & mask;
+    event_flags &= ~mask;
+
+    utils_exit_critical(primask);
+    return events;
+}
+
+/**
+ * @brief Sleeps until the next interrupt, unless one of the given events has already been posted
+ *
+ * @param mask The events to check for
+ */
+void event_wait(uint8_t mask)
+{
+    uint32_t primask = utils_enter_critical();
+
+    if (!(event_flags & mask))
+    {
+        CPULOAD_IDLE_ENTER();
+        __WFI();
+        CPULOAD_IDLE_EXIT();
+    }
+
+    // The interrupt that woke the core runs here
+    utils_exit_critical(primask);
+}
+
+/* End event.c */
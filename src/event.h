@@ -0,0 +1,44 @@
+/**
+ * @file event.h
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Event flags posted by interrupts, so the main loop can sleep until something relevant happens
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+// Note on events:
+//  - Interrupts post EVENT_* flags, and the scheduler takes them all at the start of each pass
+//  - Each command declares the events that can change its is_done()/action() result. The scheduler only re-evaluates a
+//    command when one of its events arrived (or on the pass it starts). A command declaring EVENT_NONE is polled every pass
+//  - A spurious wake is harmless (the command is just re-evaluated), a missed one is not. Post an event whenever in doubt
+//  - event_wait() checks the flags with interrupts masked before WFI, so an event posted in between still wakes the core
+//    (a pending interrupt ends WFI even while masked, then runs once the mask is restored)
+
+#include "msp.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Events
+#define EVENT_NONE                  (0x00)
+#define EVENT_STEPPER               (0x01) // A stepper move finished
+#define EVENT_DELAY                 (0x02) // A delay expired
+#define EVENT_UART_RX               (0x04) // A byte was received (any channel)
+#define EVENT_SWITCH                (0x08) // A switch edge, or a flag set by the gantry interrupt
+#define EVENT_COMM_TIMEOUT          (0x10) // The Pi message resend timer expired
+#define EVENT_COMMAND               (0x20) // An interrupt posted a command or asked for the queue to be cleared
+#define EVENT_TICK                  (0x40) // The periodic gantry interrupt (for commands that sample hardware)
+#define EVENT_SCAN                  (0x80) // A board scan completed
+#define EVENT_ALL                   (0xFF)
+
+// Function definitions
+void event_post(uint8_t events);
+uint8_t event_take(uint8_t mask);
+void event_wait(uint8_t mask);
+
+#endif /* EVENT_H_ */
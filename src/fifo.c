@@ -31,8 +31,8 @@ void fifo8_init(fifo8_t* p_fifo)
  */
 bool fifo8_push(fifo8_t* p_fifo, FIFO8_TYPE value)
 {
-    // If the FIFO is full, return false
-    if (fifo8_get_size(p_fifo) == FIFO8_SIZE)
+    // If the FIFO is full, return false (one slot stays empty, so a full FIFO can be told apart from an empty one)
+    if (fifo8_get_size(p_fifo) == (FIFO8_SIZE - 1))
     {
         return false;
     }
@@ -99,7 +99,7 @@ uint16_t fifo8_get_size(fifo8_t* p_fifo)
     }
     else 
     {
-        return FIFO8_SIZE - (p_fifo->tail - p_fifo->head) + 1;
+        return FIFO8_SIZE - (p_fifo->tail - p_fifo->head);
     }
 }
 
@@ -13,11 +13,20 @@
 // Private functions
 static void gantry_kill(void);
 static void gantry_estop(void);
+static void gantry_push(command_t* p_command);
+static void gantry_emit(moveplanner_plan_t* p_plan);
+static void gantry_robot_banish_piece(moveplanner_plan_t* p_plan, chess_file_t file, chess_rank_t rank, chess_piece_t piece);
 
 // Stores the board readings, which are read in an interrupt and used in various commands
 uint64_t board_reading_current      = 0;
 uint64_t board_reading_intermediate = 0;
 
+// Motion envelopes
+const stepper_envelope_t gantry_travel_envelope = GANTRY_TRAVEL_ENVELOPE;
+const stepper_envelope_t gantry_carry_envelope  = GANTRY_CARRY_ENVELOPE;
+const stepper_envelope_t gantry_lift_envelope   = GANTRY_LIFT_ENVELOPE;
+const stepper_envelope_t gantry_lower_envelope  = GANTRY_LOWER_ENVELOPE;
+
 // Flags
 bool sys_fault                 = false;
 bool sys_reset                 = false;
@@ -27,13 +36,107 @@ static bool human_move_legal   = true;
 static bool human_move_capture = false;
 static bool human_move_done    = false;
 static bool initial_valid      = false;
+static bool human_capture_read = false;
+static bool human_turn_read    = false;
+
+#ifdef AUTO_TURN_ENABLED
+static autoturn_state_t human_turn_state = AUTOTURN_NONE;
+#endif
 static bool msg_ready_to_send  = true;
 static bool robot_is_done      = false;
 
+// The turn's metrics, held until the Tx FIFO has room for them
+static char metrics_message[METRICS_INSTR_LENGTH];
+static bool metrics_sent       = false;
+
+// Robot turns parked by dead reckoning since the last full re-home
+static uint8_t gantry_turns_since_home = 0;
+
 #ifdef THREE_PART_MODE
 static bool ready_to_read      = false;
 #endif
 
+// Instructions being received from the Pi (and the user, in THREE_PARTY_MODE)
+static rpi_frame_t gantry_rpi_frame;
+#ifdef THREE_PARTY_MODE
+static rpi_frame_t gantry_user_frame;
+#endif
+
+// Command operations (one table per command type, kept in flash)
+static const command_ops_t gantry_start_state_ops = {
+    .p_entry   = &gantry_start_state_entry,
+    .p_action  = &gantry_start_state_action,
+    .p_exit    = &gantry_start_state_exit,
+    .p_is_done = &gantry_start_state_is_done,
+    .p_abort   = &gantry_start_state_exit,
+    .resources = COMMAND_RESOURCE_MOTION | COMMAND_RESOURCE_SCAN,
+    .events    = EVENT_SCAN,
+    .id        = COMMAND_ID_START_STATE
+};
+static const command_ops_t gantry_reset_ops = {
+    .p_entry   = &gantry_reset_entry,
+    .p_action  = &utils_empty_function,
+    .p_exit    = &utils_empty_function,
+    .p_is_done = &gantry_reset_is_done,
+    .p_abort   = &utils_empty_function,
+    .resources = COMMAND_RESOURCE_ALL,
+    .events    = EVENT_NONE,
+    .id        = COMMAND_ID_RESET
+};
+static const command_ops_t gantry_human_ops = {
+    .p_entry   = &gantry_human_entry,
+    .p_action  = &gantry_human_action,
+    .p_exit    = &gantry_human_exit,
+    .p_is_done = &gantry_human_is_done,
+    .p_abort   = &utils_empty_function,
+    .resources = COMMAND_RESOURCE_ALL,
+    .events    = EVENT_SWITCH | EVENT_UART_RX | EVENT_SCAN,
+    .id        = COMMAND_ID_HUMAN
+};
+static const command_ops_t gantry_comm_ops = {
+    .p_entry   = &gantry_comm_entry,
+    .p_action  = &gantry_comm_action,
+    .p_exit    = &gantry_comm_exit,
+    .p_is_done = &gantry_comm_is_done,
+    .p_abort   = &gantry_comm_exit,
+    .resources = COMMAND_RESOURCE_RPI,
+    .after     = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_UART_RX | EVENT_COMM_TIMEOUT,
+    .id        = COMMAND_ID_COMM
+};
+static const command_ops_t gantry_robot_ops = {
+    .p_entry   = &gantry_robot_entry,
+    .p_action  = &gantry_robot_action,
+    .p_exit    = &gantry_robot_exit,
+    .p_is_done = &gantry_robot_is_done,
+    .p_abort   = &utils_empty_function,
+    .resources = COMMAND_RESOURCE_RPI,
+    .after     = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_UART_RX,
+    .id        = COMMAND_ID_ROBOT
+};
+static const command_ops_t gantry_home_ops = {
+    .p_entry   = &gantry_home_entry,
+    .p_action  = &utils_empty_function,
+    .p_exit    = &utils_empty_function,
+    .p_is_done = &gantry_home_is_done,
+    .p_abort   = &utils_empty_function,
+    .resources = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_NONE,
+    .id        = COMMAND_ID_HOME
+};
+static const command_ops_t gantry_metrics_ops = {
+    .p_entry   = &gantry_metrics_entry,
+    .p_action  = &gantry_metrics_action,
+    .p_exit    = &utils_empty_function,
+    .p_is_done = &gantry_metrics_is_done,
+    .p_abort   = &utils_empty_function,
+    .resources = COMMAND_RESOURCE_RPI,
+    .after     = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_NONE,
+    .id        = COMMAND_ID_METRICS
+};
+
 /**
  * @brief Initializes all modules
  */
@@ -49,10 +152,15 @@ void gantry_init(void)
     clock_timer5a_init();               // Delay
     clock_timer6a_init();               // LEDs
     clock_timer7c_init();               // Comm delay
+    clock_cycle_counter_init();         // Tracing
+    clock_systick_init();               // Board scan
     clock_start_timer(GANTRY_TIMER);
 
     // System level initialization of all other modules
     command_queue_init();
+    trace_init();
+    cpuload_init();
+    metrics_init();
     led_init();
     rpi_init();
     chessboard_init();
@@ -74,26 +182,55 @@ void gantry_init(void)
  */
 void gantry_home(void)
 {
+    static const stepper_envelope_t homing_backoff_envelopes[NUMBER_OF_STEPPER_MOTORS] = {
+        {HOMING_X_VELOCITY, HOMING_X_VELOCITY, 0},
+        {HOMING_Y_VELOCITY, HOMING_Y_VELOCITY, 0},
+        {HOMING_Z_VELOCITY, HOMING_Z_VELOCITY, 0}
+    };
+
+    // Position is exact again after homing
+    gantry_turns_since_home = 0;
+
     // Set the homing flag
-    command_queue_push((command_t*) gantry_home_build_command());
+    gantry_push((command_t*) gantry_home_build_command());
 
-    // Home the motors with delay
-    command_queue_push((command_t*) stepper_build_home_z_command());
-    command_queue_push((command_t*) stepper_build_home_xy_command());
-    command_queue_push((command_t*) delay_build_command(HOMING_DELAY_MS));
+    // Home the motors (each homing command settles on its limit switches before finishing)
+    gantry_push((command_t*) stepper_build_home_z_command());
+    gantry_push((command_t*) stepper_build_home_xy_command());
 
     // Back away from the edge
-    command_queue_push((command_t*) stepper_build_rel_command(
+    gantry_push((command_t*) stepper_build_rel_command(
         HOMING_X_BACKOFF,
         HOMING_Y_BACKOFF,
         HOMING_Z_BACKOFF,
-        HOMING_X_VELOCITY,
-        HOMING_Y_VELOCITY,
-        HOMING_Z_VELOCITY
+        &homing_backoff_envelopes[STEPPER_X_ID],
+        &homing_backoff_envelopes[STEPPER_Y_ID],
+        &homing_backoff_envelopes[STEPPER_Z_ID],
+        STEPPER_MOTION_INDEPENDENT
     ));
 
     // Clear the homing flag
-    command_queue_push((command_t*) gantry_home_build_command());
+    gantry_push((command_t*) gantry_home_build_command());
+}
+
+/**
+ * @brief Parks the gantry after a robot turn (see GANTRY_PARK_MODE), re-homing every GANTRY_REHOME_INTERVAL turns or after a fault
+ */
+void gantry_park(void)
+{
+    // Step position is tracked by dead reckoning, so re-home periodically and whenever a driver reports a fault
+    gantry_turns_since_home++;
+    if ((GANTRY_PARK_MODE == GANTRY_PARK_REHOME) || (gantry_turns_since_home >= GANTRY_REHOME_INTERVAL) ||
+        stepper_x_has_fault() || stepper_y_has_fault() || stepper_z_has_fault())
+    {
+        gantry_home();
+        return;
+    }
+
+#if (GANTRY_PARK_MODE == GANTRY_PARK_OFF_BOARD)
+    // Get out of the way of the board (every move already ends with Z raised to HOME_PIECE)
+    gantry_push((command_t*) stepper_build_chess_xy_command(HOME_FILE, HOME_RANK, &gantry_travel_envelope, &gantry_travel_envelope, STEPPER_MOTION_COORDINATED));
+#endif
 }
 
 /**
@@ -109,8 +246,8 @@ static void gantry_kill(void)
     // Turn on the error LED
     led_mode(LED_ERROR);
 
-    // Clear the command queue (just in case)
-    command_queue_clear();
+    // Clear the command queue (just in case). This runs in an interrupt, so the main loop does the clearing
+    command_queue_request_clear();
 }
 
 /**
@@ -124,6 +261,33 @@ static void gantry_estop(void)
     sys_fault = true;
 }
 
+/**
+ * @brief Adds a command to the queue. Faults the system if it could not be built (pool exhausted) or the queue is full
+ *
+ * @param p_command The command (may be NULL, if it could not be built)
+ */
+static void gantry_push(command_t* p_command)
+{
+    if (!command_queue_push(p_command))
+    {
+        command_pool_free(p_command);
+        gantry_estop();
+    }
+}
+
+/**
+ * @brief Adds a plan's motion program to the queue. Faults the system if it could not be queued
+ *
+ * @param p_plan The plan to emit
+ */
+static void gantry_emit(moveplanner_plan_t* p_plan)
+{
+    if (!moveplanner_emit(p_plan))
+    {
+        gantry_estop();
+    }
+}
+
 /* Command Functions */
 
 /**
@@ -134,13 +298,14 @@ static void gantry_estop(void)
 gantry_command_t* gantry_start_state_build_command(void)
 {
     // The thing to return
-    gantry_command_t* p_command = (gantry_command_t*) malloc(sizeof(gantry_command_t));
+    gantry_command_t* p_command = (gantry_command_t*) command_pool_alloc(sizeof(gantry_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_start_state_entry;
-    p_command->command.p_action  = &gantry_start_state_action;
-    p_command->command.p_exit    = &gantry_start_state_exit;
-    p_command->command.p_is_done = &gantry_start_state_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_start_state_ops;
 
     return (gantry_command_t*) p_command;
 }
@@ -162,8 +327,13 @@ void gantry_start_state_entry(command_t* command)
  */
 void gantry_start_state_action(command_t* command)
 {
-    // Read the board's initial state
-    uint64_t initial_presence = sensornetwork_get_reading();
+    // Wait for the board to settle
+    uint64_t initial_presence = 0;
+    if (!sensornetwork_get_stable_snapshot(&initial_presence))
+    {
+        return;
+    }
+
     uint64_t initial_presence_white = initial_presence & (chessboard_get_previous_white_presence());
     uint64_t initial_presence_black = initial_presence & (chessboard_get_previous_black_presence());
 
@@ -213,13 +383,14 @@ bool gantry_start_state_is_done(command_t* command)
 gantry_command_t* gantry_reset_build_command(void)
 {
     // The thing to return
-    gantry_command_t* p_command = (gantry_command_t*) malloc(sizeof(gantry_command_t));
+    gantry_command_t* p_command = (gantry_command_t*) command_pool_alloc(sizeof(gantry_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_reset_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &utils_empty_function;
-    p_command->command.p_is_done = &gantry_reset_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_reset_ops;
 
     return (gantry_command_t*) p_command;
 }
@@ -237,11 +408,14 @@ void gantry_reset_entry(command_t* command)
     // Indicate that the Pi's not up yet
     led_mode(LED_ROBOT_MOVE);
 
-    // Home the motors
+    // Home the motors (a preempted homing sequence may have left the homing flag set)
+    gantry_homing = false;
     gantry_home();
 
-    // Reset the chess board
+    // Reset the chess board, empty the graveyard and release any motion programs
     chessboard_reset_all();
+    graveyard_reset();
+    motionprogram_reset();
 
     // Reset the rpi
     rpi_reset_uart();
@@ -260,7 +434,7 @@ void gantry_reset_entry(command_t* command)
     uint16_t switch_data = switch_get_reading();
 
     // Wait for a valid start state
-    command_queue_push((command_t*) gantry_start_state_build_command());
+    gantry_push((command_t*) gantry_start_state_build_command());
 
     // Start the game
     if (switch_data & TOGGLE_MASK)
@@ -270,20 +444,20 @@ void gantry_reset_entry(command_t* command)
 
         char message[START_INSTR_LENGTH];
         rpi_build_start_msg(user_color, message);
-        command_queue_push((command_t*) gantry_comm_build_command(message, START_INSTR_LENGTH));
+        gantry_push((command_t*) gantry_comm_build_command(message, START_INSTR_LENGTH));
 
         // After receiving an ACK, goto human command
-        command_queue_push((command_t*) gantry_human_build_command());
+        gantry_push((command_t*) gantry_human_build_command());
     } else {
         // User is white, start in gantry_human
         user_color = 'B';
 
         char message[START_INSTR_LENGTH];
         rpi_build_start_msg(user_color, message);
-        command_queue_push((command_t*) gantry_comm_build_command(message, START_INSTR_LENGTH));
+        gantry_push((command_t*) gantry_comm_build_command(message, START_INSTR_LENGTH));
 
         // After receiving an ACK, goto robot command
-        command_queue_push((command_t*) gantry_robot_build_command());
+        gantry_push((command_t*) gantry_robot_build_command());
 
         // Do not check for a valid initial state
         human_move_legal = true;
@@ -297,10 +471,10 @@ void gantry_reset_entry(command_t* command)
 
     char message[START_INSTR_LENGTH];
     rpi_build_start_msg(user_color, message);
-    command_queue_push((command_t*) gantry_comm_build_command(message, START_INSTR_LENGTH));
+    gantry_push((command_t*) gantry_comm_build_command(message, START_INSTR_LENGTH));
 
     // After receiving an ACK, goto human command
-    command_queue_push((command_t*) gantry_human_build_command());
+    gantry_push((command_t*) gantry_human_build_command());
 #endif
 }
 
@@ -323,23 +497,25 @@ gantry_command_t* gantry_human_build_command(void)
 {
 #ifdef FINAL_IMPLEMENTATION_MODE
     // The thing to return
-    gantry_command_t* p_command = (gantry_command_t*) malloc(sizeof(gantry_command_t));
+    gantry_command_t* p_command = (gantry_command_t*) command_pool_alloc(sizeof(gantry_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_human_entry;
-    p_command->command.p_action  = &gantry_human_action;
-    p_command->command.p_exit    = &gantry_human_exit;
-    p_command->command.p_is_done = &gantry_human_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_human_ops;
 
 #elif defined(THREE_PARTY_MODE)
     // The thing to return
-    gantry_robot_command_t* p_command = (gantry_robot_command_t*) malloc(sizeof(gantry_robot_command_t));
+    gantry_robot_command_t* p_command = (gantry_robot_command_t*) command_pool_alloc(sizeof(gantry_robot_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_human_entry;
-    p_command->command.p_action  = &gantry_human_action;
-    p_command->command.p_exit    = &gantry_human_exit;
-    p_command->command.p_is_done = &gantry_human_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_human_ops;
 
     // Data
     p_command->move.source_file = FILE_ERROR;
@@ -378,9 +554,20 @@ void gantry_human_entry(command_t* command)
     // Reset the flags
     human_move_capture = false;
     human_move_done    = false;
+    human_capture_read = false;
+    human_turn_read    = false;
+
+    // A new turn starts
+    metrics_clear();
+
+#ifdef AUTO_TURN_ENABLED
+    human_turn_state = AUTOTURN_NONE;
+    autoturn_start();
+#endif
 
 #ifdef THREE_PARTY_MODE
     ready_to_read      = false;
+    rpi_frame_init(&gantry_user_frame, USER_CHANNEL);
 #endif
 }
 
@@ -391,8 +578,34 @@ void gantry_human_entry(command_t* command)
  */
 void gantry_human_action(command_t* command)
 {
-#ifdef FINAL_IMPLEMENTATION_MODE
-    return; // Not used in final implementation
+#if defined(FINAL_IMPLEMENTATION_MODE) && defined(AUTO_TURN_ENABLED)
+    // Watch the board until it holds a single move for long enough
+    autoturn_state_t turn_state = autoturn_update(&human_move_capture, &board_reading_intermediate, &board_reading_current);
+
+    // Time the inference from the move's final position first appearing
+    if ((turn_state == AUTOTURN_SETTLING) && (human_turn_state == AUTOTURN_NONE))
+    {
+        metrics_start(METRICS_PHASE_SCAN);
+    }
+    human_turn_state = turn_state;
+
+    if (turn_state == AUTOTURN_DONE)
+    {
+        human_move_done    = true;
+        human_capture_read = true;
+        human_turn_read    = true;
+    }
+#elif defined(FINAL_IMPLEMENTATION_MODE)
+    // Take the readings once the board is stable (usually right away, unless a hand is still over it)
+    if (human_move_capture && (!human_capture_read))
+    {
+        human_capture_read = sensornetwork_get_stable_snapshot(&board_reading_intermediate);
+    }
+
+    if (human_move_done && (!human_turn_read))
+    {
+        human_turn_read = sensornetwork_get_stable_snapshot(&board_reading_current);
+    }
 #elif defined(THREE_PARTY_MODE)
     if (!ready_to_read) {
         return;
@@ -400,33 +613,15 @@ void gantry_human_action(command_t* command)
 
     gantry_robot_command_t* p_gantry_command = (gantry_robot_command_t*) command; // WHY IS THIS A ROBOT COMMAND!?!?!
 
-    char message[9];
-    char move[5];
-    char check_bytes[2];
-    bool msg_status = false;
-
-    // Read the START byte
-    msg_status = uart_read_byte(USER_CHANNEL, (uint8_t*) &message[0]);
-    if ((!msg_status) || (message[0] != START_BYTE))
+    // Handle every instruction received so far (never waits, the action runs again when more bytes arrive)
+    while ((!human_move_done) && rpi_receive_frame(&gantry_user_frame))
     {
-        return;
-    }
+        char* message = gantry_user_frame.data;
+        uint8_t instruction = message[1] >> 4;                      // Shift to remove the LENGTH portion from this section of this message
 
-    // Read the INSTRUCTION byte
-    msg_status = uart_read_byte(USER_CHANNEL, (uint8_t*) &message[1]);
-    uint8_t instruction = message[1] >> 4;                          // Shift to remove the LENGTH portion from this section of this message
-    if ((!msg_status) || (instruction != HUMAN_MOVE_INSTR))
-    {
-        // If the RPi responded "illegal move", receive the rest of the message, then short circuit to robot_is_done
+        // If the RPi responded "illegal move", short circuit to robot_is_done
         if (instruction == ILLEGAL_MOVE_INSTR)
         {
-            // Read the CHECK BYTES data and validate the transmission
-            msg_status = uart_read_string(USER_CHANNEL, check_bytes, 2);
-            if ((!msg_status) || (!utils_validate_transmission((uint8_t *) message, 2, check_bytes)))
-            {
-                return;
-            }
-
             // No ACK's
 
             // Turn on the error LED
@@ -436,43 +631,24 @@ void gantry_human_action(command_t* command)
             human_move_legal = false;
             p_gantry_command->move.move_type = IDLE;
             robot_is_done = true;
+            continue;
         }
-        return;
-    }
 
-    // Read the MOVE bytes
-    msg_status = uart_read_string(USER_CHANNEL, move, 5);
-    if (!msg_status)
-    {
-        return;
-    }
-    message[2] = move[0];
-    message[3] = move[1];
-    message[4] = move[2];
-    message[5] = move[3];
-    message[6] = move[4];
+        // No GAME STATUS byte
+        if ((uint8_t) message[1] != HUMAN_MOVE_INSTR_AND_LEN)
+        {
+            continue;
+        }
 
-    // No GAME STATUS byte
+        // At this point, the full message was received properly. Store the UCI for the Comm command
+        p_gantry_command->move_uci[0] = message[2];
+        p_gantry_command->move_uci[1] = message[3];
+        p_gantry_command->move_uci[2] = message[4];
+        p_gantry_command->move_uci[3] = message[5];
+        p_gantry_command->move_uci[4] = message[6];
 
-    // Read the CHECK BYTES data and validate the transmission
-    msg_status = uart_read_string(USER_CHANNEL, &check_bytes[0], 2);
-    if ((!msg_status) || (!utils_validate_transmission((uint8_t *) message, 7, check_bytes)))
-    {
-        return;
+        human_move_done = true;
     }
-
-    // At this point, the full message was received properly. Copy the check bytes and transmit to the RPi    
-    message[7] = check_bytes[0];
-    message[8] = check_bytes[1];
-
-    // Store the UCI for the Comm command
-    p_gantry_command->move_uci[0] = move[0];
-    p_gantry_command->move_uci[1] = move[1];
-    p_gantry_command->move_uci[2] = move[2];
-    p_gantry_command->move_uci[3] = move[3];
-    p_gantry_command->move_uci[4] = move[4];
-
-    human_move_done = true;
 #endif
 }
 
@@ -500,7 +676,7 @@ void gantry_human_exit(command_t* command)
     }
 
     human_move_legal &= chessboard_update_current_board_from_presence(board_reading_current, move, human_move_capture);
-
+    metrics_stop(METRICS_PHASE_SCAN);
 
     // If the move was roughly legal, prepare to transmit. Otherwise, turn on the error LED and wait for a new move
     if (human_move_legal)
@@ -508,8 +684,8 @@ void gantry_human_exit(command_t* command)
         // Place the gantry_comm command on the queue to send the message
         char message[HUMAN_MOVE_INSTR_LENGTH];
         rpi_build_human_move_msg(move, message);
-        command_queue_push((command_t*) gantry_comm_build_command(message, HUMAN_MOVE_INSTR_LENGTH));
-        command_queue_push((command_t*) gantry_robot_build_command());
+        gantry_push((command_t*) gantry_comm_build_command(message, HUMAN_MOVE_INSTR_LENGTH));
+        gantry_push((command_t*) gantry_robot_build_command());
 
         // Prepare to send the COMM message
         msg_ready_to_send = true;
@@ -520,10 +696,11 @@ void gantry_human_exit(command_t* command)
         led_mode(LED_ERROR);
         
         // Place the gantry_human command on the queue until a legal move is given
-        command_queue_push((command_t*) gantry_human_build_command());
+        gantry_push((command_t*) gantry_human_build_command());
 
         // Clear the flags
         human_move_capture = false;
+        human_capture_read = false;
     }
 
 #elif defined(THREE_PARTY_MODE)
@@ -532,12 +709,13 @@ void gantry_human_exit(command_t* command)
     // Update local board state
     chessboard_update_current_board_from_previous_board();
     chessboard_update_current_board_from_move(p_gantry_command->move_uci);
+    metrics_stop(METRICS_PHASE_SCAN);
 
     // Place the gantry_comm command on the queue to send the message
     char message[HUMAN_MOVE_INSTR_LENGTH];
     rpi_build_human_move_msg(p_gantry_command->move_uci, message);
-    command_queue_push((command_t*) gantry_comm_build_command(message, HUMAN_MOVE_INSTR_LENGTH));
-    command_queue_push((command_t*) gantry_robot_build_command());
+    gantry_push((command_t*) gantry_comm_build_command(message, HUMAN_MOVE_INSTR_LENGTH));
+    gantry_push((command_t*) gantry_robot_build_command());
 
     // Prepare to send the COMM message
     human_move_legal = true;
@@ -553,7 +731,12 @@ void gantry_human_exit(command_t* command)
  */
 bool gantry_human_is_done(command_t* command)
 {
+#ifdef FINAL_IMPLEMENTATION_MODE
+    // The readings must have been collected too
+    return human_move_done && human_turn_read && ((!human_move_capture) || human_capture_read);
+#else
     return human_move_done;
+#endif
 }
 
 /**
@@ -566,13 +749,14 @@ bool gantry_human_is_done(command_t* command)
 gantry_comm_command_t* gantry_comm_build_command(char* message, uint8_t message_length)
 {
     // The thing to return
-    gantry_comm_command_t* p_command = (gantry_comm_command_t*) malloc(sizeof(gantry_comm_command_t));
+    gantry_comm_command_t* p_command = (gantry_comm_command_t*) command_pool_alloc(sizeof(gantry_comm_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_comm_entry;
-    p_command->command.p_action  = &gantry_comm_action;
-    p_command->command.p_exit    = &gantry_comm_exit;
-    p_command->command.p_is_done = &gantry_comm_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_comm_ops;
 
     // The move to be sent
     uint8_t i = 0;
@@ -597,7 +781,8 @@ void gantry_comm_entry(command_t* command)
     // Indicate we're talking to the pi
     led_mode(LED_WAITING_FOR_MSG);
 
-    // Send the message
+    // Send the message (if the Tx FIFO has no room for it, the timeout sends it again)
+    metrics_start(METRICS_PHASE_COMM);
     rpi_transmit(p_gantry_command->message, p_gantry_command->message_length);
 
     // Do not resend the message until the interrupt sets send_msg
@@ -641,6 +826,10 @@ void gantry_comm_exit(command_t* command)
     // Stop and reset the timer
     clock_stop_timer(COMM_TIMER);
     clock_reset_timer_value(COMM_TIMER);
+
+    // The Pi has the message, and starts thinking
+    metrics_stop(METRICS_PHASE_COMM);
+    metrics_start(METRICS_PHASE_ENGINE);
 }
 
 /**
@@ -669,13 +858,14 @@ bool gantry_comm_is_done(command_t* command)
 gantry_robot_command_t* gantry_robot_build_command(void)
 {
     // The thing to return
-    gantry_robot_command_t* p_command = (gantry_robot_command_t*) malloc(sizeof(gantry_robot_command_t));
+    gantry_robot_command_t* p_command = (gantry_robot_command_t*) command_pool_alloc(sizeof(gantry_robot_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_robot_entry;
-    p_command->command.p_action  = &gantry_robot_action;
-    p_command->command.p_exit    = &gantry_robot_exit;
-    p_command->command.p_is_done = &gantry_robot_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_robot_ops;
 
     // Data
     p_command->move.source_file = FILE_ERROR;
@@ -713,6 +903,9 @@ void gantry_robot_entry(command_t* command)
     gantry_robot_move_cmd->move.dest_file   = FILE_ERROR;
     gantry_robot_move_cmd->move.dest_rank   = RANK_ERROR;
     gantry_robot_move_cmd->move.move_type   = IDLE;
+
+    // Start listening for the reply (the ACK has already been taken by the comm command)
+    rpi_frame_init(&gantry_rpi_frame, RPI_UART_CHANNEL);
 }
 
 /**
@@ -725,34 +918,21 @@ void gantry_robot_action(command_t* command)
     gantry_robot_command_t* p_gantry_command = (gantry_robot_command_t*) command;
     uint8_t status_after_human = 0;
     uint8_t status_after_robot = 0;
-    char move[5];
-    char message[8];
-    char check_bytes[2];
-    bool msg_status = false;
+    char* move;
+    char* message = gantry_rpi_frame.data;
+    uint8_t instruction = 0;
+    bool move_received = false;
 
-    // Read the START byte
-    msg_status = rpi_receive(&message[0], 1);
-    if ((!msg_status) || (message[0] != START_BYTE))
+    // Handle every instruction received so far (never waits, the action runs again when more bytes arrive)
+    while ((!robot_is_done) && rpi_receive_frame(&gantry_rpi_frame))
     {
-        return;
-    }
+        instruction = message[1] >> 4;                              // Shift to remove the LENGTH portion from this section of this message
 
-    // Read the INSTRUCTION byte
-    msg_status = rpi_receive(&message[1], 1);
-    uint8_t instruction = message[1] >> 4;                          // Shift to remove the LENGTH portion from this section of this message
-    if ((!msg_status) || (instruction != ROBOT_MOVE_INSTR))
-    {
-        // If the RPi responded "illegal move", receive the rest of the message, then short circuit to robot_is_done
+        // If the RPi responded "illegal move", short circuit to robot_is_done
         if (instruction == ILLEGAL_MOVE_INSTR)
         {
-            // Read the CHECK BYTES data and validate the transmission
-            msg_status = rpi_receive(check_bytes, 2);
-            if ((!msg_status) || (!utils_validate_transmission((uint8_t *) message, 2, check_bytes)))
-            {
-                return;
-            }
-
             // Transmit an ACK
+            metrics_stop(METRICS_PHASE_ENGINE);
             rpi_transmit_ack();
 
             // Turn on the error LED
@@ -762,37 +942,43 @@ void gantry_robot_action(command_t* command)
             p_gantry_command->move.move_type = IDLE;
             human_move_legal = false;
             robot_is_done = true;
+            return;
         }
-        return;
-    }
 
-    // Read the MOVE bytes
-    msg_status = rpi_receive(move, 5);
-    if (!msg_status)
-    {
-        return;
-    }
-    message[2] = move[0];
-    message[3] = move[1];
-    message[4] = move[2];
-    message[5] = move[3];
-    message[6] = move[4];
-
-    // Read the GAME STATUS byte
-    msg_status = rpi_receive(&message[7], 1);
-    if (!msg_status)
-    {
-        return;
+        // If the RPi asked for the trace, send it (keep waiting for the move afterwards)
+        if (instruction == TRACE_INSTR)
+        {
+            // Transmit an ACK, then the trace
+            rpi_transmit_ack();
+            rpi_transmit_trace();
+            continue;
+        }
+
+        // If the RPi asked for the CPU load, send it (keep waiting for the move afterwards)
+        if (instruction == LOAD_INSTR)
+        {
+            // Transmit an ACK, then the load
+            rpi_transmit_ack();
+            rpi_transmit_cpuload();
+            continue;
+        }
+
+        // The MOVE bytes, then the GAME STATUS byte
+        if ((uint8_t) message[1] == ROBOT_MOVE_INSTR_AND_LEN)
+        {
+            move_received = true;
+            break;
+        }
     }
 
-    // Read the CHECK BYTES data and validate the transmission
-    msg_status = rpi_receive(&check_bytes[0], 2);
-    if ((!msg_status) || (!utils_validate_transmission((uint8_t *) message, 8, check_bytes)))
+    if (!move_received)
     {
         return;
     }
+    move = &message[2];
 
     // At this point, the full message was received properly. Transmit an ACK
+    metrics_stop(METRICS_PHASE_ENGINE);
     rpi_transmit_ack();
 
     // Since the human move was legal, we can update the previous board 
@@ -857,6 +1043,24 @@ void gantry_robot_action(command_t* command)
     robot_is_done = true;
 }
 
+/**
+ * @brief Helper function to plan moving a captured piece from the board to the closest free graveyard slot
+ *
+ * @param p_plan The plan to add the relocation to
+ * @param file The file the piece is leaving
+ * @param rank The rank the piece is leaving
+ * @param piece The piece being captured
+ */
+static void gantry_robot_banish_piece(moveplanner_plan_t* p_plan, chess_file_t file, chess_rank_t rank, chess_piece_t piece)
+{
+    chess_file_t slot_file;
+    chess_rank_t slot_rank;
+
+    // Falls back to the capture point once the graveyard is full
+    graveyard_allocate_slot(file, rank, &slot_file, &slot_rank);
+    moveplanner_add(p_plan, file, rank, slot_file, slot_rank, piece);
+}
+
 /**
  * @brief Helper function to move the specified piece from the initial position to the final position
  * 
@@ -868,45 +1072,12 @@ void gantry_robot_action(command_t* command)
  */
 void gantry_robot_move_piece(chess_file_t initial_file, chess_rank_t initial_rank, chess_file_t final_file, chess_rank_t final_rank, chess_piece_t piece)
 {
-    // Check for errors
-    if ((initial_file == FILE_ERROR) || (initial_rank == RANK_ERROR) || (final_file == FILE_ERROR) || (final_rank == RANK_ERROR))
-    {
-        return;
-    }
-
-    // Go to the source tile
-    command_queue_push((command_t*) stepper_build_chess_xy_command(initial_file, initial_rank, MOTORS_MOVE_V_X, MOTORS_MOVE_V_Y));
-
-#ifdef PERIPHERALS_ENABLED
-    // Engage the magnet
-    command_queue_push((command_t*) electromagnet_build_command(enabled));
-#endif
+    moveplanner_plan_t plan;
 
-    // Lower the magnet
-    command_queue_push((command_t*) stepper_build_chess_z_command(piece, MOTORS_MOVE_V_Z));
-
-    // Wait
-    command_queue_push((command_t*) delay_build_command(1000));
-
-    // Raise the magnet
-    command_queue_push((command_t*) stepper_build_chess_z_command(HOME_PIECE, MOTORS_MOVE_V_Z));
-
-    // Go to the destination tile
-    command_queue_push((command_t*) stepper_build_chess_xy_command(final_file, final_rank, MOTORS_MOVE_V_X, MOTORS_MOVE_V_Y));
-
-    // Lower the magnet
-    command_queue_push((command_t*) stepper_build_chess_z_command(piece, MOTORS_MOVE_V_Z));
-
-#ifdef PERIPHERALS_ENABLED
-    // Disengage the magnet
-    command_queue_push((command_t*) electromagnet_build_command(disabled));
-#endif
-
-    // Wait
-    command_queue_push((command_t*) delay_build_command(500));
-
-    // Raise the magnet
-    command_queue_push((command_t*) stepper_build_chess_z_command(HOME_PIECE, MOTORS_MOVE_V_Z));
+    // A single relocation (invalid positions are dropped by the planner)
+    moveplanner_init(&plan);
+    moveplanner_add(&plan, initial_file, initial_rank, final_file, final_rank, piece);
+    gantry_emit(&plan);
 }
 
 /**
@@ -929,20 +1100,26 @@ void gantry_robot_exit(command_t* command)
     {
         // Turn on the error LED and go back to human move
         led_mode(LED_ERROR);
-        command_queue_push((command_t*) gantry_human_build_command());
+        gantry_push((command_t*) gantry_human_build_command());
         return;
     }
+
+    // Time the motion (up to the metrics command, which waits for it to finish)
+    metrics_start(METRICS_PHASE_MOTION);
     
-    // Load commands based on the move that the RPi sent
+    // Load commands based on the move that the RPi sent (the planner picks the order the pieces move in)
     chess_move_t rook_move;
     chess_piece_t moving_piece;
+    moveplanner_plan_t plan;
+    moveplanner_init(&plan);
 
     switch (p_gantry_command->move.move_type)
     {
         case MOVE:
             // Make the move
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.source_file, p_gantry_command->move.source_rank);
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 p_gantry_command->move.source_file,
                 p_gantry_command->move.source_rank,
                 p_gantry_command->move.dest_file,
@@ -950,24 +1127,25 @@ void gantry_robot_exit(command_t* command)
                 moving_piece
             );
 
-            // Go to home
-            gantry_home();
+            // Run the relocations in the fastest order, then park until the next turn
+            gantry_emit(&plan);
+            gantry_park();
         break;
 
         case PROMOTION:
             // Banish the source pawn to the graveyard
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.source_file, p_gantry_command->move.source_rank);
-            gantry_robot_move_piece(
+            gantry_robot_banish_piece(
+                &plan,
                 p_gantry_command->move.source_file,
                 p_gantry_command->move.source_rank,
-                CAPTURE_FILE,
-                CAPTURE_RANK,
                 moving_piece
             );
 
             // Revive the queen from the magical **queen tile** and move it to the destination
             moving_piece = QUEEN;
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 QUEEN_FILE,
                 QUEEN_RANK,
                 p_gantry_command->move.dest_file,
@@ -975,34 +1153,34 @@ void gantry_robot_exit(command_t* command)
                 moving_piece
             );
 
-            // Go to home
-            gantry_home();
+            // Run the relocations in the fastest order, then park until the next turn
+            gantry_emit(&plan);
+            gantry_park();
         break;
 
         case CAPTURE_PROMOTION:
             // Banish the piece being captured to the graveyard
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.dest_file, p_gantry_command->move.dest_rank);
-            gantry_robot_move_piece(
+            gantry_robot_banish_piece(
+                &plan,
                 p_gantry_command->move.dest_file,
                 p_gantry_command->move.dest_rank,
-                CAPTURE_FILE,
-                CAPTURE_RANK,
                 moving_piece
             );
 
             // Banish the piece being captured to the graveyard
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.source_file, p_gantry_command->move.source_rank);
-            gantry_robot_move_piece(
+            gantry_robot_banish_piece(
+                &plan,
                 p_gantry_command->move.source_file,
                 p_gantry_command->move.source_rank,
-                CAPTURE_FILE,
-                CAPTURE_RANK,
                 moving_piece
             );
 
             // Revive the queen from the magical **queen tile** and move it to the destination
             moving_piece = QUEEN;
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 QUEEN_FILE,
                 QUEEN_RANK,
                 p_gantry_command->move.dest_file,
@@ -1010,24 +1188,25 @@ void gantry_robot_exit(command_t* command)
                 moving_piece
             );
 
-            // Go to home
-            gantry_home();
+            // Run the relocations in the fastest order, then park until the next turn
+            gantry_emit(&plan);
+            gantry_park();
         break;
 
         case CAPTURE:
             // Banish the piece being captured to the graveyard
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.dest_file, p_gantry_command->move.dest_rank);
-            gantry_robot_move_piece(
+            gantry_robot_banish_piece(
+                &plan,
                 p_gantry_command->move.dest_file,
                 p_gantry_command->move.dest_rank,
-                CAPTURE_FILE,
-                CAPTURE_RANK,
                 moving_piece
             );
 
             // Make the move
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.source_file, p_gantry_command->move.source_rank);
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 p_gantry_command->move.source_file,
                 p_gantry_command->move.source_rank,
                 p_gantry_command->move.dest_file,
@@ -1035,14 +1214,16 @@ void gantry_robot_exit(command_t* command)
                 moving_piece
             );
 
-            // Go to home
-            gantry_home();
+            // Run the relocations in the fastest order, then park until the next turn
+            gantry_emit(&plan);
+            gantry_park();
         break;
 
         case CASTLING:
             // Move the king
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.source_file, p_gantry_command->move.source_rank);
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 p_gantry_command->move.source_file,
                 p_gantry_command->move.source_rank,
                 p_gantry_command->move.dest_file,
@@ -1055,7 +1236,8 @@ void gantry_robot_exit(command_t* command)
 
             // Move the rook
             moving_piece = ROOK;
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 rook_move.source_file,
                 rook_move.source_rank,
                 rook_move.dest_file,
@@ -1063,8 +1245,9 @@ void gantry_robot_exit(command_t* command)
                 moving_piece
             );
 
-            // Go to home
-            gantry_home();
+            // Run the relocations in the fastest order, then park until the next turn
+            gantry_emit(&plan);
+            gantry_park();
         break;
 
         case EN_PASSENT:
@@ -1072,17 +1255,17 @@ void gantry_robot_exit(command_t* command)
             
             // Banish the piece being captured to the graveyard
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.dest_file, p_gantry_command->move.dest_rank);
-            gantry_robot_move_piece(
+            gantry_robot_banish_piece(
+                &plan,
                 p_gantry_command->move.dest_file,
                 p_gantry_command->move.source_rank,
-                CAPTURE_FILE,
-                CAPTURE_RANK,
                 moving_piece
             );
 
             // Make the move
             moving_piece = chessboard_get_piece_at_position(p_gantry_command->move.source_file, p_gantry_command->move.source_rank);
-            gantry_robot_move_piece(
+            moveplanner_add(
+                &plan,
                 p_gantry_command->move.source_file,
                 p_gantry_command->move.source_rank,
                 p_gantry_command->move.dest_file,
@@ -1090,8 +1273,9 @@ void gantry_robot_exit(command_t* command)
                 moving_piece
             );
 
-            // Go to home
-            gantry_home();
+            // Run the relocations in the fastest order, then park until the next turn
+            gantry_emit(&plan);
+            gantry_park();
         break;
 
         case IDLE:
@@ -1103,15 +1287,18 @@ void gantry_robot_exit(command_t* command)
         break;
     }
 
+    // Report the turn's metrics once the motion is done
+    gantry_push((command_t*) gantry_metrics_build_command());
+
     // Check if the game is still going
     switch (p_gantry_command->game_status) 
     {
         case ONGOING:
             // First check that the robot actually put things down correctly
-            command_queue_push((command_t*) gantry_start_state_build_command());
+            gantry_push((command_t*) gantry_start_state_build_command());
 
             // Then it's the human's turn
-            command_queue_push((command_t*) gantry_human_build_command());
+            gantry_push((command_t*) gantry_human_build_command());
         break;
 
         case HUMAN_WIN:
@@ -1153,13 +1340,14 @@ bool gantry_robot_is_done(command_t* command)
 gantry_command_t* gantry_home_build_command(void)
 {
     // The thing to return
-    gantry_command_t* p_command = (gantry_command_t*) malloc(sizeof(gantry_command_t));
+    gantry_command_t* p_command = (gantry_command_t*) command_pool_alloc(sizeof(gantry_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &gantry_home_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &utils_empty_function;
-    p_command->command.p_is_done = &gantry_home_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_home_ops;
 
     return p_command;
 }
@@ -1173,6 +1361,16 @@ void gantry_home_entry(command_t* command)
 {
     led_mode(LED_ROBOT_MOVE);
     gantry_homing = !gantry_homing;
+
+    // Time the homing
+    if (gantry_homing)
+    {
+        metrics_start(METRICS_PHASE_HOMING);
+    }
+    else
+    {
+        metrics_stop(METRICS_PHASE_HOMING);
+    }
 }
 
 /**
@@ -1186,6 +1384,62 @@ bool gantry_home_is_done(command_t* command)
     return true;
 }
 
+/**
+ * @brief Build a gantry_metrics command
+ *
+ * @returns Pointer to the dynamically-allocated command
+ */
+gantry_command_t* gantry_metrics_build_command(void)
+{
+    // The thing to return
+    gantry_command_t* p_command = (gantry_command_t*) command_pool_alloc(sizeof(gantry_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
+
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &gantry_metrics_ops;
+
+    return p_command;
+}
+
+/**
+ * @brief Sends the turn's phase times to the RPi (runs once every motion command before it is done)
+ *
+ * @param command The gantry command being run
+ */
+void gantry_metrics_entry(command_t* command)
+{
+    metrics_stop(METRICS_PHASE_MOTION);
+    rpi_build_metrics_msg(metrics_message);
+    metrics_sent = rpi_transmit_binary(metrics_message, METRICS_INSTR_LENGTH);
+}
+
+/**
+ * @brief Sends the turn's phase times again if the Tx FIFO had no room for them
+ *
+ * @param command The gantry command being run
+ */
+void gantry_metrics_action(command_t* command)
+{
+    if (!metrics_sent)
+    {
+        metrics_sent = rpi_transmit_binary(metrics_message, METRICS_INSTR_LENGTH);
+    }
+}
+
+/**
+ * @brief Checks if the phase times have been queued for transmission
+ *
+ * @param command The gantry command being run
+ * @return Whether the message is in the Tx FIFO
+ */
+bool gantry_metrics_is_done(command_t* command)
+{
+    return metrics_sent;
+}
+
 /* Interrupts */
 
 /**
@@ -1193,8 +1447,23 @@ bool gantry_home_is_done(command_t* command)
  */
 __interrupt void GANTRY_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_GANTRY, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(GANTRY_TIMER);
+
+    // Let commands which sample hardware run
+    event_post(EVENT_TICK);
+
+    // Keep the trace timestamps and load window counting past the cycle counter wrapping
+    TRACE_KEEPALIVE();
+    CPULOAD_TICK();
+
+    // Advance the turn metrics time base
+    metrics_tick();
+
+    // Start the periodic board scan
+    sensornetwork_tick();
     
     // Check the current switch readings
     uint16_t switch_data = switch_get_reading();
@@ -1216,31 +1485,46 @@ __interrupt void GANTRY_HANDLER(void)
     if ((!sys_reset) && (switch_data & (BUTTON_RESET_MASK | BUTTON_START_MASK | BUTTON_HOME_MASK)))
     {
         sys_reset = true;
-        command_queue_push((command_t*) gantry_reset_build_command());
+
+        // A reset which cannot be built or posted would leave sys_reset stuck, so fault instead
+        if (!command_queue_post_from_isr((command_t*) gantry_reset_build_command()))
+        {
+            gantry_estop();
+        }
     }
 
-    // Store the current reading if the human hit the capture tile
+#ifndef AUTO_TURN_ENABLED
+    // Read the board if the human hit the capture tile
     if ((!human_move_capture) && (switch_data & SWITCH_CAPTURE_MASK))
     {
         human_move_capture = true;
-        board_reading_intermediate = sensornetwork_get_reading();
         led_mode(LED_CAPTURE);
+        event_post(EVENT_SWITCH);
     }
+#endif
 
-#ifdef FINAL_IMPLEMENTATION_MODE
-    // Store the current reading if the human hit the "end turn"" tile
+#ifdef AUTO_TURN_ENABLED
+    // The board ends the turn (see autoturn.h), so the "end turn" tile is ignored
+
+#elif defined(FINAL_IMPLEMENTATION_MODE)
+    // Read the board if the human hit the "end turn" tile
     if ((!human_move_done) && (switch_data & BUTTON_NEXT_TURN_MASK))
     {
-        board_reading_current = sensornetwork_get_reading();
+        metrics_start(METRICS_PHASE_SCAN);
         human_move_done = true;
+        event_post(EVENT_SWITCH);
     }
 
 #elif defined(THREE_PARTY_MODE)
     if ((!human_move_done) && (switch_data & BUTTON_NEXT_TURN_MASK))
     {
         ready_to_read = true;
+        metrics_start(METRICS_PHASE_SCAN);
+        event_post(EVENT_SWITCH);
     }
 #endif
+
+    ISR_EXIT(TRACE_ISR_GANTRY, 0);
 }
 
 /**
@@ -1248,11 +1532,16 @@ __interrupt void GANTRY_HANDLER(void)
  */
 __interrupt void COMM_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_COMM, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(COMM_TIMER);
 
     // Indicate that the message timed out
     msg_ready_to_send = true;
+    event_post(EVENT_COMM_TIMEOUT);
+
+    ISR_EXIT(TRACE_ISR_COMM, 0);
 }
 
 /* End gantry.c */
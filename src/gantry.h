@@ -27,18 +27,30 @@
 //      - Turn off the robot moving LED
 //      - If the game is ONGOING, turn on human moving LED and load a gantry_human_command
 //      - Else, turn on a white LED and load no further commands (wait for reset)
+//  - gantry_metrics_command:
+//      - Once the robot's motion is done, send the turn's phase times to the RPi (no ACK expected)
+//  - If a command cannot be built or queued (command pool or queue full), the gantry faults (error LED, sys_fault)
 
+#include "autoturn.h"
 #include "clock.h"
 #include "chessboard.h"
+#include "command_pool.h"
 #include "command_queue.h"
 #include "delay.h"
 #include "electromagnet.h"
+#include "event.h"
 #include "gpio.h"
+#include "graveyard.h"
 #include "led.h"
+#include "metrics.h"
+#include "motionprogram.h"
+#include "moveplanner.h"
 #include "raspberrypi.h"
+#include "scheduler.h"
 #include "sensornetwork.h"
 #include "steppermotors.h"
 #include "switch.h"
+#include "cpuload.h"
 #include "uart.h"
 #include "utils.h"
 
@@ -51,10 +63,18 @@
 #define COMM_HANDLER                        (TIMER7A_IRQHandler)
 #define COMM_TIMEOUT                        (600000000)
 
-// Motor speed defines
-#define MOTORS_MOVE_V_X                     (1)
-#define MOTORS_MOVE_V_Y                     (1)
-#define MOTORS_MOVE_V_Z                     (1)
+// Parking defines (where the gantry waits after each robot turn)
+#define GANTRY_PARK_IN_PLACE                (0)                 // Stay over the last square (Z is already raised)
+#define GANTRY_PARK_OFF_BOARD               (1)                 // Move to the home corner by dead reckoning
+#define GANTRY_PARK_REHOME                  (2)                 // Re-home after every turn
+#define GANTRY_PARK_MODE                    (GANTRY_PARK_OFF_BOARD)
+#define GANTRY_REHOME_INTERVAL              (8)                 // Robot turns between full re-homes
+
+// Motion envelopes {start (mm/s), cruise (mm/s), acceleration (mm/s/s)}
+#define GANTRY_TRAVEL_ENVELOPE              {135, 300, 900}     // XY without a piece
+#define GANTRY_CARRY_ENVELOPE               {135, 280, 650}     // XY while dragging a piece
+#define GANTRY_LIFT_ENVELOPE                {135, 155, 400}     // Z upward
+#define GANTRY_LOWER_ENVELOPE               {60, 135, 400}      // Z downward (gentle first contact)
 
 // Gantry command structs
 typedef struct gantry_command_t { // WHY DOES THIS EXIST?!?!?!
@@ -74,9 +94,16 @@ typedef struct gantry_comm_command_t {
     uint8_t message_length;     // Length of the message
 } gantry_comm_command_t;
 
+// Motion envelopes (see gantry.c)
+extern const stepper_envelope_t gantry_travel_envelope;
+extern const stepper_envelope_t gantry_carry_envelope;
+extern const stepper_envelope_t gantry_lift_envelope;
+extern const stepper_envelope_t gantry_lower_envelope;
+
 // Public functions
 void gantry_init(void);
 void gantry_home(void);
+void gantry_park(void);
 void gantry_robot_move_piece(chess_file_t initial_file, chess_rank_t initial_rank, chess_file_t final_file, chess_rank_t final_rank, chess_piece_t piece);
 
 // Command Functions (reading user input)
@@ -107,6 +134,12 @@ void gantry_home_action(command_t* command);
 void gantry_home_exit(command_t* command);
 bool gantry_home_is_done(command_t* command);
 
+// Command Functions (reporting turn metrics)
+gantry_command_t* gantry_metrics_build_command(void);
+void gantry_metrics_entry(command_t* command);
+void gantry_metrics_action(command_t* command);
+bool gantry_metrics_is_done(command_t* command);
+
 // Command Functions (system resets)
 gantry_command_t* gantry_reset_build_command(void);
 void gantry_reset_entry(command_t* command);
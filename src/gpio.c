@@ -78,6 +78,21 @@ void gpio_set_output_toggle(GPIO_Type* port, uint8_t pin)
     port->DATA ^= pin;
 }
 
+/**
+ * @brief Gets the masked DATA address of the specified GPIO port/pin
+ *
+ * Address bits [9:2] of a DATA access select which pins are affected, so accesses through this address only touch the given
+ * pin. Interrupts can toggle their pin without unlocking the port or disturbing other pins on the same port.
+ *
+ * @param port GPIO_Type for the port being used
+ * @param pin Pin being used, GPIO_PIN_X for X={0,...,7}
+ * @return The masked DATA address
+ */
+volatile uint32_t* gpio_get_masked_data(GPIO_Type* port, uint8_t pin)
+{
+    return (volatile uint32_t*) ((volatile uint8_t*) port + ((uint32_t) pin << 2));
+}
+
 /* GPIO Input Functions */
 
 /**
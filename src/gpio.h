@@ -31,6 +31,7 @@ void gpio_unlock(GPIO_Type* port, uint8_t pin);
 void gpio_set_output_high(GPIO_Type* port, uint8_t pin);
 void gpio_set_output_low(GPIO_Type* port, uint8_t pin);
 void gpio_set_output_toggle(GPIO_Type* port, uint8_t pin);
+volatile uint32_t* gpio_get_masked_data(GPIO_Type* port, uint8_t pin);
 
 // Functions for GPIO input
 void gpio_set_as_input(GPIO_Type* port, uint8_t pin);
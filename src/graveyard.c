@@ -0,0 +1,136 @@
+/**
+ * @file graveyard.c
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Allocates discard slots beside the board for captured pieces
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "graveyard.h"
+
+// Private functions
+static int32_t graveyard_slot_x(uint8_t slot);
+static int32_t graveyard_slot_y(uint8_t slot);
+static bool graveyard_slot_is_reserved(uint8_t slot);
+
+// Bitmask of the occupied slots (bit i <=> slot i)
+static uint16_t graveyard_occupied = 0;
+
+/**
+ * @brief Frees every slot (a new game is starting)
+ */
+void graveyard_reset(void)
+{
+    graveyard_occupied = 0;
+}
+
+/**
+ * @brief Allocates the free slot closest to the square a captured piece is leaving
+ *
+ * @param from_file The file the captured piece is leaving
+ * @param from_rank The rank the captured piece is leaving
+ * @param p_file Where to store the slot's file
+ * @param p_rank Where to store the slot's rank
+ * @return Whether a slot was allocated (if not, the capture point is stored instead)
+ */
+bool graveyard_allocate_slot(chess_file_t from_file, chess_rank_t from_rank, chess_file_t* p_file, chess_rank_t* p_rank)
+{
+    uint8_t best_slot = GRAVEYARD_SLOTS;
+    int32_t best_distance = INT32_MAX;
+    uint8_t slot = 0;
+
+    for (slot = 0; slot < GRAVEYARD_SLOTS; slot++)
+    {
+        int32_t dx = 0;
+        int32_t dy = 0;
+        int32_t distance = 0;
+
+        if ((graveyard_occupied & BITS16_MASK(slot)) || graveyard_slot_is_reserved(slot))
+        {
+            continue;
+        }
+
+        // X and Y move together, so the longer axis sets the travel time
+        dx = abs(graveyard_slot_x(slot) - (int32_t) from_file);
+        dy = abs(graveyard_slot_y(slot) - (int32_t) from_rank);
+        distance = (dx > dy) ? dx : dy;
+
+        if (distance < best_distance)
+        {
+            best_distance = distance;
+            best_slot = slot;
+        }
+    }
+
+    // Full, so fall back to the capture point
+    if (best_slot == GRAVEYARD_SLOTS)
+    {
+        *p_file = CAPTURE_FILE;
+        *p_rank = CAPTURE_RANK;
+        return false;
+    }
+
+    graveyard_occupied |= BITS16_MASK(best_slot);
+    *p_file = (chess_file_t) graveyard_slot_x(best_slot);
+    *p_rank = (chess_rank_t) graveyard_slot_y(best_slot);
+    return true;
+}
+
+/**
+ * @brief Counts the slots still available
+ *
+ * @return The number of free slots
+ */
+uint8_t graveyard_get_free_slots(void)
+{
+    uint8_t free_slots = 0;
+    uint8_t slot = 0;
+
+    for (slot = 0; slot < GRAVEYARD_SLOTS; slot++)
+    {
+        if (!(graveyard_occupied & BITS16_MASK(slot)) && !graveyard_slot_is_reserved(slot))
+        {
+            free_slots++;
+        }
+    }
+
+    return free_slots;
+}
+
+/**
+ * @brief Finds the X position of a slot (slots are numbered row by row)
+ *
+ * @param slot The slot index
+ * @return The X position (mm)
+ */
+static int32_t graveyard_slot_x(uint8_t slot)
+{
+    return GRAVEYARD_X_INITIAL - ((slot % GRAVEYARD_COLUMNS) * GRAVEYARD_PITCH);
+}
+
+/**
+ * @brief Finds the Y position of a slot (slots are numbered row by row)
+ *
+ * @param slot The slot index
+ * @return The Y position (mm)
+ */
+static int32_t graveyard_slot_y(uint8_t slot)
+{
+    return GRAVEYARD_Y_INITIAL + ((slot / GRAVEYARD_COLUMNS) * GRAVEYARD_PITCH);
+}
+
+/**
+ * @brief Checks if a slot overlaps the queen tile, which has to stay clear for promotions
+ *
+ * @param slot The slot index
+ * @return Whether the slot is reserved
+ */
+static bool graveyard_slot_is_reserved(uint8_t slot)
+{
+    return (abs(graveyard_slot_x(slot) - QUEEN_X) < (GRAVEYARD_PITCH / 2)) &&
+           (abs(graveyard_slot_y(slot) - QUEEN_Y) < (GRAVEYARD_PITCH / 2));
+}
+
+/* End graveyard.c */
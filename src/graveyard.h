@@ -0,0 +1,41 @@
+/**
+ * @file graveyard.h
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Allocates discard slots beside the board for captured pieces
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef GRAVEYARD_H_
+#define GRAVEYARD_H_
+
+// Note on the graveyard:
+//  - Slots form a grid beside the board, between the home corner and the A file
+//      - Columns are GRAVEYARD_PITCH apart, starting at CAPTURE_X and moving toward the board
+//      - Rows line up with the ranks
+//      - The slot over the queen tile (QUEEN_X, QUEEN_Y) is never allocated
+//  - Each capture takes the free slot closest (in travel time) to the square the piece leaves
+//  - Occupancy lasts for the whole game, and is cleared by graveyard_reset() when a new game starts
+//  - Once every slot is taken, pieces fall back to the single capture point (CAPTURE_FILE, CAPTURE_RANK)
+
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// General graveyard macros
+#define GRAVEYARD_COLUMNS                   (2)
+#define GRAVEYARD_ROWS                      (8)
+#define GRAVEYARD_SLOTS                     (GRAVEYARD_COLUMNS * GRAVEYARD_ROWS)
+#define GRAVEYARD_PITCH                     (SQUARE_CENTER_TO_CENTER)   // mm
+#define GRAVEYARD_X_INITIAL                 (CAPTURE_X)                 // mm (column closest to home)
+#define GRAVEYARD_Y_INITIAL                 (SQUARE_Y_INITIAL)          // mm (row beside the eighth rank)
+
+// Public functions
+void graveyard_reset(void);
+bool graveyard_allocate_slot(chess_file_t from_file, chess_rank_t from_rank, chess_file_t* p_file, chess_rank_t* p_rank);
+uint8_t graveyard_get_free_slots(void);
+
+#endif /* GRAVEYARD_H_ */
@@ -250,6 +250,8 @@ void led_mode(led_indicator_t indicator)
  */
 __interrupt void LED_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_LED, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(LED_TIMER);
 
@@ -266,6 +268,8 @@ __interrupt void LED_HANDLER(void)
     {
         led_toggle(p_led_blue);
     }
+
+    ISR_EXIT(TRACE_ISR_LED, 0);
 }
 
 /* End led.c */
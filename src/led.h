@@ -18,6 +18,7 @@
 
 #include "msp.h"
 #include "clock.h"
+#include "cpuload.h"
 #include "gpio.h"
 #include <stdint.h>
 #include <stdlib.h>
@@ -17,17 +17,18 @@
 int main(void)
 {
     // System level initialization
+    command_pool_init();
     command_queue_init();
     gantry_init();
 
 #if defined(GANTRY_DEBUG) || defined(STEPPER_DEBUG)
     // Add specific commands to the queue
     gantry_home();
-    command_queue_push((command_t*) stepper_build_chess_xy_command(H, FIRST, 1, 1));
+    command_queue_push((command_t*) stepper_build_chess_xy_command(H, FIRST, &gantry_travel_envelope, &gantry_travel_envelope, STEPPER_MOTION_COORDINATED));
     command_queue_push((command_t*) delay_build_command(1000));
-    command_queue_push((command_t*) stepper_build_chess_z_command(PAWN, 1));
+    command_queue_push((command_t*) stepper_build_chess_z_command(PAWN, &gantry_lower_envelope));
     command_queue_push((command_t*) delay_build_command(1000));
-    command_queue_push((command_t*) stepper_build_chess_z_command(HOME_PIECE, 1));
+    command_queue_push((command_t*) stepper_build_chess_z_command(HOME_PIECE, &gantry_lift_envelope));
 
 #else
     // Play chess
@@ -35,45 +36,12 @@ int main(void)
 
 #endif
 
-    // Main program flow
-    command_t* p_current_command;
+    // Main program flow (see scheduler.h)
+    scheduler_init();
 
     while (1)
     {
-        // Run the entry function
-        if (!command_queue_pop(&p_current_command))
-        {
-            // Something went wrong. Probably ran out of commands
-        }
-        else
-        {
-            p_current_command->p_entry(p_current_command);
-
-            // Run the action function - is_done() determines when action is complete
-            while (!p_current_command->p_is_done(p_current_command))
-            {
-                // Check for a system fault (E-stop, etc.) or reset
-                if (sys_fault)
-                {
-                    // In the case of a fault, force a hard fault
-                    command_t* p_bad_command = NULL;
-                    p_bad_command->p_entry(p_bad_command);
-                    break;
-                }
-                else if (sys_reset || sys_limit)
-                {
-                    // In the case of a reset, skip actions until the the homing or reset button clears
-                    break;
-                }
-                p_current_command->p_action(p_current_command);
-            }
-
-            // Run the exit function
-            p_current_command->p_exit(p_current_command);
-
-            // Free the command memory
-            free(p_current_command);
-        }
+        scheduler_run();
     }
 }
 
@@ -0,0 +1,102 @@
+/**
+ * @file metrics.c
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Measures how long each phase of a turn takes, so the times can be reported to the Pi
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "metrics.h"
+
+// Timing of a single phase
+typedef struct metrics_timer_t {
+    uint32_t start_tick;
+    uint32_t ticks;                 // Accumulated time
+    bool running;
+} metrics_timer_t;
+
+static volatile uint32_t metrics_ticks = 0;
+static metrics_timer_t timers[METRICS_PHASE_COUNT];
+
+/**
+ * @brief Initializes the metrics. Starts with every phase cleared
+ */
+void metrics_init(void)
+{
+    metrics_ticks = 0;
+    metrics_clear();
+}
+
+/**
+ * @brief Advances the time base (called from the gantry interrupt)
+ */
+void metrics_tick(void)
+{
+    metrics_ticks++;
+}
+
+/**
+ * @brief Stops and zeroes every phase
+ */
+void metrics_clear(void)
+{
+    uint32_t primask = utils_enter_critical();
+    uint8_t i = 0;
+
+    for (i = 0; i < METRICS_PHASE_COUNT; i++)
+    {
+        timers[i].start_tick = 0;
+        timers[i].ticks      = 0;
+        timers[i].running    = false;
+    }
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Starts (or restarts) timing a phase (safe to call from interrupts)
+ *
+ * @param phase The phase
+ */
+void metrics_start(metrics_phase_t phase)
+{
+    uint32_t primask = utils_enter_critical();
+
+    timers[phase].start_tick = metrics_ticks;
+    timers[phase].running    = true;
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Stops timing a phase, adding the time since it started (does nothing if it is not running)
+ *
+ * @param phase The phase
+ */
+void metrics_stop(metrics_phase_t phase)
+{
+    uint32_t primask = utils_enter_critical();
+
+    if (timers[phase].running)
+    {
+        timers[phase].ticks  += metrics_ticks - timers[phase].start_tick;
+        timers[phase].running = false;
+    }
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Gets the time accumulated by a phase (not counting a run still in progress)
+ *
+ * @param phase The phase
+ * @return The time (ms)
+ */
+uint32_t metrics_get_ms(metrics_phase_t phase)
+{
+    return timers[phase].ticks / METRICS_TICKS_PER_MS;
+}
+
+/* End metrics.c */
@@ -0,0 +1,55 @@
+/**
+ * @file metrics.h
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Measures how long each phase of a turn takes, so the times can be reported to the Pi
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+// Note on turn metrics:
+//  - Phases are timed with the gantry interrupt (which always runs), so they may last far longer than the DWT cycle
+//    counter can measure. The resolution is one gantry tick (0.2 ms)
+//  - Each phase accumulates between metrics_start() and metrics_stop(), so a phase may run more than once per turn
+//  - Stopping a phase which is not running does nothing, and metrics_clear() zeroes every phase
+//  - Phases, as timed by gantry.c:
+//      - Scan:   "end turn" press to the move being inferred (board reading plus chessboard_update_*)
+//                (with AUTO_TURN_ENABLED, from the final position first appearing, so including the settle time)
+//      - Comm:   human move first sent to the Pi's ACK
+//      - Engine: the Pi's ACK to the robot move being received
+//      - Motion: the robot move being planned to the motion (and parking) finishing, including any homing
+//      - Homing: time spent re-homing
+//  - After each robot turn, the times are sent to the Pi in a METRICS message (see raspberrypi.h)
+
+#include "msp.h"
+#include "clock.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Metrics defines
+#define METRICS_TICKS_PER_MS        (SYSCLOCK_FREQUENCY / (TIMER_4A_PERIOD + 1) / 1000)
+
+// Phases of a turn
+typedef enum {
+    METRICS_PHASE_SCAN = 0,
+    METRICS_PHASE_COMM,
+    METRICS_PHASE_ENGINE,
+    METRICS_PHASE_MOTION,
+    METRICS_PHASE_HOMING,
+    METRICS_PHASE_COUNT
+} metrics_phase_t;
+
+// Function definitions
+void metrics_init(void);
+void metrics_tick(void);
+void metrics_clear(void);
+void metrics_start(metrics_phase_t phase);
+void metrics_stop(metrics_phase_t phase);
+uint32_t metrics_get_ms(metrics_phase_t phase);
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,393 @@
+/**
+ * @file motionprogram.c
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Runs a precompiled list of motion, magnet and dwell primitives as a single command
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "motionprogram.h"
+
+// Private functions
+static motionprogram_step_t* motionprogram_add_step(motionprogram_t* p_program, motionprogram_op_t op);
+static void motionprogram_start_step(motionprogram_step_t* p_step);
+static bool motionprogram_step_is_done(motionprogram_step_t* p_step);
+static uint8_t motionprogram_get_step_axes(motionprogram_step_t* p_step);
+
+// Command operations (one table per command type, kept in flash)
+static const command_ops_t motionprogram_ops = {
+    .p_entry   = &motionprogram_entry,
+    .p_action  = &motionprogram_action,
+    .p_exit    = &motionprogram_exit,
+    .p_is_done = &motionprogram_is_done,
+    .p_abort   = &motionprogram_abort,
+    .resources = COMMAND_RESOURCE_MOTION | COMMAND_RESOURCE_MAGNET,
+    .events    = EVENT_STEPPER | EVENT_DELAY | EVENT_TICK,
+    .id        = COMMAND_ID_MOTIONPROGRAM
+};
+
+// Preallocated programs
+static motionprogram_t programs[MOTIONPROGRAM_COUNT];
+
+// The move being run (only one program runs at a time, since they all use the motion resource)
+static stepper_chess_command_t motionprogram_move;
+
+/**
+ * @brief Releases every program (the commands using them have been cleared or aborted)
+ */
+void motionprogram_reset(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < MOTIONPROGRAM_COUNT; i++)
+    {
+        programs[i].count  = 0;
+        programs[i].in_use = false;
+    }
+}
+
+/**
+ * @brief Takes an empty program from the preallocated set
+ *
+ * @return Pointer to the program, or NULL if every program is in use
+ */
+motionprogram_t* motionprogram_alloc(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < MOTIONPROGRAM_COUNT; i++)
+    {
+        if (!programs[i].in_use)
+        {
+            programs[i].count  = 0;
+            programs[i].in_use = true;
+            return &programs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Returns a program to the preallocated set
+ *
+ * @param p_program The program
+ */
+void motionprogram_free(motionprogram_t* p_program)
+{
+    if (p_program != NULL)
+    {
+        p_program->in_use = false;
+    }
+}
+
+/**
+ * @brief Appends a move to a square
+ *
+ * @param p_program The program to add to
+ * @param file The board column to travel to
+ * @param rank The board row to travel to
+ * @param p_envelope Travel envelope for the move (both axes, interpolated together)
+ * @return Whether the step was added (fails if the program is full)
+ */
+bool motionprogram_add_move_xy(motionprogram_t* p_program, chess_file_t file, chess_rank_t rank, const stepper_envelope_t* p_envelope)
+{
+    motionprogram_step_t* p_step = motionprogram_add_step(p_program, MOTIONPROGRAM_MOVE_XY);
+
+    if (p_step == NULL)
+    {
+        return false;
+    }
+
+    p_step->arg_0      = (int16_t) file;
+    p_step->arg_1      = (int16_t) rank;
+    p_step->p_envelope = p_envelope;
+    return true;
+}
+
+/**
+ * @brief Appends a move of the magnet to a height
+ *
+ * @param p_program The program to add to
+ * @param piece The piece whose height to move to
+ * @param p_envelope Travel envelope for the move
+ * @return Whether the step was added (fails if the program is full)
+ */
+bool motionprogram_add_move_z(motionprogram_t* p_program, chess_piece_t piece, const stepper_envelope_t* p_envelope)
+{
+    motionprogram_step_t* p_step = motionprogram_add_step(p_program, MOTIONPROGRAM_MOVE_Z);
+
+    if (p_step == NULL)
+    {
+        return false;
+    }
+
+    p_step->arg_0      = (int16_t) piece;
+    p_step->p_envelope = p_envelope;
+    return true;
+}
+
+/**
+ * @brief Appends turning the magnet on or off
+ *
+ * @param p_program The program to add to
+ * @param state One of {enabled, disabled}
+ * @return Whether the step was added (fails if the program is full)
+ */
+bool motionprogram_add_magnet(motionprogram_t* p_program, peripheral_state_t state)
+{
+    motionprogram_step_t* p_step = motionprogram_add_step(p_program, MOTIONPROGRAM_MAGNET);
+
+    if (p_step == NULL)
+    {
+        return false;
+    }
+
+    p_step->arg_0 = (int16_t) state;
+    return true;
+}
+
+/**
+ * @brief Appends a wait
+ *
+ * @param p_program The program to add to
+ * @param time_ms The amount of time to wait in milliseconds (ms)
+ * @return Whether the step was added (fails if the program is full)
+ */
+bool motionprogram_add_dwell(motionprogram_t* p_program, uint16_t time_ms)
+{
+    motionprogram_step_t* p_step = motionprogram_add_step(p_program, MOTIONPROGRAM_DWELL);
+
+    if (p_step == NULL)
+    {
+        return false;
+    }
+
+    p_step->arg_0 = (int16_t) time_ms;
+    return true;
+}
+
+/* Command Functions */
+
+/**
+ * @brief Builds a command which runs a program
+ *
+ * @param p_program The program to run (released once the command is done)
+ * @return Pointer to the command object
+ */
+motionprogram_command_t* motionprogram_build_command(motionprogram_t* p_program)
+{
+    // The thing to return
+    motionprogram_command_t* p_command = (motionprogram_command_t*) command_pool_alloc(sizeof(motionprogram_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
+
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &motionprogram_ops;
+
+    // Data
+    p_command->p_program = p_program;
+    p_command->index     = 0;
+
+    return p_command;
+}
+
+/**
+ * @brief Starts the first primitive
+ *
+ * @param command The motion program command being run
+ */
+void motionprogram_entry(command_t* command)
+{
+    motionprogram_command_t* p_command = (motionprogram_command_t*) command;
+
+    // The motors stay enabled between primitives
+    stepper_set_hold(true);
+
+    p_command->index = 0;
+    if (p_command->p_program->count > 0)
+    {
+        motionprogram_start_step(&p_command->p_program->steps[0]);
+    }
+}
+
+/**
+ * @brief Starts each primitive once the one before it is done (or, for moves, can be blended into)
+ *
+ * @param command The motion program command being run
+ */
+void motionprogram_action(command_t* command)
+{
+    motionprogram_command_t* p_command = (motionprogram_command_t*) command;
+    motionprogram_t* p_program = p_command->p_program;
+
+    while (p_command->index < p_program->count)
+    {
+        motionprogram_step_t* p_step = &p_program->steps[p_command->index];
+
+        if (!motionprogram_step_is_done(p_step))
+        {
+            // A move may start early if the next primitive is also a move, on axes which are already idle
+            uint8_t moving_axes = motionprogram_get_step_axes(p_step);
+            uint8_t next_axes   = ((p_command->index + 1) < p_program->count) ? motionprogram_get_step_axes(p_step + 1) : 0;
+
+            if ((moving_axes == 0) || (next_axes == 0) || !stepper_can_blend_into(next_axes))
+            {
+                return;
+            }
+        }
+
+        // Move on to the next primitive
+        p_command->index++;
+        if (p_command->index < p_program->count)
+        {
+            motionprogram_start_step(&p_program->steps[p_command->index]);
+        }
+    }
+}
+
+/**
+ * @brief Disables the motors and releases the program
+ *
+ * @param command The motion program command being run
+ */
+void motionprogram_exit(command_t* command)
+{
+    motionprogram_command_t* p_command = (motionprogram_command_t*) command;
+
+    stepper_set_hold(false);
+    stepper_exit(&motionprogram_move.command);
+    motionprogram_free(p_command->p_program);
+}
+
+/**
+ * @brief Done once every primitive has finished
+ *
+ * @param command The motion program command being run
+ * @return Whether the program is complete
+ */
+bool motionprogram_is_done(command_t* command)
+{
+    motionprogram_command_t* p_command = (motionprogram_command_t*) command;
+
+    return (p_command->index >= p_command->p_program->count);
+}
+
+/**
+ * @brief Stops the motors and any dwell immediately, and releases the program
+ *
+ * @param command The motion program command being aborted
+ */
+void motionprogram_abort(command_t* command)
+{
+    motionprogram_command_t* p_command = (motionprogram_command_t*) command;
+
+    stepper_set_hold(false);
+    stepper_abort(&motionprogram_move.command);
+    delay_abort(command);
+    motionprogram_free(p_command->p_program);
+}
+
+/**
+ * @brief Appends a primitive to a program
+ *
+ * @param p_program The program to add to
+ * @param op The type of primitive
+ * @return Pointer to the new step, or NULL if the program is full
+ */
+static motionprogram_step_t* motionprogram_add_step(motionprogram_t* p_program, motionprogram_op_t op)
+{
+    motionprogram_step_t* p_step;
+
+    if (p_program->count >= MOTIONPROGRAM_MAX_STEPS)
+    {
+        return NULL;
+    }
+
+    p_step = &p_program->steps[p_program->count];
+    p_step->op         = op;
+    p_step->arg_0      = 0;
+    p_step->arg_1      = 0;
+    p_step->p_envelope = NULL;
+    p_program->count++;
+
+    return p_step;
+}
+
+/**
+ * @brief Starts a primitive
+ *
+ * @param p_step The primitive
+ */
+static void motionprogram_start_step(motionprogram_step_t* p_step)
+{
+    switch (p_step->op)
+    {
+        case MOTIONPROGRAM_MOVE_XY:
+            stepper_init_chess_xy_command(&motionprogram_move, (chess_file_t) p_step->arg_0, (chess_rank_t) p_step->arg_1, p_step->p_envelope, p_step->p_envelope, STEPPER_MOTION_COORDINATED);
+            stepper_chess_entry(&motionprogram_move.command);
+        break;
+
+        case MOTIONPROGRAM_MOVE_Z:
+            stepper_init_chess_z_command(&motionprogram_move, (chess_piece_t) p_step->arg_0, p_step->p_envelope);
+            stepper_chess_entry(&motionprogram_move.command);
+        break;
+
+        case MOTIONPROGRAM_MAGNET:
+            electromagnet_set((peripheral_state_t) p_step->arg_0);
+        break;
+
+        case MOTIONPROGRAM_DWELL:
+            delay_start((uint16_t) p_step->arg_0);
+        break;
+    }
+}
+
+/**
+ * @brief Checks if a primitive has finished
+ *
+ * @param p_step The primitive
+ * @return Whether it has finished
+ */
+static bool motionprogram_step_is_done(motionprogram_step_t* p_step)
+{
+    switch (p_step->op)
+    {
+        case MOTIONPROGRAM_MOVE_XY:
+        case MOTIONPROGRAM_MOVE_Z:
+            return stepper_has_arrived();
+
+        case MOTIONPROGRAM_DWELL:
+            return delay_is_expired();
+
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief Finds which axes a primitive moves
+ *
+ * @param p_step The primitive
+ * @return Bitmask (by motor_id) of the axes moved, 0 if the primitive is not a move
+ */
+static uint8_t motionprogram_get_step_axes(motionprogram_step_t* p_step)
+{
+    switch (p_step->op)
+    {
+        case MOTIONPROGRAM_MOVE_XY:
+            return (1 << STEPPER_X_ID) | (1 << STEPPER_Y_ID);
+
+        case MOTIONPROGRAM_MOVE_Z:
+            return (1 << STEPPER_Z_ID);
+
+        default:
+            return 0;
+    }
+}
+
+/* End motionprogram.c */
@@ -0,0 +1,83 @@
+/**
+ * @file motionprogram.h
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Runs a precompiled list of motion, magnet and dwell primitives as a single command
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef MOTIONPROGRAM_H_
+#define MOTIONPROGRAM_H_
+
+// Note on motion programs:
+//  - A robot move is compiled (see moveplanner_emit()) into one program: a flat array of primitives
+//  - One command interprets the whole program, so nothing goes through the command queue or the pool between primitives
+//  - The motors stay enabled from the first move to the last: the program holds them (stepper_set_hold()), so the step
+//    interrupts leave each axis enabled when it arrives, and the exit (or abort) disables them all once
+//  - Consecutive moves on disjoint axes blend exactly like separate stepper commands do (e.g. the descent onto a piece
+//    starts while the XY move is still decelerating)
+//  - Programs come from a small preallocated set (MOTIONPROGRAM_COUNT), so the next move can be compiled while the
+//    current program still runs. A program is released when its command exits or is aborted, and all of them on reset
+
+#include "command_pool.h"
+#include "command_queue.h"
+#include "delay.h"
+#include "electromagnet.h"
+#include "event.h"
+#include "steppermotors.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// General program macros
+#define MOTIONPROGRAM_MAX_STEPS             (32)
+#define MOTIONPROGRAM_COUNT                 (2)
+
+// Program primitives
+typedef enum {
+    MOTIONPROGRAM_MOVE_XY,                              // Move to a square (coordinated)
+    MOTIONPROGRAM_MOVE_Z,                               // Move the magnet to a height
+    MOTIONPROGRAM_MAGNET,                               // Turn the magnet on or off
+    MOTIONPROGRAM_DWELL                                 // Wait
+} motionprogram_op_t;
+
+typedef struct motionprogram_step_t {
+    motionprogram_op_t op;
+    int16_t arg_0;                                      // MOVE_XY: file, MOVE_Z: piece, MAGNET: peripheral_state_t, DWELL: ms
+    int16_t arg_1;                                      // MOVE_XY: rank
+    const stepper_envelope_t* p_envelope;               // MOVE_XY, MOVE_Z: envelope of the move
+} motionprogram_step_t;
+
+typedef struct motionprogram_t {
+    motionprogram_step_t steps[MOTIONPROGRAM_MAX_STEPS];
+    uint8_t count;
+    bool in_use;
+} motionprogram_t;
+
+// Motion program command struct
+typedef struct motionprogram_command_t {
+    command_t command;
+    motionprogram_t* p_program;                         // The program to run
+    uint8_t index;                                      // The primitive being run
+} motionprogram_command_t;
+
+// Public functions
+void motionprogram_reset(void);
+motionprogram_t* motionprogram_alloc(void);
+void motionprogram_free(motionprogram_t* p_program);
+bool motionprogram_add_move_xy(motionprogram_t* p_program, chess_file_t file, chess_rank_t rank, const stepper_envelope_t* p_envelope);
+bool motionprogram_add_move_z(motionprogram_t* p_program, chess_piece_t piece, const stepper_envelope_t* p_envelope);
+bool motionprogram_add_magnet(motionprogram_t* p_program, peripheral_state_t state);
+bool motionprogram_add_dwell(motionprogram_t* p_program, uint16_t time_ms);
+
+// Command Functions
+motionprogram_command_t* motionprogram_build_command(motionprogram_t* p_program);
+void motionprogram_entry(command_t* command);
+void motionprogram_action(command_t* command);
+void motionprogram_exit(command_t* command);
+bool motionprogram_is_done(command_t* command);
+void motionprogram_abort(command_t* command);
+
+#endif /* MOTIONPROGRAM_H_ */
@@ -0,0 +1,313 @@
+/**
+ * @file moveplanner.c
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Orders the piece relocations of a robot move and emits the motion commands for them
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "moveplanner.h"
+#include "gantry.h"
+#include <math.h>
+#include <string.h>
+
+// Private functions
+static float moveplanner_get_move_time(float distance, const stepper_envelope_t* p_envelope);
+static float moveplanner_get_plan_time(moveplanner_plan_t* p_plan, const uint8_t* p_order);
+static bool moveplanner_order_is_valid(moveplanner_plan_t* p_plan, const uint8_t* p_order);
+static void moveplanner_search(moveplanner_plan_t* p_plan, uint8_t* p_order, uint8_t depth, uint8_t used, uint8_t* p_best_order, float* p_best_time);
+static void moveplanner_compile_relocation(motionprogram_t* p_program, moveplanner_relocation_t* p_relocation, bool last);
+
+/**
+ * @brief Empties a plan
+ *
+ * @param p_plan The plan to clear
+ */
+void moveplanner_init(moveplanner_plan_t* p_plan)
+{
+    p_plan->count = 0;
+}
+
+/**
+ * @brief Adds a relocation to a plan
+ *
+ * @param p_plan The plan to add to
+ * @param from_file The file the piece is leaving
+ * @param from_rank The rank the piece is leaving
+ * @param to_file The file the piece is going to
+ * @param to_rank The rank the piece is going to
+ * @param piece The piece being moved
+ * @return Whether the relocation was added (it is dropped if it is invalid, or if the plan is full)
+ */
+bool moveplanner_add(moveplanner_plan_t* p_plan, chess_file_t from_file, chess_rank_t from_rank, chess_file_t to_file, chess_rank_t to_rank, chess_piece_t piece)
+{
+    moveplanner_relocation_t* p_relocation;
+
+    // Check for errors
+    if ((from_file == FILE_ERROR) || (from_rank == RANK_ERROR) || (to_file == FILE_ERROR) || (to_rank == RANK_ERROR) ||
+        (p_plan->count >= MOVEPLANNER_MAX_RELOCATIONS))
+    {
+        return false;
+    }
+
+    p_relocation = &p_plan->relocations[p_plan->count];
+    p_relocation->from_file = from_file;
+    p_relocation->from_rank = from_rank;
+    p_relocation->to_file   = to_file;
+    p_relocation->to_rank   = to_rank;
+    p_relocation->piece     = piece;
+    p_plan->count++;
+
+    return true;
+}
+
+/**
+ * @brief Compiles a plan into a motion program, and adds the single command which runs it to the queue
+ *
+ * @param p_plan The plan to emit
+ * @return Whether the command was queued (fails if no program or command could be allocated)
+ */
+bool moveplanner_emit(moveplanner_plan_t* p_plan)
+{
+    motionprogram_t* p_program = motionprogram_alloc();
+
+    if (p_program == NULL)
+    {
+        return false;
+    }
+
+    moveplanner_compile(p_plan, p_program);
+    if (!command_queue_push((command_t*) motionprogram_build_command(p_program)))
+    {
+        motionprogram_free(p_program);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Picks the fastest valid ordering of a plan's relocations, then compiles them into a motion program
+ *
+ * @param p_plan The plan to compile
+ * @param p_program The (empty) program to fill in
+ */
+void moveplanner_compile(moveplanner_plan_t* p_plan, motionprogram_t* p_program)
+{
+    uint8_t order[MOVEPLANNER_MAX_RELOCATIONS];
+    uint8_t best_order[MOVEPLANNER_MAX_RELOCATIONS];
+    float best_time = INFINITY;
+    uint8_t i = 0;
+
+    // Fall back to the order the relocations were added in (only possible if the relocations form a cycle)
+    for (i = 0; i < p_plan->count; i++)
+    {
+        best_order[i] = i;
+    }
+
+    // At most 3! orderings, so try them all
+    moveplanner_search(p_plan, order, 0, 0, best_order, &best_time);
+
+    for (i = 0; i < p_plan->count; i++)
+    {
+        moveplanner_compile_relocation(p_program, &p_plan->relocations[best_order[i]], (i == (p_plan->count - 1)));
+    }
+}
+
+/**
+ * @brief Estimates how long a single move takes with the given envelope
+ *
+ * @param distance The distance to move (mm)
+ * @param p_envelope The envelope of the move
+ * @return The time (s)
+ */
+static float moveplanner_get_move_time(float distance, const stepper_envelope_t* p_envelope)
+{
+    float v_start  = p_envelope->v_start;
+    float v_cruise = p_envelope->v_cruise;
+    float accel    = p_envelope->accel;
+    float ramp_distance = 0;
+
+    if (distance <= 0)
+    {
+        return 0;
+    }
+
+    // Constant speed
+    if ((accel == 0) || (v_cruise <= v_start))
+    {
+        return distance / v_cruise;
+    }
+
+    // Triangular profile (the peak speed is reached halfway): [v_p^2 = v_s^2 + 2a(d/2)]
+    ramp_distance = ((v_cruise*v_cruise) - (v_start*v_start)) / (2 * accel);
+    if ((2 * ramp_distance) >= distance)
+    {
+        return 2 * (sqrtf((v_start*v_start) + (accel*distance)) - v_start) / accel;
+    }
+
+    // Trapezoidal profile
+    return (2 * (v_cruise - v_start) / accel) + ((distance - (2 * ramp_distance)) / v_cruise);
+}
+
+/**
+ * @brief Estimates how long the gantry spends moving for a given ordering (the magnet delays do not depend on the order)
+ *
+ * @param p_plan The plan being evaluated
+ * @param p_order Indices of the relocations, in the order they run
+ * @return The time (s)
+ */
+static float moveplanner_get_plan_time(moveplanner_plan_t* p_plan, const uint8_t* p_order)
+{
+    float pos_x = (float) stepper_get_position_mm(STEPPER_X_ID);
+    float pos_y = (float) stepper_get_position_mm(STEPPER_Y_ID);
+    float pos_z = (float) stepper_get_position_mm(STEPPER_Z_ID);
+    float time = 0;
+    uint8_t i = 0;
+
+    for (i = 0; i < p_plan->count; i++)
+    {
+        moveplanner_relocation_t* p_relocation = &p_plan->relocations[p_order[i]];
+        float piece_z  = (float) p_relocation->piece;
+        float raise_to = (i == (p_plan->count - 1)) ? (float) HOME_PIECE : (float) MOVEPLANNER_TRAVEL_Z;
+
+        // Travel empty to the piece and pick it up
+        time += moveplanner_get_move_time(hypotf(p_relocation->from_file - pos_x, p_relocation->from_rank - pos_y), &gantry_travel_envelope);
+        time += moveplanner_get_move_time(fabsf(pos_z - piece_z), &gantry_lower_envelope);
+        time += moveplanner_get_move_time(fabsf(HOME_PIECE - piece_z), &gantry_lift_envelope);
+
+        // Carry it to its destination and put it down (subtracted as floats, since a rank enum may be unsigned)
+        time += moveplanner_get_move_time(hypotf((float) p_relocation->to_file - p_relocation->from_file, (float) p_relocation->to_rank - p_relocation->from_rank), &gantry_carry_envelope);
+        time += moveplanner_get_move_time(fabsf(HOME_PIECE - piece_z), &gantry_lower_envelope);
+        time += moveplanner_get_move_time(fabsf(raise_to - piece_z), &gantry_lift_envelope);
+
+        pos_x = (float) p_relocation->to_file;
+        pos_y = (float) p_relocation->to_rank;
+        pos_z = raise_to;
+    }
+
+    return time;
+}
+
+/**
+ * @brief Checks that an ordering never puts a piece onto a square another relocation has not vacated yet
+ *
+ * @param p_plan The plan being evaluated
+ * @param p_order Indices of the relocations, in the order they run
+ * @return Whether the ordering is valid
+ */
+static bool moveplanner_order_is_valid(moveplanner_plan_t* p_plan, const uint8_t* p_order)
+{
+    uint8_t i = 0;
+    uint8_t j = 0;
+
+    for (i = 0; i < p_plan->count; i++)
+    {
+        moveplanner_relocation_t* p_earlier = &p_plan->relocations[p_order[i]];
+
+        for (j = i + 1; j < p_plan->count; j++)
+        {
+            moveplanner_relocation_t* p_later = &p_plan->relocations[p_order[j]];
+
+            if ((p_earlier->to_file == p_later->from_file) && (p_earlier->to_rank == p_later->from_rank))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Recursively tries every ordering of the relocations, keeping the fastest valid one
+ *
+ * @param p_plan The plan being ordered
+ * @param p_order The ordering being built
+ * @param depth How many relocations have been placed in the ordering
+ * @param used Bitmask of the relocations already placed
+ * @param p_best_order The fastest valid ordering so far
+ * @param p_best_time The time of the fastest valid ordering so far
+ */
+static void moveplanner_search(moveplanner_plan_t* p_plan, uint8_t* p_order, uint8_t depth, uint8_t used, uint8_t* p_best_order, float* p_best_time)
+{
+    uint8_t i = 0;
+
+    // A complete ordering
+    if (depth == p_plan->count)
+    {
+        float time = 0;
+
+        if (!moveplanner_order_is_valid(p_plan, p_order))
+        {
+            return;
+        }
+
+        time = moveplanner_get_plan_time(p_plan, p_order);
+        if (time < *p_best_time)
+        {
+            *p_best_time = time;
+            memcpy(p_best_order, p_order, p_plan->count);
+        }
+        return;
+    }
+
+    for (i = 0; i < p_plan->count; i++)
+    {
+        if (!(used & BITS8_MASK(i)))
+        {
+            p_order[depth] = i;
+            moveplanner_search(p_plan, p_order, depth + 1, used | BITS8_MASK(i), p_best_order, p_best_time);
+        }
+    }
+}
+
+/**
+ * @brief Compiles a single relocation into a motion program
+ *
+ * @param p_program The program to add to
+ * @param p_relocation The relocation
+ * @param last Whether this is the last relocation of the move (raise fully so the gantry can park)
+ */
+static void moveplanner_compile_relocation(motionprogram_t* p_program, moveplanner_relocation_t* p_relocation, bool last)
+{
+    chess_piece_t raise_to = last ? HOME_PIECE : (chess_piece_t) MOVEPLANNER_TRAVEL_Z;
+
+    // Go to the source tile
+    motionprogram_add_move_xy(p_program, p_relocation->from_file, p_relocation->from_rank, &gantry_travel_envelope);
+
+    // Lower the magnet (directly after the XY move so the descent can blend into its deceleration)
+    motionprogram_add_move_z(p_program, p_relocation->piece, &gantry_lower_envelope);
+
+#ifdef PERIPHERALS_ENABLED
+    // Engage the magnet
+    motionprogram_add_magnet(p_program, enabled);
+#endif
+
+    // Wait
+    motionprogram_add_dwell(p_program, MOVEPLANNER_ENGAGE_DELAY_MS);
+
+    // Raise the magnet to the carry height
+    motionprogram_add_move_z(p_program, HOME_PIECE, &gantry_lift_envelope);
+
+    // Go to the destination tile
+    motionprogram_add_move_xy(p_program, p_relocation->to_file, p_relocation->to_rank, &gantry_carry_envelope);
+
+    // Lower the magnet
+    motionprogram_add_move_z(p_program, p_relocation->piece, &gantry_lower_envelope);
+
+#ifdef PERIPHERALS_ENABLED
+    // Disengage the magnet
+    motionprogram_add_magnet(p_program, disabled);
+#endif
+
+    // Wait
+    motionprogram_add_dwell(p_program, MOVEPLANNER_RELEASE_DELAY_MS);
+
+    // Raise the magnet (only clear of the other pieces if another relocation follows)
+    motionprogram_add_move_z(p_program, raise_to, &gantry_lift_envelope);
+}
+
+/* End moveplanner.c */
@@ -0,0 +1,61 @@
+/**
+ * @file moveplanner.h
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Orders the piece relocations of a robot move and emits the motion commands for them
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef MOVEPLANNER_H_
+#define MOVEPLANNER_H_
+
+// Note on move planning:
+//  - A chess move is a small set of relocations (e.g. a capture is "victim to the graveyard" + "mover to the destination")
+//  - moveplanner_compile() tries every ordering, drops those that would put a piece onto a square that is still occupied, and
+//    keeps the one with the shortest estimated gantry time
+//  - Heights:
+//      - Carrying a piece always happens at HOME_PIECE, so the piece clears everything on the board
+//      - Travelling empty between relocations only needs the magnet to clear the tallest piece (MOVEPLANNER_TRAVEL_Z)
+//      - The last relocation raises back to HOME_PIECE, so the gantry can park
+//  - moveplanner_emit() compiles the plan into a motion program (see motionprogram.h) and queues the one command running it
+
+#include "command_queue.h"
+#include "delay.h"
+#include "electromagnet.h"
+#include "motionprogram.h"
+#include "steppermotors.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// General planner macros
+#define MOVEPLANNER_MAX_RELOCATIONS         (3)
+#define MOVEPLANNER_TRAVEL_CLEARANCE        (10)                            // mm (above the tallest piece)
+#define MOVEPLANNER_TRAVEL_Z                (KING + MOVEPLANNER_TRAVEL_CLEARANCE)
+#define MOVEPLANNER_ENGAGE_DELAY_MS         (1000)                          // ms (magnet grabbing the piece)
+#define MOVEPLANNER_RELEASE_DELAY_MS        (500)                           // ms (magnet letting go of the piece)
+
+// A single piece moving from one place to another
+typedef struct moveplanner_relocation_t {
+    chess_file_t from_file;
+    chess_rank_t from_rank;
+    chess_file_t to_file;
+    chess_rank_t to_rank;
+    chess_piece_t piece;
+} moveplanner_relocation_t;
+
+// All relocations making up a move
+typedef struct moveplanner_plan_t {
+    moveplanner_relocation_t relocations[MOVEPLANNER_MAX_RELOCATIONS];
+    uint8_t count;
+} moveplanner_plan_t;
+
+// Public functions
+void moveplanner_init(moveplanner_plan_t* p_plan);
+bool moveplanner_add(moveplanner_plan_t* p_plan, chess_file_t from_file, chess_rank_t from_rank, chess_file_t to_file, chess_rank_t to_rank, chess_piece_t piece);
+bool moveplanner_emit(moveplanner_plan_t* p_plan);
+void moveplanner_compile(moveplanner_plan_t* p_plan, motionprogram_t* p_program);
+
+#endif /* MOVEPLANNER_H_ */
@@ -12,6 +12,9 @@
 
 // Private functions
 static void rpi_checksum(char *data, uint8_t size);
+static uint8_t rpi_frame_get_length(rpi_frame_t* p_frame);
+static bool rpi_transmit_binary_wait(char* data, uint8_t size);
+static bool rpi_transmit_load_record(uint8_t id, const cpuload_usage_t* p_usage);
 
 /**
  * @brief Initialize the Raspberry Pi UART Tx and Rx lines
@@ -22,27 +25,75 @@ void rpi_init(void)
 }
 
 /**
- * @brief Uses UART to send data from the MSP432 to the Raspberry Pi
+ * @brief Uses UART to send data from the MSP432 to the Raspberry Pi. Never waits: the whole message is queued for the
+ * Tx interrupt, or nothing is
  *
  * @param data Character buffer to be sent
  * @param size Number of characters to transmit (unless a null-terminator is reacher)
- * @return Whether transmission was successful
+ * @return Whether the message was queued (false if the Tx FIFO has no room for it yet)
  */
 bool rpi_transmit(char* data, uint8_t size)
+{
+    uint8_t length = 0;
+
+    // Stop at the null-terminator
+    while ((length < size) && (data[length] != '\0'))
+    {
+        length++;
+    }
+
+    return rpi_transmit_binary(data, length);
+}
+
+/**
+ * @brief Sends raw bytes (which may include '\0') to the Raspberry Pi. Never waits: the whole message is queued for the
+ * Tx interrupt, or nothing is
+ *
+ * @param data Bytes to be sent
+ * @param size Number of bytes to transmit
+ * @return Whether the message was queued (false if the Tx FIFO has no room for it yet)
+ */
+bool rpi_transmit_binary(char* data, uint8_t size)
 {
     bool status = true;
+    uint8_t i = 0;
 
-    // Write one byte at a time
-    int i = 0;
-    for (i = 0; (i < size) && (status) && (data[i] != '\0'); i++)
+    // Only the main loop pushes, so the room can only grow between the check and the pushes
+    if (uart_get_tx_space(RPI_UART_CHANNEL) < size)
+    {
+        return false;
+    }
+
+    for (i = 0; i < size; i++)
     {
         status &= uart_out_byte(RPI_UART_CHANNEL, (uint8_t) data[i]);
-        utils_delay(70000);
     }
 
     return status;
 }
 
+/**
+ * @brief Sends raw bytes to the Raspberry Pi, waiting whenever the Tx FIFO is full. Only used by the debug dumps,
+ * which are longer than the FIFO
+ *
+ * @param data Bytes to be sent
+ * @param size Number of bytes to transmit
+ * @return Whether transmission was successful (fails on a reset or fault)
+ */
+static bool rpi_transmit_binary_wait(char* data, uint8_t size)
+{
+    // The Tx interrupt drains the FIFO
+    while (!rpi_transmit_binary(data, size))
+    {
+        if (sys_fault || sys_reset)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 /**
  * @brief Uses UART to read data from the the Raspberry Pi to the MSP432
  *
@@ -68,6 +119,75 @@ bool rpi_receive_unblocked(char *data, uint8_t size)
     return uart_read_string_unblocked(RPI_UART_CHANNEL, data, size);
 }
 
+/**
+ * @brief Prepares to receive instructions on a UART channel, discarding any partial instruction
+ *
+ * @param p_frame The frame to receive into
+ * @param uart_channel One of UART_CHANNEL_X for X={0,1,2,3,6}
+ */
+void rpi_frame_init(rpi_frame_t* p_frame, uint8_t uart_channel)
+{
+    p_frame->uart_channel = uart_channel;
+    p_frame->count        = 0;
+}
+
+/**
+ * @brief Takes the bytes received so far into a frame, without waiting for more
+ *
+ * @param p_frame The frame to receive into. Holds a validated instruction when this returns true
+ * @return Whether a complete instruction, with matching check bytes, was received
+ */
+bool rpi_receive_frame(rpi_frame_t* p_frame)
+{
+    uint8_t byte = 0;
+
+    // The previous instruction was handed out, start the next one
+    if (p_frame->count == rpi_frame_get_length(p_frame))
+    {
+        p_frame->count = 0;
+    }
+
+    while (uart_read_byte_unblocked(p_frame->uart_channel, &byte))
+    {
+        // Wait for the START byte
+        if ((p_frame->count == 0) && (byte != START_BYTE))
+        {
+            continue;
+        }
+        p_frame->data[p_frame->count++] = (char) byte;
+
+        // Once the INSTRUCTION byte gives the operand length, stop at the CHECK BYTES
+        if (p_frame->count == rpi_frame_get_length(p_frame))
+        {
+            if (utils_validate_transmission((uint8_t *) p_frame->data, p_frame->count - 2, &p_frame->data[p_frame->count - 2]))
+            {
+                return true;
+            }
+
+            // Drop a corrupted instruction
+            p_frame->count = 0;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Gives the length of the instruction in a frame
+ *
+ * @param p_frame The frame
+ * @return The length, or RPI_FRAME_MAX_LENGTH until the INSTRUCTION byte has been received
+ */
+static uint8_t rpi_frame_get_length(rpi_frame_t* p_frame)
+{
+    if (p_frame->count < 2)
+    {
+        return RPI_FRAME_MAX_LENGTH;
+    }
+
+    return 4 + ((uint8_t) p_frame->data[1] & 0x0F);
+}
+
 /**
  * @brief Attaches a checksum to a UART message
  * 
@@ -140,6 +260,36 @@ bool rpi_build_human_move_msg(char move[5], char message[HUMAN_MOVE_INSTR_LENGTH
     return message;
 }
 
+/**
+ * @brief Builds a METRICS message from the MSP432 to the Raspberry Pi, holding the time of each turn phase (see
+ * metrics.h) in ms, as 24-bit little-endian values saturated at 0xFFFFFF
+ *
+ * @return Pointer to the message
+ */
+char* rpi_build_metrics_msg(char message[METRICS_INSTR_LENGTH])
+{
+    metrics_phase_t phase = METRICS_PHASE_SCAN;
+    uint32_t time_ms = 0;
+
+    // Build the message
+    message[0] = START_BYTE;
+    message[1] = METRICS_INSTR_AND_LEN;
+    for (phase = METRICS_PHASE_SCAN; phase < METRICS_PHASE_COUNT; phase++)
+    {
+        time_ms = metrics_get_ms(phase);
+        if (time_ms > 0xFFFFFF)
+        {
+            time_ms = 0xFFFFFF;
+        }
+        message[2 + (3 * phase)] = (char) (time_ms);
+        message[3 + (3 * phase)] = (char) (time_ms >> 8);
+        message[4 + (3 * phase)] = (char) (time_ms >> 16);
+    }
+    rpi_checksum(message, METRICS_INSTR_LENGTH-2);
+
+    return message;
+}
+
 /**
  * @brief Send an ACK signal to the Raspberry Pi
  *
@@ -150,6 +300,111 @@ bool rpi_transmit_ack(void)
     return uart_out_byte(RPI_UART_CHANNEL, (uint8_t) ACK_BYTE);
 }
 
+/**
+ * @brief Sends the trace (see trace.h) to the Raspberry Pi, one TRACE_RECORD frame per record, oldest first, followed by
+ * an empty TRACE frame. Blocks until everything is in the Tx FIFO (the trace is much longer than the FIFO, and the dump
+ * is only sent when the Pi asks for it while debugging)
+ *
+ * @return Whether the transmission was successful (fails on a reset or fault)
+ */
+bool rpi_transmit_trace(void)
+{
+    char message[TRACE_RECORD_INSTR_LENGTH];
+    trace_record_t record;
+    uint16_t count = trace_pause();
+    uint16_t i = 0;
+    bool status = true;
+
+    // Send the records
+    for (i = 0; (i < count) && (status); i++)
+    {
+        trace_get_record(i, &record);
+        message[0] = START_BYTE;
+        message[1] = TRACE_RECORD_INSTR_AND_LEN;
+        trace_serialize(&record, (uint8_t*) &message[2]);
+        rpi_checksum(message, TRACE_RECORD_INSTR_LENGTH-2);
+        status = rpi_transmit_binary_wait(message, TRACE_RECORD_INSTR_LENGTH);
+    }
+
+    // Mark the end of the dump
+    if (status)
+    {
+        message[0] = START_BYTE;
+        message[1] = TRACE_INSTR_AND_LEN;
+        rpi_checksum(message, TRACE_INSTR_LENGTH-2);
+        status = rpi_transmit_binary_wait(message, TRACE_INSTR_LENGTH);
+    }
+
+    trace_resume();
+    return status;
+}
+
+/**
+ * @brief Sends the CPU load measured since the last request (see cpuload.h) to the Raspberry Pi, as one LOAD_RECORD
+ * frame per interrupt (ID TRACE_ISR_*), one for the idle loop (LOAD_RECORD_ID_IDLE) and a last one holding the
+ * length of the window (LOAD_RECORD_ID_WINDOW, in the cycles field). Blocks until everything is in the Tx FIFO
+ *
+ * @return Whether the transmission was successful (fails on a reset or fault)
+ */
+bool rpi_transmit_cpuload(void)
+{
+    static cpuload_snapshot_t snapshot;
+    cpuload_usage_t window = {0, 0, 0};
+    uint8_t i = 0;
+    bool status = true;
+
+    cpuload_take_snapshot(&snapshot);
+    window.cycles = snapshot.window_cycles;
+
+    for (i = 0; (i < CPULOAD_ISR_COUNT) && (status); i++)
+    {
+        status = rpi_transmit_load_record(i, &snapshot.isr[i]);
+    }
+    status = status && rpi_transmit_load_record(LOAD_RECORD_ID_IDLE, &snapshot.idle);
+    status = status && rpi_transmit_load_record(LOAD_RECORD_ID_WINDOW, &window);
+
+    return status;
+}
+
+/**
+ * @brief Sends a single LOAD_RECORD frame: the ID, then the count (32-bit), total cycles (40-bit, saturated) and
+ * longest invocation (32-bit), all little-endian
+ *
+ * @param id TRACE_ISR_*, LOAD_RECORD_ID_IDLE or LOAD_RECORD_ID_WINDOW
+ * @param p_usage The usage to send
+ * @return Whether the transmission was successful
+ */
+static bool rpi_transmit_load_record(uint8_t id, const cpuload_usage_t* p_usage)
+{
+    char message[LOAD_RECORD_INSTR_LENGTH];
+    uint64_t cycles = p_usage->cycles;
+
+    if (cycles > 0xFFFFFFFFFFULL)
+    {
+        cycles = 0xFFFFFFFFFFULL;
+    }
+
+    message[0]  = START_BYTE;
+    message[1]  = LOAD_RECORD_INSTR_AND_LEN;
+    message[2]  = (char) id;
+    message[3]  = (char) (p_usage->count);
+    message[4]  = (char) (p_usage->count >> 8);
+    message[5]  = (char) (p_usage->count >> 16);
+    message[6]  = (char) (p_usage->count >> 24);
+    message[7]  = (char) (cycles);
+    message[8]  = (char) (cycles >> 8);
+    message[9]  = (char) (cycles >> 16);
+    message[10] = (char) (cycles >> 24);
+    message[11] = (char) (cycles >> 32);
+    message[12] = (char) (p_usage->max_cycles);
+    message[13] = (char) (p_usage->max_cycles >> 8);
+    message[14] = (char) (p_usage->max_cycles >> 16);
+    message[15] = (char) (p_usage->max_cycles >> 24);
+    rpi_checksum(message, LOAD_RECORD_INSTR_LENGTH-2);
+
+    return rpi_transmit_binary_wait(message, LOAD_RECORD_INSTR_LENGTH);
+}
+
 /**
  * @brief Clears the Tx and Rx fifos for RPi communication
  */
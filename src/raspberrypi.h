@@ -15,6 +15,9 @@
 #include "clock.h"
 #include "command_queue.h"
 #include "gpio.h"
+#include "cpuload.h"
+#include "metrics.h"
+#include "trace.h"
 #include "uart.h"
 #include "utils.h"
 #include <stdint.h>
@@ -32,9 +35,23 @@
 // UART instructions are defined as:
 //  - 1 start byte (0x0A)
 //  - 1 byte containing the instruction ID (4 bits) and the operand length in bytes (4 bits)
-//  - 0 - 5 bytes containing the operand
+//  - 0 - 15 bytes containing the operand (only trace, metrics and load records are longer than 5)
 //  - 2 bytes containing the check bytes for the instruction
 
+// Note on receiving instructions:
+//  - rpi_receive_frame() never blocks: it takes whatever bytes have arrived, and keeps a partial instruction in an
+//    rpi_frame_t until the rest comes in. Commands call it from their action, which runs again on EVENT_UART_RX
+//  - Bytes before a start byte are skipped, and an instruction whose check bytes do not match is dropped
+//  - Call it until it returns false, since one receive interrupt may have delivered more than one instruction
+
+// Note on transmitting instructions:
+//  - rpi_transmit() and rpi_transmit_binary() never block either: they queue the whole instruction in the UART's
+//    software Tx FIFO, which the Tx interrupt drains, or return false having queued nothing. The caller sends it again
+//    later (the comm command on its timeout, the metrics command from its action)
+//  - An instruction is at most RPI_FRAME_MAX_LENGTH bytes, so it always fits once the FIFO has drained
+//  - The trace and CPU load dumps are longer than the FIFO, so they still wait for it to drain. The Pi only asks for
+//    them while debugging
+
 // Start byte + ACK signal
 #define START_BYTE                          (0x0A)
 #define ACK_BYTE                            (0x0F)
@@ -46,6 +63,9 @@
 #define HUMAN_MOVE_INSTR                    (0x03)
 #define ROBOT_MOVE_INSTR                    (0x04)
 #define ILLEGAL_MOVE_INSTR                  (0x05)
+#define TRACE_INSTR                         (0x06)
+#define METRICS_INSTR                       (0x07)
+#define LOAD_INSTR                          (0x08)
 
 // Instruction and operand length bytes
 #define RESET_INSTR_AND_LEN                 (0x00)
@@ -54,6 +74,11 @@
 #define HUMAN_MOVE_INSTR_AND_LEN            (0x35)
 #define ROBOT_MOVE_INSTR_AND_LEN            (0x46)
 #define ILLEGAL_MOVE_INSTR_AND_LEN          (0x50)
+#define TRACE_INSTR_AND_LEN                 (0x60)             // Request from the Pi, and the end of the dump
+#define TRACE_RECORD_INSTR_AND_LEN          (0x68)             // One trace record (see trace.h)
+#define METRICS_INSTR_AND_LEN               (0x7F)             // Turn phase times (see metrics.h)
+#define LOAD_INSTR_AND_LEN                  (0x80)             // Request from the Pi
+#define LOAD_RECORD_INSTR_AND_LEN           (0x8E)             // Usage of one interrupt, the idle loop, or the window
 
 // Full Instructions/Operations
 #define RESET                               (0x0A00)             // Reset a terminated game
@@ -72,6 +97,13 @@
 #define START_INSTR_LENGTH                   (4)
 #define RESET_INSTR_LENGTH                   (4)
 #define HUMAN_MOVE_INSTR_LENGTH              (9)
+#define TRACE_INSTR_LENGTH                   (4)
+#define TRACE_RECORD_INSTR_LENGTH            (4 + TRACE_RECORD_SIZE)
+#define METRICS_INSTR_LENGTH                 (4 + (3 * METRICS_PHASE_COUNT))
+#define LOAD_RECORD_INSTR_LENGTH             (18)
+#define LOAD_RECORD_ID_IDLE                  (0xFE)
+#define LOAD_RECORD_ID_WINDOW                (0xFF)
+#define RPI_FRAME_MAX_LENGTH                 (4 + 15)         // Start, instruction, operand, check bytes
 
 // Information from the PI for making a chess move
 // Use '\0' for undefined file and 0 for undefined rank
@@ -83,6 +115,13 @@ typedef struct chess_move_t {
     chess_move_type_t move_type;
 } chess_move_t;
 
+// An instruction being received (see rpi_receive_frame())
+typedef struct rpi_frame_t {
+    uint8_t uart_channel;           // Where the instruction comes from
+    uint8_t count;                  // Bytes received so far
+    char data[RPI_FRAME_MAX_LENGTH];
+} rpi_frame_t;
+
 typedef enum game_status_t {
     ONGOING,
     HUMAN_WIN,
@@ -93,15 +132,21 @@ typedef enum game_status_t {
 // Public functions
 void rpi_init(void);
 bool rpi_transmit(char* data, uint8_t size);
+bool rpi_transmit_binary(char* data, uint8_t size);
 bool rpi_receive(char *data, uint8_t size);
 bool rpi_receive_unblocked(char *data, uint8_t size);
+void rpi_frame_init(rpi_frame_t* p_frame, uint8_t uart_channel);
+bool rpi_receive_frame(rpi_frame_t* p_frame);
 void rpi_reset_uart(void);
 
 // Raspberry Pi instruction functions
 char* rpi_build_reset_msg(char message[RESET_INSTR_LENGTH]);
 char* rpi_build_start_msg(char color, char message[START_INSTR_LENGTH]);
 bool rpi_build_human_move_msg(char move[5], char message[HUMAN_MOVE_INSTR_LENGTH]);
+char* rpi_build_metrics_msg(char message[METRICS_INSTR_LENGTH]);
 bool rpi_transmit_ack(void);
+bool rpi_transmit_trace(void);
+bool rpi_transmit_cpuload(void);
 chess_move_t rpi_castle_get_rook_move(chess_move_t *king_move);
 
 #endif /* RASPBERRYPI_H_ */
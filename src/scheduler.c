@@ -0,0 +1,271 @@
+/**
+ * @file scheduler.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Runs queued commands cooperatively, several at a time when their resources do not overlap
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "scheduler.h"
+#include "command_pool.h"
+#include "trace.h"
+
+// A command being run
+typedef struct scheduler_slot_t {
+    command_t* p_command;
+    command_lane_t lane;
+    bool ready;                     // Evaluate on the next pass, whatever the events
+} scheduler_slot_t;
+
+// Private functions
+static void scheduler_preempt(void);
+static bool scheduler_issue(void);
+static bool scheduler_step(uint8_t events);
+static uint8_t scheduler_get_active_resources(void);
+static void scheduler_release(scheduler_slot_t* p_slot);
+
+static scheduler_slot_t slots[SCHEDULER_MAX_ACTIVE];
+
+/**
+ * @brief Initializes the scheduler. Starts with nothing running
+ */
+void scheduler_init(void)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < SCHEDULER_MAX_ACTIVE; i++)
+    {
+        slots[i].p_command = NULL;
+        slots[i].lane      = COMMAND_LANE_NORMAL;
+        slots[i].ready     = false;
+    }
+}
+
+/**
+ * @brief Runs one pass of the scheduler (call continuously from the main loop). Sleeps if the pass changed nothing
+ */
+void scheduler_run(void)
+{
+    uint8_t events = event_take(EVENT_ALL);
+    bool progress = false;
+
+    scheduler_preempt();
+    progress |= scheduler_issue();
+    progress |= scheduler_step(events);
+
+    // Nothing can change until an interrupt posts an event
+    if (!progress)
+    {
+        event_wait(EVENT_ALL);
+    }
+}
+
+/**
+ * @brief Finds the next queued command, in issue order, that uses (or waits for) any of the given resources
+ *
+ * @param resources Mask of COMMAND_RESOURCE_*
+ * @param p_value Pointer to where the command will be stored
+ * @return Whether such a command was found within the look-ahead
+ */
+bool scheduler_peek_next(uint8_t resources, command_t** p_value)
+{
+    command_lane_t lane = COMMAND_LANE_EMERGENCY;
+    uint16_t index = 0;
+    command_t* p_command;
+
+    for (lane = COMMAND_LANE_EMERGENCY; lane <= COMMAND_LANE_NORMAL; lane++)
+    {
+        for (index = 0; (index < SCHEDULER_LOOKAHEAD) && command_queue_peek_at(lane, index, &p_command); index++)
+        {
+            if ((p_command->p_ops->resources | p_command->p_ops->after) & resources)
+            {
+                *p_value = p_command;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Aborts the active commands in lanes below the highest lane with work waiting
+ */
+static void scheduler_preempt(void)
+{
+    command_lane_t pending_lane = COMMAND_LANE_EMERGENCY;
+    command_t* p_command;
+    uint8_t i = 0;
+
+    // Find the highest lane with a command waiting
+    while ((pending_lane < COMMAND_LANE_NORMAL) && !command_queue_peek_at(pending_lane, 0, &p_command))
+    {
+        pending_lane++;
+    }
+
+    // Normal work never preempts
+    if (pending_lane == COMMAND_LANE_NORMAL)
+    {
+        return;
+    }
+
+    for (i = 0; i < SCHEDULER_MAX_ACTIVE; i++)
+    {
+        if ((slots[i].p_command != NULL) && (slots[i].lane > pending_lane))
+        {
+            // The aborted command has cleaned up, and must not queue anything, so skip its exit
+            slots[i].p_command->p_ops->p_abort(slots[i].p_command);
+            TRACE_RECORD(TRACE_EVENT_COMMAND_ABORT, slots[i].p_command->p_ops->id, i);
+            scheduler_release(&slots[i]);
+        }
+    }
+}
+
+/**
+ * @brief Starts the first queued command that fits in a free slot without a resource conflict
+ *
+ * @return Whether a command was started
+ */
+static bool scheduler_issue(void)
+{
+    command_lane_t lane = COMMAND_LANE_EMERGENCY;
+    uint16_t index = 0;
+    uint8_t blocked = scheduler_get_active_resources();
+    scheduler_slot_t* p_slot = NULL;
+    command_t* p_command;
+    uint8_t i = 0;
+
+    // Find a free slot
+    for (i = 0; (i < SCHEDULER_MAX_ACTIVE) && (p_slot == NULL); i++)
+    {
+        if (slots[i].p_command == NULL)
+        {
+            p_slot = &slots[i];
+        }
+    }
+    if (p_slot == NULL)
+    {
+        return false;
+    }
+
+    // Walk the lanes in priority order. Every command passed over blocks its resources (and those it waits for) for the
+    // ones behind it
+    for (lane = COMMAND_LANE_EMERGENCY; lane <= COMMAND_LANE_NORMAL; lane++)
+    {
+        for (index = 0; (index < SCHEDULER_LOOKAHEAD) && command_queue_peek_at(lane, index, &p_command); index++)
+        {
+            if (!((p_command->p_ops->resources | p_command->p_ops->after) & blocked))
+            {
+                // Claim the slot before running entry (which may push or clear commands)
+                command_queue_remove_at(lane, index, &p_command);
+                p_slot->p_command = p_command;
+                p_slot->lane      = lane;
+                p_slot->ready     = true;
+                TRACE_RECORD(TRACE_EVENT_COMMAND_ENTRY, p_command->p_ops->id, (uint8_t) (p_slot - slots));
+                p_command->p_ops->p_entry(p_command);
+                return true;
+            }
+            blocked |= (p_command->p_ops->resources | p_command->p_ops->after);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Runs each affected command's action once, or its exit once it is done
+ *
+ * @param events The events posted since the last pass
+ * @return Whether any command was evaluated
+ */
+static bool scheduler_step(uint8_t events)
+{
+    bool evaluated = false;
+    command_t* p_command;
+    uint8_t i = 0;
+
+    for (i = 0; i < SCHEDULER_MAX_ACTIVE; i++)
+    {
+        p_command = slots[i].p_command;
+        if (p_command == NULL)
+        {
+            continue;
+        }
+
+        // Only re-evaluate a command when something it waits on happened (faults and resets concern every command)
+        if (!slots[i].ready && (p_command->p_ops->events != EVENT_NONE) && !(events & p_command->p_ops->events) &&
+            !(sys_fault || sys_reset || sys_limit))
+        {
+            continue;
+        }
+        slots[i].ready = false;
+        evaluated = true;
+
+        // is_done() determines when the action is complete
+        if (!p_command->p_ops->p_is_done(p_command))
+        {
+            // Check for a system fault (E-stop, etc.) or reset
+            if (sys_fault)
+            {
+                // In the case of a fault, force a hard fault
+                command_t* p_bad_command = NULL;
+                p_bad_command->p_ops->p_entry(p_bad_command);
+            }
+            else if (!(sys_reset || sys_limit))
+            {
+                // The action may finish the command without any further event, so check again straight away
+                p_command->p_ops->p_action(p_command);
+                if (!p_command->p_ops->p_is_done(p_command))
+                {
+                    continue;
+                }
+            }
+
+            // In the case of a reset, skip actions until the the homing or reset button clears
+        }
+
+        // Run the exit function, then return the command to the pool
+        TRACE_RECORD(TRACE_EVENT_COMMAND_DONE, p_command->p_ops->id, i);
+        p_command->p_ops->p_exit(p_command);
+        TRACE_RECORD(TRACE_EVENT_COMMAND_EXIT, p_command->p_ops->id, i);
+        scheduler_release(&slots[i]);
+    }
+
+    return evaluated;
+}
+
+/**
+ * @brief Combines the resources of every active command
+ *
+ * @return Mask of COMMAND_RESOURCE_*
+ */
+static uint8_t scheduler_get_active_resources(void)
+{
+    uint8_t resources = COMMAND_RESOURCE_NONE;
+    uint8_t i = 0;
+
+    for (i = 0; i < SCHEDULER_MAX_ACTIVE; i++)
+    {
+        if (slots[i].p_command != NULL)
+        {
+            resources |= slots[i].p_command->p_ops->resources;
+        }
+    }
+
+    return resources;
+}
+
+/**
+ * @brief Frees a slot and returns its command to the pool
+ *
+ * @param p_slot The slot
+ */
+static void scheduler_release(scheduler_slot_t* p_slot)
+{
+    command_pool_free(p_slot->p_command);
+    p_slot->p_command = NULL;
+}
+
+/* End scheduler.c */
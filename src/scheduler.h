@@ -0,0 +1,41 @@
+/**
+ * @file scheduler.h
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Runs queued commands cooperatively, several at a time when their resources do not overlap
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+// Note on the scheduler:
+//  - Up to SCHEDULER_MAX_ACTIVE commands run at once. Each call to scheduler_run() does one pass:
+//      1. Preempt: if a higher lane has work, abort every active command in a lower lane
+//      2. Issue: start (at most) one queued command, looking SCHEDULER_LOOKAHEAD commands deep into each lane. A command
+//         may start if its resources overlap neither an active command nor an earlier queued command. Its after
+//         resources (see command_queue.h) are checked the same way, but are not held once it starts
+//      3. Step: run action() once for each active command, or exit() once it is done. Only commands which just started,
+//         or whose events (see event.h) were posted, are evaluated
+//      4. Idle: if the pass started nothing and evaluated nothing, sleep (WFI) until the next interrupt
+//  - Actions must return quickly for the interleaving to help (commands that block, e.g. on a UART read, stall the others)
+//  - A command's entry/exit may push or clear commands, so the lanes are only ever walked fresh at the start of a pass
+
+#include "command_queue.h"
+#include "event.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Scheduler defines
+#define SCHEDULER_MAX_ACTIVE        (4)
+#define SCHEDULER_LOOKAHEAD         (8)
+
+// Function definitions
+void scheduler_init(void);
+void scheduler_run(void);
+bool scheduler_peek_next(uint8_t resources, command_t** p_value);
+
+#endif /* SCHEDULER_H_ */
@@ -12,7 +12,50 @@
 
 // Private functions
 static void sensornetwork_select_file(chess_file_t file);
-static uint8_t sensornetwork_read_rank(chess_rank_t rank);
+static void sensornetwork_build_rank_map(GPIO_Type* port, uint8_t mask, uint8_t* p_map);
+static uint8_t sensornetwork_read_file(void);
+static void sensornetwork_start_scan(void);
+static void sensornetwork_debounce(uint64_t raw);
+static void sensornetwork_calibrate(void);
+static bool sensornetwork_measure_settle(uint8_t file_index, uint8_t reference_index, uint32_t* p_cycles);
+static bool sensornetwork_measure_release(uint8_t file_index, uint8_t settled, uint32_t* p_cycles);
+static uint8_t sensornetwork_read_settled_file(uint8_t file_index);
+
+// Scan state (written by SysTick)
+static uint64_t snapshots[2];                   // Double buffer of debounced readings
+static bool snapshots_stable[2];
+static volatile uint8_t published = 0;          // Index of the buffer holding the last complete reading
+static volatile uint32_t sequence = 0;          // Number of readings published
+static volatile bool scanning = false;
+static uint8_t scan_file_index = 0;
+static uint64_t scan_reading = 0;               // Raw reading of the scan in progress
+static uint16_t scan_ticks = 0;
+
+// Debounce state (a 2-bit vertical counter per tile, see sensornetwork_debounce())
+static uint64_t debounced = 0;
+static uint64_t debounce_count_0 = 0;
+static uint64_t debounce_count_1 = 0;
+static uint8_t stable_scans = 0;
+
+// SysTick reload value for each file, by file index (see sensornetwork_calibrate())
+static uint32_t settle_periods[NUMBER_OF_COLS] = {
+    SYSTICK_PERIOD, SYSTICK_PERIOD, SYSTICK_PERIOD, SYSTICK_PERIOD,
+    SYSTICK_PERIOD, SYSTICK_PERIOD, SYSTICK_PERIOD, SYSTICK_PERIOD
+};
+
+// Row data lines, by rank index
+static GPIO_Type* const rank_ports[NUMBER_OF_ROWS] = {
+    SENSOR_ROW_DATA_1_PORT, SENSOR_ROW_DATA_2_PORT, SENSOR_ROW_DATA_3_PORT, SENSOR_ROW_DATA_4_PORT,
+    SENSOR_ROW_DATA_5_PORT, SENSOR_ROW_DATA_6_PORT, SENSOR_ROW_DATA_7_PORT, SENSOR_ROW_DATA_8_PORT
+};
+static const uint8_t rank_pins[NUMBER_OF_ROWS] = {
+    SENSOR_ROW_DATA_1_PIN, SENSOR_ROW_DATA_2_PIN, SENSOR_ROW_DATA_3_PIN, SENSOR_ROW_DATA_4_PIN,
+    SENSOR_ROW_DATA_5_PIN, SENSOR_ROW_DATA_6_PIN, SENSOR_ROW_DATA_7_PIN, SENSOR_ROW_DATA_8_PIN
+};
+
+// Port bits to rank bits (bit i is rank index i), indexed by the masked DATA register
+static uint8_t rank_map_l[SENSOR_ROW_DATA_L_MASK + 1];
+static uint8_t rank_map_h[SENSOR_ROW_DATA_H_MASK + 1];
 
 /**
  * @brief Initialize the sensor select and data lines
@@ -36,6 +79,74 @@ void sensornetwork_init(void)
     gpio_set_as_input(SENSOR_ROW_DATA_6_PORT, SENSOR_ROW_DATA_6_PIN);
     gpio_set_as_input(SENSOR_ROW_DATA_7_PORT, SENSOR_ROW_DATA_7_PIN);
     gpio_set_as_input(SENSOR_ROW_DATA_8_PORT, SENSOR_ROW_DATA_8_PIN);
+
+    // Build the rank tables
+    sensornetwork_build_rank_map(SENSOR_ROW_DATA_L_PORT, SENSOR_ROW_DATA_L_MASK, rank_map_l);
+    sensornetwork_build_rank_map(SENSOR_ROW_DATA_H_PORT, SENSOR_ROW_DATA_H_MASK, rank_map_h);
+
+    // Measure how long each file takes to settle
+    sensornetwork_calibrate();
+}
+
+/**
+ * @brief Starts a scan every SENSORNETWORK_SCAN_PERIOD_TICKS (called from the gantry interrupt)
+ */
+void sensornetwork_tick(void)
+{
+    scan_ticks++;
+    if (scan_ticks < SENSORNETWORK_SCAN_PERIOD_TICKS)
+    {
+        return;
+    }
+    scan_ticks = 0;
+
+    // A scan takes far less than the period, so one should never be running here (never restart one that is)
+    if (!scanning)
+    {
+        sensornetwork_start_scan();
+    }
+}
+
+/**
+ * @brief Gets the last debounced reading
+ *
+ * @param p_reading Pointer to where the reading will be stored
+ * @param p_stable Pointer to where the reading's stability will be stored
+ * @return The sequence number of the reading (0 if there has been no scan yet)
+ */
+uint32_t sensornetwork_get_snapshot(uint64_t* p_reading, bool* p_stable)
+{
+    uint32_t seen;
+
+    // If a reading is published while copying, copy again (a scan takes far longer than the copy)
+    do
+    {
+        seen = sequence;
+        *p_reading = snapshots[published];
+        *p_stable  = snapshots_stable[published];
+    } while (seen != sequence);
+
+    return seen;
+}
+
+/**
+ * @brief Gets the last debounced reading, if the board was stable
+ *
+ * @param p_reading Pointer to where the reading will be stored (only written if stable)
+ * @return Whether the board was stable
+ */
+bool sensornetwork_get_stable_snapshot(uint64_t* p_reading)
+{
+    uint64_t reading;
+    bool stable;
+
+    sensornetwork_get_snapshot(&reading, &stable);
+    if (stable)
+    {
+        *p_reading = reading;
+    }
+
+    return stable;
 }
 
 /**
@@ -103,90 +214,330 @@ static void sensornetwork_select_file(chess_file_t file)
 }
 
 /**
- * @brief Reads a given row
+ * @brief Fills the table mapping the bits of a row data port to rank bits
  *
- * @param rank The row to select
- * @return The reading of the given tile
+ * @param port The row data port
+ * @param mask The row data pins on that port
+ * @param p_map The table (mask + 1 entries)
  */
-static uint8_t sensornetwork_read_rank(chess_rank_t rank)
+static void sensornetwork_build_rank_map(GPIO_Type* port, uint8_t mask, uint8_t* p_map)
 {
-    uint8_t reading = 0;
+    uint16_t value = 0;
+    uint8_t i = 0;
 
-    // Set the column select lines
-    switch (rank)
+    for (value = 0; value <= mask; value++)
     {
-        case FIRST:     // Select == 000
-            reading = gpio_read_input(SENSOR_ROW_DATA_1_PORT, SENSOR_ROW_DATA_1_PIN);
-        break;
+        p_map[value] = 0;
+        for (i = 0; i < NUMBER_OF_ROWS; i++)
+        {
+            if ((rank_ports[i] == port) && (value & rank_pins[i]))
+            {
+                p_map[value] |= BITS8_MASK(i);
+            }
+        }
+    }
+}
 
-        case SECOND:    // Select == 001
-            reading = gpio_read_input(SENSOR_ROW_DATA_2_PORT, SENSOR_ROW_DATA_2_PIN);
-        break;
+/**
+ * @brief Reads every rank of the selected file
+ *
+ * @return The readings (bit i is rank index i)
+ */
+static uint8_t sensornetwork_read_file(void)
+{
+    return rank_map_l[SENSOR_ROW_DATA_L_PORT->DATA & SENSOR_ROW_DATA_L_MASK] |
+           rank_map_h[SENSOR_ROW_DATA_H_PORT->DATA & SENSOR_ROW_DATA_H_MASK];
+}
 
-        case THIRD:     // Select == 010
-            reading = gpio_read_input(SENSOR_ROW_DATA_3_PORT, SENSOR_ROW_DATA_3_PIN);
-        break;
+/**
+ * @brief Sets the settle period of every file from measurements (see the note on settle calibration)
+ */
+static void sensornetwork_calibrate(void)
+{
+    uint8_t settled[NUMBER_OF_COLS];
+    uint32_t cycles[NUMBER_OF_COLS];
+    uint32_t switch_cycles = 0;
+    bool measured[NUMBER_OF_COLS];
+    uint32_t longest = 0;
+    uint8_t reference = 0;
+    uint8_t i = 0;
+    uint8_t j = 0;
 
-        case FOURTH:    // Select == 011
-            reading = gpio_read_input(SENSOR_ROW_DATA_4_PORT, SENSOR_ROW_DATA_4_PIN);
-        break;
+    // What each file reads once settled
+    for (i = 0; i < NUMBER_OF_COLS; i++)
+    {
+        settled[i] = sensornetwork_read_settled_file(i);
+    }
 
-        case FIFTH:     // Select == 100
-            reading = gpio_read_input(SENSOR_ROW_DATA_5_PORT, SENSOR_ROW_DATA_5_PIN);
-        break;
+    for (i = 0; i < NUMBER_OF_COLS; i++)
+    {
+        // Release the empty ranks from the active level, so the slow (pulled) edge is seen whatever the board holds
+        measured[i] = sensornetwork_measure_release(i, settled[i], &cycles[i]);
 
-        case SIXTH:     // Select == 101
-            reading = gpio_read_input(SENSOR_ROW_DATA_6_PORT, SENSOR_ROW_DATA_6_PIN);
-        break;
+        // Also switch from the closest file before it (in scan order) which reads differently, if there is one
+        for (j = 1; j < NUMBER_OF_COLS; j++)
+        {
+            reference = (i + NUMBER_OF_COLS - j) % NUMBER_OF_COLS;
+            if (settled[reference] != settled[i])
+            {
+                if (sensornetwork_measure_settle(i, reference, &switch_cycles) && (!measured[i] || (switch_cycles > cycles[i])))
+                {
+                    cycles[i]   = switch_cycles;
+                    measured[i] = true;
+                }
+                break;
+            }
+        }
 
-        case SEVENTH:   // Select == 110
-            reading = gpio_read_input(SENSOR_ROW_DATA_7_PORT, SENSOR_ROW_DATA_7_PIN);
-        break;
+        if (measured[i])
+        {
+            // Leave a margin, within the bounds of the scan
+            cycles[i] = (2 * cycles[i]) + SENSORNETWORK_SETTLE_MARGIN;
+            if (cycles[i] < SENSORNETWORK_SETTLE_MIN)
+            {
+                cycles[i] = SENSORNETWORK_SETTLE_MIN;
+            }
+            else if (cycles[i] > SENSORNETWORK_CALIBRATION_WINDOW)
+            {
+                cycles[i] = SENSORNETWORK_CALIBRATION_WINDOW;
+            }
 
-        case EIGHTH:    // Select == 111
-            reading = gpio_read_input(SENSOR_ROW_DATA_8_PORT, SENSOR_ROW_DATA_8_PIN);
-        break;
+            if (cycles[i] > longest)
+            {
+                longest = cycles[i];
+            }
+        }
+    }
 
-        default:
-            // Invalid rank, do nothing
-        break;
+    // Files which could not be measured take the longest period measured, or keep the default if none was
+    for (i = 0; i < NUMBER_OF_COLS; i++)
+    {
+        if (measured[i])
+        {
+            settle_periods[i] = cycles[i] - 1;
+        }
+        else if (longest > 0)
+        {
+            settle_periods[i] = longest - 1;
+        }
     }
+}
+
+/**
+ * @brief Reads a file once it has fully settled
+ *
+ * @param file_index The file
+ * @return The ranks of the file
+ */
+static uint8_t sensornetwork_read_settled_file(uint8_t file_index)
+{
+    uint32_t start = 0;
 
-    return reading;
+    sensornetwork_select_file(utils_index_to_file(file_index));
+    start = clock_get_cycles();
+    while ((clock_get_cycles() - start) < SENSORNETWORK_CALIBRATION_WINDOW);
+
+    return sensornetwork_read_file();
 }
 
 /**
- * @brief Gets the current sensor network reading
- * 
- * @return uint64_t The sensor readings
+ * @brief Measures how long a file takes to settle after another file
+ *
+ * @param file_index The file
+ * @param reference_index The file selected before it (which should read differently, or nothing can be seen)
+ * @param p_cycles Where to store the cycles from selecting the file to its reading last changing
+ * @return Whether the reading changed (if not, the settle time could not be seen)
  */
-uint64_t sensornetwork_get_reading(void)
+static bool sensornetwork_measure_settle(uint8_t file_index, uint8_t reference_index, uint32_t* p_cycles)
 {
-    uint64_t sensor_reading = 0;
-    chess_file_t file = A;
-    chess_rank_t rank = FIRST;
+    uint32_t start = 0;
+    uint32_t elapsed = 0;
+    uint32_t primask = 0;
+    uint8_t reading = 0;
+    uint8_t last_reading = 0;
+    bool changed = false;
 
-    // Loop through all tiles
-    int i = 0;
-    int j = 0;
-    for (i = 0; i < NUMBER_OF_COLS; i++)
+    // Let the reference file settle fully
+    sensornetwork_read_settled_file(reference_index);
+
+    // Sample the file from the moment it is selected (interrupts would stretch the samples)
+    primask = utils_enter_critical();
+    last_reading = sensornetwork_read_file();
+    sensornetwork_select_file(utils_index_to_file(file_index));
+    start = clock_get_cycles();
+
+    do
+    {
+        reading = sensornetwork_read_file();
+        elapsed = clock_get_cycles() - start;
+
+        if (reading != last_reading)
+        {
+            *p_cycles    = elapsed;
+            last_reading = reading;
+            changed      = true;
+        }
+    } while (elapsed < SENSORNETWORK_CALIBRATION_WINDOW);
+
+    utils_exit_critical(primask);
+    return changed;
+}
+
+/**
+ * @brief Measures how long the empty ranks of a file take to fall back to idle once released from the active level
+ *
+ * @param file_index The file
+ * @param settled What the file reads once settled (its empty ranks are the ones to drive)
+ * @param p_cycles Where to store the cycles from releasing the ranks to the reading last differing from settled
+ * @return Whether the file has an empty rank (if not, nothing can be driven)
+ */
+static bool sensornetwork_measure_release(uint8_t file_index, uint8_t settled, uint32_t* p_cycles)
+{
+    uint8_t pins_l = 0;
+    uint8_t pins_h = 0;
+    uint32_t start = 0;
+    uint32_t elapsed = 0;
+    uint32_t primask = 0;
+    uint8_t i = 0;
+
+    // The empty ranks, as pins of the two row data ports
+    for (i = 0; i < NUMBER_OF_ROWS; i++)
+    {
+        if (!(settled & BITS8_MASK(i)))
+        {
+            if (rank_ports[i] == SENSOR_ROW_DATA_L_PORT)
+            {
+                pins_l |= rank_pins[i];
+            }
+            else
+            {
+                pins_h |= rank_pins[i];
+            }
+        }
+    }
+    if ((pins_l | pins_h) == 0)
+    {
+        return false;
+    }
+
+    // Let the file settle, then drive its empty ranks high (the diodes of every file are then reverse biased, so only
+    // the pull-downs are driven against)
+    sensornetwork_read_settled_file(file_index);
+    primask = utils_enter_critical();
+    SENSOR_ROW_DATA_L_PORT->DATA |= pins_l;
+    SENSOR_ROW_DATA_H_PORT->DATA |= pins_h;
+    SENSOR_ROW_DATA_L_PORT->DIR  |= pins_l;
+    SENSOR_ROW_DATA_H_PORT->DIR  |= pins_h;
+    start = clock_get_cycles();
+    while ((clock_get_cycles() - start) < SENSORNETWORK_RELEASE_DRIVE);
+
+    // Release them, and sample until the window ends (the reading must end up settled again)
+    SENSOR_ROW_DATA_L_PORT->DIR &= ~pins_l;
+    SENSOR_ROW_DATA_H_PORT->DIR &= ~pins_h;
+    start = clock_get_cycles();
+    *p_cycles = 0;
+
+    do
     {
-        // Select the file
-        file = utils_index_to_file(i);
-        sensornetwork_select_file(file);
+        uint8_t reading = sensornetwork_read_file();
+        elapsed = clock_get_cycles() - start;
 
-        for (j = 0; j < NUMBER_OF_ROWS; j++)
+        if (reading != settled)
         {
-            // Delay due to propogation
-            utils_delay(300);
+            *p_cycles = elapsed;
+        }
+    } while (elapsed < SENSORNETWORK_CALIBRATION_WINDOW);
+
+    utils_exit_critical(primask);
+    return true;
+}
+
+/**
+ * @brief Runs the debounce over a complete raw reading. A tile changes once it has read differently for
+ *        SENSORNETWORK_DEBOUNCE_SCANS scans in a row, and the board is stable once no tile has read differently for
+ *        SENSORNETWORK_STABLE_SCANS scans
+ *
+ * @param raw The raw reading
+ */
+static void sensornetwork_debounce(uint64_t raw)
+{
+    uint64_t delta = raw ^ debounced;
+
+    // Count each differing tile up by one (mod 4), and reset the others. A tile toggles when its count wraps to zero
+    debounce_count_1 = (debounce_count_1 ^ debounce_count_0) & delta;
+    debounce_count_0 = (~debounce_count_0) & delta;
+    debounced ^= delta & ~(debounce_count_0 | debounce_count_1);
+
+    if (delta != 0)
+    {
+        stable_scans = 0;
+    }
+    else if (stable_scans < SENSORNETWORK_STABLE_SCANS)
+    {
+        stable_scans++;
+    }
+}
+
+/**
+ * @brief Starts a scan from file A (call from the gantry interrupt)
+ */
+static void sensornetwork_start_scan(void)
+{
+    scanning        = true;
+    scan_file_index = 0;
+    scan_reading    = 0;
+
+    // Let the first file settle
+    sensornetwork_select_file(utils_index_to_file(scan_file_index));
+    clock_set_systick_period(settle_periods[scan_file_index]);
+    clock_start_systick();
+}
+
+/* Interrupts */
+
+/**
+ * @brief Interrupt handler for the board scan. Latches the settled file, then selects the next one
+ */
+__interrupt void SENSORNETWORK_HANDLER(void)
+{
+    ISR_ENTER(TRACE_ISR_SCAN, 0);
 
-            // Read the rank
-            rank = utils_index_to_rank(j);
-            sensor_reading |= (((uint64_t) sensornetwork_read_rank(rank)) << utils_tile_to_index(file, rank));
+    uint64_t reading = scan_reading;
+    uint8_t ranks = sensornetwork_read_file();
+    uint8_t i = 0;
+
+    // Latch every rank of the selected file (tile index = file index + 8 * rank index)
+    for (i = 0; i < NUMBER_OF_ROWS; i++)
+    {
+        if (ranks & BITS8_MASK(i))
+        {
+            reading |= (((uint64_t) 1) << (scan_file_index + (i * NUMBER_OF_COLS)));
         }
     }
+    scan_reading = reading;
+
+    scan_file_index++;
+    if (scan_file_index < NUMBER_OF_COLS)
+    {
+        // Let the next file settle
+        sensornetwork_select_file(utils_index_to_file(scan_file_index));
+        clock_set_systick_period(settle_periods[scan_file_index]);
+    }
+    else
+    {
+        clock_stop_systick();
+        scanning = false;
+
+        // Publish the debounced reading (swap the buffers first, so the new sequence number always finds it)
+        sensornetwork_debounce(scan_reading);
+        snapshots[published ^ 1]        = debounced;
+        snapshots_stable[published ^ 1] = (stable_scans >= SENSORNETWORK_STABLE_SCANS);
+        published ^= 1;
+        sequence++;
+        event_post(EVENT_SCAN);
+    }
 
-    return sensor_reading;
+    ISR_EXIT(TRACE_ISR_SCAN, 0);
 }
 
 /* End sensornetwork.c */
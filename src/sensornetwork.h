@@ -14,15 +14,65 @@
 // Note on sensor network:
 //  - Assumes a multiplexed crosspoint array
 //  - Sends signals on the rows, reads on the columns
-//  - Due to propogation delay in the diodes, reading is on-demand (no interrupt)
+//  - Due to propogation delay in the diodes, each file must settle after it is selected before its ranks are read
+//  - The eight row lines are on two ports (GPIOL and GPIOH), so all ranks of a file are latched with two register reads.
+//    Tables built by sensornetwork_init() map the port bits to rank order
+
+// Note on scanning:
+//  - The board is scanned continuously, SENSORNETWORK_SCAN_FREQUENCY times a second. The gantry interrupt starts each
+//    scan through sensornetwork_tick(), and SysTick drives it (one settle period per file), so nothing
+//    busy-waits:
+//      1. sensornetwork_start_scan() selects file A and starts SysTick
+//      2. Each SysTick interrupt latches the ranks of the selected file, then selects the next file and restarts SysTick
+//         with that file's settle period
+//      3. After file H, SysTick stops, the raw reading is debounced, the result is published and EVENT_SCAN is posted
+//  - Each tile is debounced with a 2-bit vertical counter: it only changes after SENSORNETWORK_DEBOUNCE_SCANS scans in
+//    a row disagree with it, so reed switch bounce and a hand passing over a tile are filtered out
+//  - The board is "stable" once no tile has disagreed for SENSORNETWORK_STABLE_SCANS scans. A stable reading matches
+//    the board as of the last scan, so it can be used right away (no fresh scan is needed)
+//  - Readings are double buffered: the interrupt fills one buffer while the other holds the last published reading,
+//    then swaps them and bumps a sequence number. Readers never see a partial scan
+
+// Note on settle calibration:
+//  - sensornetwork_init() measures how long each file takes to settle with the DWT cycle counter (which must already be
+//    running). A settle time can only be seen on a line which has to change, so each file is measured two ways:
+//      - Release: the file is selected and left to settle, then its empty ranks are driven high (the level of an
+//        occupied tile) for SENSORNETWORK_RELEASE_DRIVE and released. The ranks are read for
+//        SENSORNETWORK_CALIBRATION_WINDOW, noting when the reading last differed from the settled one. This is the
+//        edge that only the pull-downs drive, and it can be seen on every file with an empty rank, even with the pieces
+//        in their starting positions. Driving high is safe: the diodes of every file are then reverse biased
+//      - Switch: if a file before it in scan order reads differently once settled, the closest such file is selected
+//        and left to settle, then the file is selected and read the same way. This also covers the select lines and
+//        the edge the selected file drives
+//  - The settle period of the file is twice the longer of the two plus SENSORNETWORK_SETTLE_MARGIN, at least
+//    SENSORNETWORK_SETTLE_MIN and at most the window. The minimum only keeps the scan interrupts (one per file) from
+//    crowding the core, so a fast board scans faster than the 20us default
+//  - Files which cannot be measured (every rank occupied, and no file reading differently) use the longest period
+//    measured on any file. If nothing could be measured, every file keeps the default SYSTICK_PERIOD (20us, the period
+//    the SysTick scan started with)
+//  - Periods are kept as SysTick reload values. SysTick and the cycle counter both count core clock cycles, so the
+//    periods are times, whatever the clock configuration
 
 #include "msp.h"
 #include "clock.h"
+#include "cpuload.h"
+#include "event.h"
 #include "gpio.h"
 #include "utils.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 // General sensor defines
+#define SENSORNETWORK_HANDLER               (SysTick_Handler)
+#define SENSORNETWORK_SCAN_FREQUENCY        (50)        // Hz
+#define SENSORNETWORK_SCAN_PERIOD_TICKS     (SYSCLOCK_FREQUENCY / (TIMER_4A_PERIOD + 1) / SENSORNETWORK_SCAN_FREQUENCY)
+#define SENSORNETWORK_DEBOUNCE_SCANS        (4)         // Fixed by the 2-bit counter (80ms @ 50Hz)
+#define SENSORNETWORK_STABLE_SCANS          (5)         // 100ms @ 50Hz
+#define SENSORNETWORK_CALIBRATION_WINDOW    (2 * (SYSTICK_PERIOD + 1))      // Cycles (40us @ 120MHz)
+#define SENSORNETWORK_RELEASE_DRIVE         (SYSCLOCK_FREQUENCY / 1000000)  // Cycles (1us)
+#define SENSORNETWORK_SETTLE_MARGIN         (SYSCLOCK_FREQUENCY / 1000000)  // Cycles (1us)
+#define SENSORNETWORK_SETTLE_MIN            (SYSCLOCK_FREQUENCY / 500000)   // Cycles (2us)
+
 #define NUMBER_OF_ROWS                      (8)
 #define NUMBER_OF_COLS                      (8)
 #define NUMBER_OF_SENSOR_ROW_SELECTS        (3)
@@ -54,8 +104,17 @@
 #define SENSOR_ROW_DATA_8_PORT              (GPIOL)
 #define SENSOR_ROW_DATA_8_PIN               (GPIO_PIN_5)
 
+// Sensor row data ports (every row line is on one of these, see sensornetwork_read_file())
+#define SENSOR_ROW_DATA_L_PORT              (GPIOL)
+#define SENSOR_ROW_DATA_L_MASK              (SENSOR_ROW_DATA_2_PIN | SENSOR_ROW_DATA_3_PIN | SENSOR_ROW_DATA_5_PIN | \
+                                             SENSOR_ROW_DATA_6_PIN | SENSOR_ROW_DATA_7_PIN | SENSOR_ROW_DATA_8_PIN)
+#define SENSOR_ROW_DATA_H_PORT              (GPIOH)
+#define SENSOR_ROW_DATA_H_MASK              (SENSOR_ROW_DATA_1_PIN | SENSOR_ROW_DATA_4_PIN)
+
 // Public functions
 void sensornetwork_init(void);
-uint64_t sensornetwork_get_reading(void);
+void sensornetwork_tick(void);
+uint32_t sensornetwork_get_snapshot(uint64_t* p_reading, bool* p_stable);
+bool sensornetwork_get_stable_snapshot(uint64_t* p_reading);
 
 #endif /* SENSORNETWORK_H_ */
@@ -24,9 +24,25 @@ static uint32_t stepper_velocity_to_timer_period(uint16_t velocity, bool z_axis)
 static void stepper_disable_motor(stepper_motors_t *stepper_motor);
 static void stepper_disable_all_motors(void);
 static void stepper_enable_motor(stepper_motors_t *stepper_motor);
+static uint32_t stepper_get_transitions_per_mm(stepper_motors_t *p_stepper_motor);
+#ifdef STEPPER_DEBUG
 static int32_t stepper_get_current_pos_mm(stepper_motors_t *p_stepper_motor);
-static void stepper_update_velocities(uint32_t v_x, uint32_t v_y, uint32_t v_z, uint32_t max_a_x, uint32_t max_a_y, uint32_t max_a_z);
-static uint64_t stepper_get_period_shift(stepper_motors_t* p_stepper_motor);
+#endif
+static int32_t stepper_get_target_pos_mm(stepper_motors_t *p_stepper_motor);
+static stepper_motors_t* stepper_setup_coordinated_motion(uint8_t axes);
+static float stepper_get_coordinated_feed_scale(stepper_motors_t* p_master);
+static void stepper_bound_envelope(stepper_envelope_t* p_envelope, const stepper_envelope_t* p_requested, uint32_t max_v, uint32_t max_a, bool z_axis);
+static uint32_t stepper_get_ramp_transitions(stepper_motors_t* p_stepper_motor, const stepper_envelope_t* p_envelope);
+static void stepper_plan_ramp(stepper_motors_t* p_stepper_motor, const stepper_envelope_t* p_envelope);
+static void stepper_start_motor(stepper_motors_t* p_stepper_motor, const stepper_envelope_t* p_envelope);
+static void stepper_update_velocities(const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, const stepper_envelope_t* p_envelope_z, stepper_motion_mode_t mode, uint8_t axes);
+static bool stepper_can_blend(void);
+static uint32_t stepper_get_period_factor(const stepper_envelope_t* p_envelope, uint32_t ramp_transitions);
+static void stepper_setup_profile(stepper_motors_t* p_stepper_motor);
+static uint32_t stepper_get_period_shift(stepper_motors_t* p_stepper_motor, uint32_t ramp_index, uint32_t ramp_length);
+static void stepper_interpolate_activity(stepper_motors_t *p_master);
+static void stepper_home_move(stepper_motors_t* p_stepper_motor, int16_t distance, const stepper_envelope_t* p_envelope, stepper_home_state_t home_state);
+static void stepper_home_halt(stepper_motors_t* p_stepper_motor);
 static void stepper_interrupt_activity(stepper_motors_t *p_stepper_motor);
 
 // Declare the stepper motors
@@ -35,8 +51,52 @@ static stepper_motors_t* p_stepper_motor_x = &stepper_motors[STEPPER_X_ID];
 static stepper_motors_t* p_stepper_motor_y = &stepper_motors[STEPPER_Y_ID];
 static stepper_motors_t* p_stepper_motor_z = &stepper_motors[STEPPER_Z_ID];
 
+// Homing envelopes (the fast approach is bounded per axis when the command is built)
+static const stepper_envelope_t stepper_home_fast_envelope = {STEPPER_HOME_FAST_VELOCITY, STEPPER_HOME_FAST_VELOCITY, 0};
+static const stepper_envelope_t stepper_home_slow_envelope = {STEPPER_HOME_SLOW_VELOCITY, STEPPER_HOME_SLOW_VELOCITY, 0};
+static const stepper_envelope_t stepper_home_backoff_envelopes[NUMBER_OF_STEPPER_MOTORS] = {
+    {HOMING_X_VELOCITY, HOMING_X_VELOCITY, 0},
+    {HOMING_Y_VELOCITY, HOMING_Y_VELOCITY, 0},
+    {HOMING_Z_VELOCITY, HOMING_Z_VELOCITY, 0}
+};
+static const int16_t stepper_home_backoffs[NUMBER_OF_STEPPER_MOTORS] = {HOMING_X_BACKOFF, HOMING_Y_BACKOFF, HOMING_Z_BACKOFF};
+
 // Flags
 static bool stepper_is_homing = false;
+static bool stepper_is_blending = false;
+static volatile bool stepper_hold = false;
+
+// Command operations (one table per command type, kept in flash)
+static const command_ops_t stepper_rel_ops = {
+    .p_entry   = &stepper_rel_entry,
+    .p_action  = &utils_empty_function,
+    .p_exit    = &stepper_exit,
+    .p_is_done = &stepper_is_done,
+    .p_abort   = &stepper_abort,
+    .resources = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_STEPPER | EVENT_TICK,
+    .id        = COMMAND_ID_STEPPER_REL
+};
+static const command_ops_t stepper_chess_ops = {
+    .p_entry   = &stepper_chess_entry,
+    .p_action  = &utils_empty_function,
+    .p_exit    = &stepper_exit,
+    .p_is_done = &stepper_is_done,
+    .p_abort   = &stepper_abort,
+    .resources = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_STEPPER | EVENT_TICK,
+    .id        = COMMAND_ID_STEPPER_CHESS
+};
+static const command_ops_t stepper_home_ops = {
+    .p_entry   = &stepper_home_entry,
+    .p_action  = &stepper_home_action,
+    .p_exit    = &stepper_exit,
+    .p_is_done = &stepper_home_is_done,
+    .p_abort   = &stepper_abort,
+    .resources = COMMAND_RESOURCE_MOTION,
+    .events    = EVENT_STEPPER | EVENT_SWITCH,
+    .id        = COMMAND_ID_STEPPER_HOME
+};
 
 /**
  * @brief Initialize all stepper motors
@@ -62,17 +122,26 @@ void stepper_init_motors(void)
     p_stepper_motor_x->dir_pin                    = STEPPER_X_DIR_PIN;
     p_stepper_motor_x->step_port                  = STEPPER_X_STEP_PORT;
     p_stepper_motor_x->step_pin                   = STEPPER_X_STEP_PIN;
+    p_stepper_motor_x->p_step_data                = gpio_get_masked_data(STEPPER_X_STEP_PORT, STEPPER_X_STEP_PIN);
     p_stepper_motor_x->nenable_port               = STEPPER_X_NENABLE_PORT;
     p_stepper_motor_x->nenable_pin                = STEPPER_X_NENABLE_PIN;
     p_stepper_motor_x->nfault_port                = STEPPER_X_NFAULT_PORT;
     p_stepper_motor_x->nfault_pin                 = STEPPER_X_NFAULT_PIN;
     p_stepper_motor_x->nhome_port                 = STEPPER_X_NHOME_PORT;
     p_stepper_motor_x->nhome_pin                  = STEPPER_X_NHOME_PIN;
+    p_stepper_motor_x->limit_mask                 = LIMIT_X_MASK;
+    p_stepper_motor_x->home_state                 = STEPPER_HOME_DONE;
     p_stepper_motor_x->current_state              = disabled;
     p_stepper_motor_x->transitions_to_desired_pos = 0;
+    p_stepper_motor_x->transitions_total          = 0;
     p_stepper_motor_x->dir                        = 1;
     p_stepper_motor_x->current_pos                = 0;
     p_stepper_motor_x->current_vel                = 0;
+    p_stepper_motor_x->coordinated_mask           = 0;
+    p_stepper_motor_x->profile                    = STEPPER_X_PROFILE;
+    p_stepper_motor_x->jerk_transitions           = 0;
+    p_stepper_motor_x->jerk_factor                = 0;
+    p_stepper_motor_x->dda_error                  = 0;
     p_stepper_motor_x->motor_id                   = STEPPER_X_ID;
 #ifdef STEPPER_DEBUG
     p_stepper_motor_x->time_elapsed               = 0;
@@ -97,17 +166,26 @@ void stepper_init_motors(void)
     p_stepper_motor_y->dir_pin                    = STEPPER_Y_DIR_PIN;
     p_stepper_motor_y->step_port                  = STEPPER_Y_STEP_PORT;
     p_stepper_motor_y->step_pin                   = STEPPER_Y_STEP_PIN;
+    p_stepper_motor_y->p_step_data                = gpio_get_masked_data(STEPPER_Y_STEP_PORT, STEPPER_Y_STEP_PIN);
     p_stepper_motor_y->nenable_port               = STEPPER_Y_NENABLE_PORT;
     p_stepper_motor_y->nenable_pin                = STEPPER_Y_NENABLE_PIN;
     p_stepper_motor_y->nfault_port                = STEPPER_Y_NFAULT_PORT;
     p_stepper_motor_y->nfault_pin                 = STEPPER_Y_NFAULT_PIN;
     p_stepper_motor_y->nhome_port                 = STEPPER_Y_NHOME_PORT;
     p_stepper_motor_y->nhome_pin                  = STEPPER_Y_NHOME_PIN;
+    p_stepper_motor_y->limit_mask                 = LIMIT_Y_MASK;
+    p_stepper_motor_y->home_state                 = STEPPER_HOME_DONE;
     p_stepper_motor_y->current_state              = disabled;
     p_stepper_motor_y->transitions_to_desired_pos = 0;
+    p_stepper_motor_y->transitions_total          = 0;
     p_stepper_motor_y->dir                        = 1;
     p_stepper_motor_y->current_pos                = 0;
     p_stepper_motor_y->current_vel                = 0;
+    p_stepper_motor_y->coordinated_mask           = 0;
+    p_stepper_motor_y->profile                    = STEPPER_Y_PROFILE;
+    p_stepper_motor_y->jerk_transitions           = 0;
+    p_stepper_motor_y->jerk_factor                = 0;
+    p_stepper_motor_y->dda_error                  = 0;
     p_stepper_motor_y->motor_id                   = STEPPER_Y_ID;
 #ifdef STEPPER_DEBUG
     p_stepper_motor_y->time_elapsed               = 0;
@@ -132,17 +210,26 @@ void stepper_init_motors(void)
     p_stepper_motor_z->dir_pin                    = STEPPER_Z_DIR_PIN;
     p_stepper_motor_z->step_port                  = STEPPER_Z_STEP_PORT;
     p_stepper_motor_z->step_pin                   = STEPPER_Z_STEP_PIN;
+    p_stepper_motor_z->p_step_data                = gpio_get_masked_data(STEPPER_Z_STEP_PORT, STEPPER_Z_STEP_PIN);
     p_stepper_motor_z->nenable_port               = STEPPER_Z_NENABLE_PORT;
     p_stepper_motor_z->nenable_pin                = STEPPER_Z_NENABLE_PIN;
     p_stepper_motor_z->nfault_port                = STEPPER_Z_NFAULT_PORT;
     p_stepper_motor_z->nfault_pin                 = STEPPER_Z_NFAULT_PIN;
     p_stepper_motor_z->nhome_port                 = STEPPER_Z_NHOME_PORT;
     p_stepper_motor_z->nhome_pin                  = STEPPER_Z_NHOME_PIN;    
+    p_stepper_motor_z->limit_mask                 = LIMIT_Z_MASK;
+    p_stepper_motor_z->home_state                 = STEPPER_HOME_DONE;
     p_stepper_motor_z->current_state              = disabled;
     p_stepper_motor_z->transitions_to_desired_pos = 0;
+    p_stepper_motor_z->transitions_total          = 0;
     p_stepper_motor_z->dir                        = 1;
     p_stepper_motor_z->current_pos                = 0;
     p_stepper_motor_z->current_vel                = 0;
+    p_stepper_motor_z->coordinated_mask           = 0;
+    p_stepper_motor_z->profile                    = STEPPER_Z_PROFILE;
+    p_stepper_motor_z->jerk_transitions           = 0;
+    p_stepper_motor_z->jerk_factor                = 0;
+    p_stepper_motor_z->dda_error                  = 0;
     p_stepper_motor_z->motor_id                   = STEPPER_Z_ID;
 #ifdef STEPPER_DEBUG
     p_stepper_motor_z->time_elapsed               = 0;
@@ -277,7 +364,8 @@ static void stepper_set_direction_counterclockwise(stepper_motors_t *p_stepper_m
  */
 static void stepper_edge_transition(stepper_motors_t *p_stepper_motor)
 {
-    gpio_set_output_toggle(p_stepper_motor->step_port, p_stepper_motor->step_pin);
+    // The masked address only touches the STEP pin, so no unlock or port-wide read-modify-write is needed
+    *(p_stepper_motor->p_step_data) ^= p_stepper_motor->step_pin;
 }
 
 /**
@@ -426,6 +514,34 @@ bool stepper_z_has_fault(void)
     return nfault == 0;
 }
 
+/**
+ * @brief Gets where a stepper will be once its current move finishes
+ *
+ * @param motor_id One of STEPPER_{X,Y,Z}_ID
+ * @return The position (mm from home)
+ */
+int32_t stepper_get_position_mm(uint8_t motor_id)
+{
+    return stepper_get_target_pos_mm(&stepper_motors[motor_id]);
+}
+
+/**
+ * @brief Returns the number of edge transitions per mm on the given stepper's axis
+ * 
+ * @param p_stepper_motor The stepper motor in question
+ * @return Transitions per mm
+ */
+static uint32_t stepper_get_transitions_per_mm(stepper_motors_t *p_stepper_motor)
+{
+    if (p_stepper_motor->motor_id == STEPPER_Z_ID)
+    {
+        return TRANSITIONS_PER_MM_Z;
+    }
+
+    return TRANSITIONS_PER_MM;
+}
+
+#ifdef STEPPER_DEBUG
 /**
  * @brief Returns the current position of the stepper in mm
  * 
@@ -434,105 +550,291 @@ bool stepper_z_has_fault(void)
  */
 static int32_t stepper_get_current_pos_mm(stepper_motors_t *p_stepper_motor)
 {
-    if (p_stepper_motor->motor_id == STEPPER_Z_ID)
+    return p_stepper_motor->current_pos / (int32_t) stepper_get_transitions_per_mm(p_stepper_motor);
+}
+#endif
+
+/**
+ * @brief Returns the position (in mm) the stepper will be at once its current move finishes
+ * 
+ * @param p_stepper_motor The stepper motor in question
+ * @return Target position in mm
+ */
+static int32_t stepper_get_target_pos_mm(stepper_motors_t *p_stepper_motor)
+{
+    int32_t target_pos = p_stepper_motor->current_pos + (p_stepper_motor->dir * (int32_t) p_stepper_motor->transitions_to_desired_pos);
+
+    return target_pos / (int32_t) stepper_get_transitions_per_mm(p_stepper_motor);
+}
+
+/**
+ * @brief Picks the axis with the most transitions as the master and makes every other moving axis follow it
+ * 
+ * @param axes Bitmask (by motor_id) of the axes to coordinate
+ * @return The master stepper motor, or NULL if no axis is moving
+ */
+static stepper_motors_t* stepper_setup_coordinated_motion(uint8_t axes)
+{
+    stepper_motors_t* p_master = NULL;
+    uint8_t i = 0;
+
+    // Find the axis with the most transitions
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        if ((axes & (1 << i)) && (stepper_motors[i].transitions_total > 0) && ((p_master == NULL) || (stepper_motors[i].transitions_total > p_master->transitions_total)))
+        {
+            p_master = &stepper_motors[i];
+        }
+    }
+
+    if (p_master == NULL)
     {
-        return p_stepper_motor->current_pos / TRANSITIONS_PER_MM_Z;
+        return NULL;
+    }
+
+    // Every other moving axis follows the master (starting the error term halfway centers the follower transitions)
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        if ((axes & (1 << i)) && (&stepper_motors[i] != p_master) && (stepper_motors[i].transitions_total > 0))
+        {
+            p_master->coordinated_mask |= (1 << i);
+            stepper_motors[i].dda_error = p_master->transitions_total / 2;
+        }
     }
 
-    return p_stepper_motor->current_pos / TRANSITIONS_PER_MM;
+    return p_master;
 }
 
 /**
- * @brief Determines the velocity values needed for smooth motion profiling across all motors
+ * @brief Finds how much to scale the master's velocity so the speed along the (straight line) path matches it
  * 
- * @param v_x Desired x-axis velocity
- * @param v_y Desired y-axis velocity
- * @param v_z Desired z-axis velocity
+ * @param p_master The coordinated master
+ * @return Ratio of the master's distance to the path length, in (0, 1]
  */
-static void stepper_update_velocities(uint32_t v_x, uint32_t v_y, uint32_t v_z, uint32_t max_a_x, uint32_t max_a_y, uint32_t max_a_z)
+static float stepper_get_coordinated_feed_scale(stepper_motors_t* p_master)
 {
-    // X-axis determine the points where the speeds need to change
-    if (STEPPER_X_MAX_V * STEPPER_X_MAX_V / STEPPER_X_MAX_A > p_stepper_motor_x->transitions_to_desired_pos)
+    float master_mm = (float) p_master->transitions_total / stepper_get_transitions_per_mm(p_master);
+    float path_mm_squared = master_mm * master_mm;
+    uint8_t i = 0;
+
+    // Sum the squared distances of the followers
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
     {
-        // Non-trapezoidal motion profile (change halfway)
-        p_stepper_motor_x->x_1 = p_stepper_motor_x->transitions_to_desired_pos / 2;
-        p_stepper_motor_x->x_2 = p_stepper_motor_x->transitions_to_desired_pos / 2;
+        if (p_master->coordinated_mask & (1 << i))
+        {
+            float follower_mm = (float) stepper_motors[i].transitions_total / stepper_get_transitions_per_mm(&stepper_motors[i]);
+            path_mm_squared += follower_mm * follower_mm;
+        }
     }
-    else
+
+    return master_mm / sqrtf(path_mm_squared);
+}
+
+/**
+ * @brief Bounds a requested envelope to the limits of an axis
+ * 
+ * @param p_envelope Where to store the validated envelope
+ * @param p_requested The requested envelope (NULL if the axis does not move)
+ * @param max_v The axis' maximum velocity (transitions/s)
+ * @param max_a The axis' maximum acceleration (transitions/s/s)
+ * @param z_axis Whether this is for Z_STEPPER
+ */
+static void stepper_bound_envelope(stepper_envelope_t* p_envelope, const stepper_envelope_t* p_requested, uint32_t max_v, uint32_t max_a, bool z_axis)
+{
+    uint16_t transitions_per_mm = z_axis ? TRANSITIONS_PER_MM_Z : TRANSITIONS_PER_MM;
+
+    // Axes which do not move get an empty envelope
+    if (p_requested == NULL)
     {
-        // Trapezoidal motion profile
-        p_stepper_motor_x->x_2 = STEPPER_X_MAX_V * STEPPER_X_MAX_V / (2 * STEPPER_X_MAX_A);
-        p_stepper_motor_x->x_1 = p_stepper_motor_x->transitions_to_desired_pos - STEPPER_X_MAX_V * STEPPER_X_MAX_V / (2 * STEPPER_X_MAX_A);
+        p_envelope->v_start  = 0;
+        p_envelope->v_cruise = 0;
+        p_envelope->accel    = 0;
+        return;
     }
 
-    // Y-axis determine the points where the speeds need to change
-    if (STEPPER_Y_MAX_V * STEPPER_Y_MAX_V / STEPPER_Y_MAX_A > p_stepper_motor_y->transitions_to_desired_pos)
+    // Cruise within the axis limit, never start faster than cruising, and never accelerate harder than the axis allows
+    p_envelope->v_cruise = utils_bound(p_requested->v_cruise, 1, max_v / transitions_per_mm);
+    p_envelope->v_start  = utils_bound(p_requested->v_start, 1, p_envelope->v_cruise);
+    p_envelope->accel    = utils_bound(p_requested->accel, 0, max_a / transitions_per_mm);
+
+    // Without acceleration there is no ramp, so the move runs at the cruise speed throughout
+    if (p_envelope->accel == 0)
     {
-        // Non-trapezoidal motion profile (change halfway)
-        p_stepper_motor_y->x_1 = p_stepper_motor_y->transitions_to_desired_pos / 2;
-        p_stepper_motor_y->x_2 = p_stepper_motor_y->transitions_to_desired_pos / 2;
+        p_envelope->v_start = p_envelope->v_cruise;
     }
-    else
+}
+
+/**
+ * @brief Finds how many transitions it takes the given stepper to ramp from the start speed to the cruise speed
+ * 
+ * @param p_stepper_motor The stepper motor being planned
+ * @param p_envelope The envelope of the move
+ * @return The length of a full ramp (in transitions)
+ */
+static uint32_t stepper_get_ramp_transitions(stepper_motors_t* p_stepper_motor, const stepper_envelope_t* p_envelope)
+{
+    uint32_t v_start  = p_envelope->v_start;
+    uint32_t v_cruise = p_envelope->v_cruise;
+
+    if ((p_envelope->accel == 0) || (v_cruise <= v_start))
     {
-        // Trapezoidal motion profile
-        p_stepper_motor_y->x_2 = STEPPER_Y_MAX_V * STEPPER_Y_MAX_V / (2 * STEPPER_Y_MAX_A);
-        p_stepper_motor_y->x_1 = p_stepper_motor_y->transitions_to_desired_pos - STEPPER_Y_MAX_V * STEPPER_Y_MAX_V / (2 * STEPPER_Y_MAX_A);
+        return 0;
     }
 
-    // Z-axis determine the points where the speeds need to change
-    if (STEPPER_Z_MAX_V * STEPPER_Z_MAX_V / STEPPER_Z_MAX_A > p_stepper_motor_z->transitions_to_desired_pos)
+    // [d = (v_f^2 - v_i^2)/(2a)]
+    return ((v_cruise*v_cruise - v_start*v_start) * stepper_get_transitions_per_mm(p_stepper_motor)) / (2 * p_envelope->accel);
+}
+
+/**
+ * @brief Determines the points where the given stepper's speed needs to change
+ * 
+ * @param p_stepper_motor The stepper motor being planned
+ * @param p_envelope The envelope of the move
+ */
+static void stepper_plan_ramp(stepper_motors_t* p_stepper_motor, const stepper_envelope_t* p_envelope)
+{
+    uint32_t ramp_transitions = stepper_get_ramp_transitions(p_stepper_motor, p_envelope);
+
+    if (2 * ramp_transitions > p_stepper_motor->transitions_to_desired_pos)
     {
         // Non-trapezoidal motion profile (change halfway)
-        p_stepper_motor_z->x_1 = p_stepper_motor_z->transitions_to_desired_pos / 2;
-        p_stepper_motor_z->x_2 = p_stepper_motor_z->transitions_to_desired_pos / 2;
+        p_stepper_motor->x_1 = p_stepper_motor->transitions_to_desired_pos / 2;
+        p_stepper_motor->x_2 = p_stepper_motor->transitions_to_desired_pos / 2;
     }
     else
     {
         // Trapezoidal motion profile
-        p_stepper_motor_z->x_2 = STEPPER_Z_MAX_V * STEPPER_Z_MAX_V / (2 * STEPPER_Z_MAX_A);
-        p_stepper_motor_z->x_1 = p_stepper_motor_z->transitions_to_desired_pos - STEPPER_Z_MAX_V * STEPPER_Z_MAX_V / (2 * STEPPER_Z_MAX_A);
+        p_stepper_motor->x_2 = ramp_transitions;
+        p_stepper_motor->x_1 = p_stepper_motor->transitions_to_desired_pos - ramp_transitions;
+    }
+}
+
+/**
+ * @brief Loads the given stepper's starting velocity and acceleration, then starts its timer
+ * 
+ * @param p_stepper_motor The stepper motor to start
+ * @param p_envelope The envelope of the move
+ */
+static void stepper_start_motor(stepper_motors_t* p_stepper_motor, const stepper_envelope_t* p_envelope)
+{
+    bool z_axis = (p_stepper_motor->motor_id == STEPPER_Z_ID);
+    uint32_t initial_period = stepper_velocity_to_timer_period(p_envelope->v_start, z_axis);
+
+    // Precompute how the period changes each transition, and where it stops changing
+    p_stepper_motor->current_period   = initial_period;
+    p_stepper_motor->period_remainder = 0;
+    p_stepper_motor->min_period       = stepper_velocity_to_timer_period(p_envelope->v_cruise, z_axis);
+    p_stepper_motor->period_factor    = stepper_get_period_factor(p_envelope, stepper_get_ramp_transitions(p_stepper_motor, p_envelope));
+    stepper_setup_profile(p_stepper_motor);
+
+    // Start the timer
+    clock_set_timer_period(p_stepper_motor->timer, initial_period);
+    clock_start_timer(p_stepper_motor->timer);
+}
+
+/**
+ * @brief Determines the velocity values needed for smooth motion profiling across all motors
+ * 
+ * @param p_envelope_x Desired x-axis envelope
+ * @param p_envelope_y Desired y-axis envelope
+ * @param p_envelope_z Desired z-axis envelope
+ * @param mode Whether the axes are profiled independently or interpolated from one master timer
+ * @param axes Bitmask (by motor_id) of the axes this command moves. Other axes may still be finishing a blended move
+ */
+static void stepper_update_velocities(const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, const stepper_envelope_t* p_envelope_z, stepper_motion_mode_t mode, uint8_t axes)
+{
+    stepper_envelope_t envelopes[NUMBER_OF_STEPPER_MOTORS];
+    uint8_t i = 0;
+
+    envelopes[STEPPER_X_ID] = *p_envelope_x;
+    envelopes[STEPPER_Y_ID] = *p_envelope_y;
+    envelopes[STEPPER_Z_ID] = *p_envelope_z;
+
+    // Record the length of each move and clear any previous interpolation
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        if (axes & (1 << i))
+        {
+            stepper_motors[i].transitions_total = stepper_motors[i].transitions_to_desired_pos;
+            stepper_motors[i].coordinated_mask  = 0;
+        }
     }
 
-    // X-axis load velocities values into its timer
-    if (v_x != 0)
+    // Coordinated motion only runs the master's timer, scaled so the speeds along the path match the master's envelope
+    if (mode == STEPPER_MOTION_COORDINATED)
     {
-        uint16_t v_x_bounded = utils_bound(v_x, STEPPER_MIN_SPEED, STEPPER_MAX_SPEED);
-        uint32_t stepper_x_initial_period = stepper_velocity_to_timer_period(v_x_bounded, false);
-        
-        // Set the acceleration
-        p_stepper_motor_x->max_accel = max_a_x;
-        
-        // Start the timer
-        clock_set_timer_period(STEPPER_X_TIMER, stepper_x_initial_period);
-        clock_start_timer(STEPPER_X_TIMER);
+        stepper_motors_t* p_master = stepper_setup_coordinated_motion(axes);
+
+        if (p_master != NULL)
+        {
+            stepper_envelope_t* p_master_envelope = &envelopes[p_master->motor_id];
+            float feed_scale = stepper_get_coordinated_feed_scale(p_master);
+
+            p_master_envelope->v_start  = (uint16_t) ceilf(p_master_envelope->v_start * feed_scale);
+            p_master_envelope->v_cruise = (uint16_t) ceilf(p_master_envelope->v_cruise * feed_scale);
+            p_master_envelope->accel    = (uint16_t) ceilf(p_master_envelope->accel * feed_scale);
+
+            // The followers are stepped from the master's timer
+            axes &= ~(p_master->coordinated_mask);
+        }
     }
 
-    // Y-axis load velocities values into its timer
-    if (v_y != 0)
+    // Determine the points where the speeds need to change, then start the timers
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
     {
-        uint16_t v_y_bounded = utils_bound(v_y, STEPPER_MIN_SPEED, STEPPER_MAX_SPEED);
-        uint32_t stepper_y_initial_period = stepper_velocity_to_timer_period(v_y_bounded, false);
-        
-        // Set the acceleration
-        p_stepper_motor_y->max_accel = max_a_y;
-        
-        // Start the timer
-        clock_set_timer_period(STEPPER_Y_TIMER, stepper_y_initial_period);
-        clock_start_timer(STEPPER_Y_TIMER);
+        if ((axes & (1 << i)) && (stepper_motors[i].transitions_to_desired_pos > 0))
+        {
+            stepper_plan_ramp(&stepper_motors[i], &envelopes[i]);
+            stepper_start_motor(&stepper_motors[i], &envelopes[i]);
+        }
     }
+}
+
+/**
+ * @brief Helper function to precompute how the period needs to change to match the desired acceleration
+ *
+ * @param p_envelope The envelope of the move
+ * @param ramp_transitions The length of a full ramp from the start speed to the cruise speed
+ * @return The fraction of the current period to add/remove each transition (fixed-point, STEPPER_PERIOD_FACTOR_BITS)
+ */
+static uint32_t stepper_get_period_factor(const stepper_envelope_t* p_envelope, uint32_t ramp_transitions)
+{
+    double factor = 0;
 
-    // Z-axis load velocities values into its timer
-    if (v_z != 0)
+    // Constant speed
+    if (ramp_transitions == 0)
     {
-        uint16_t v_z_bounded = utils_bound(v_z, STEPPER_MIN_SPEED, STEPPER_MAX_SPEED);
-        uint32_t stepper_z_initial_period = stepper_velocity_to_timer_period(v_z_bounded, true);
-        
-        // Set the acceleration
-        p_stepper_motor_z->max_accel = max_a_z;
-        
-        // Start the timer
-        clock_set_timer_period(STEPPER_Z_TIMER, stepper_z_initial_period);
-        clock_start_timer(STEPPER_Z_TIMER);
+        return 0;
+    }
+
+    // Shrink the period geometrically so it reaches the cruise period after a full ramp: [(1 - factor)^N = v_start/v_cruise]
+    factor = 1.0 - exp(log((double) p_envelope->v_start / p_envelope->v_cruise) / ramp_transitions);
+
+    return (uint32_t) ldexp(factor, STEPPER_PERIOD_FACTOR_BITS);
+}
+
+/**
+ * @brief Helper function to shape the ramps of the given stepper according to its profile
+ *
+ * @param p_stepper_motor The stepper motor whose period factor was just computed
+ */
+static void stepper_setup_profile(stepper_motors_t* p_stepper_motor)
+{
+    uint32_t ramp_transitions = p_stepper_motor->x_2;
+    uint32_t jerk_transitions = ramp_transitions / STEPPER_S_CURVE_JERK_DIVISOR;
+
+    // Trapezoids (and ramps too short to shape) use the constant factor
+    p_stepper_motor->jerk_transitions = 0;
+    p_stepper_motor->jerk_factor      = 0;
+
+    if ((p_stepper_motor->profile == STEPPER_PROFILE_S_CURVE) && (jerk_transitions > 0))
+    {
+        // Raise the peak so the ramp covers the same change in speed as the trapezoid: [peak*(N - J) = factor*N]
+        uint32_t peak_factor = (uint32_t) (((uint64_t) p_stepper_motor->period_factor * ramp_transitions) / (ramp_transitions - jerk_transitions));
+
+        p_stepper_motor->period_factor    = peak_factor;
+        p_stepper_motor->jerk_transitions = jerk_transitions;
+        p_stepper_motor->jerk_factor      = peak_factor / jerk_transitions;
     }
 }
 
@@ -544,29 +846,32 @@ static void stepper_update_velocities(uint32_t v_x, uint32_t v_y, uint32_t v_z,
  * @param rel_x Relative distance to travel in X direction (mm)
  * @param rel_y Relative distance to travel in Y direction (mm)
  * @param rel_z Relative distance to travel in Z direction (mm)
- * @param vel_x Travel velocity for X movement (mm/s)
- * @param vel_y Travel velocity for Y movement (mm/s)
- * @param vel_z Travel velocity for Z movement (mm/s)
+ * @param p_envelope_x Travel envelope for X movement
+ * @param p_envelope_y Travel envelope for Y movement
+ * @param p_envelope_z Travel envelope for Z movement
+ * @param mode Whether the axes are profiled independently or interpolated together
  * @return Pointer to the command object
  */
-stepper_rel_command_t* stepper_build_rel_command(int16_t rel_x, int16_t rel_y, int16_t rel_z, uint16_t v_x, uint16_t v_y, uint16_t v_z)
+stepper_rel_command_t* stepper_build_rel_command(int16_t rel_x, int16_t rel_y, int16_t rel_z, const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, const stepper_envelope_t* p_envelope_z, stepper_motion_mode_t mode)
 {
     // The thing to return
-    stepper_rel_command_t* p_command = (stepper_rel_command_t*) malloc(sizeof(stepper_rel_command_t));
+    stepper_rel_command_t* p_command = (stepper_rel_command_t*) command_pool_alloc(sizeof(stepper_rel_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &stepper_rel_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &stepper_exit;
-    p_command->command.p_is_done = &stepper_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &stepper_rel_ops;
 
     // Data
     p_command->rel_x = rel_x;
     p_command->rel_y = rel_y;
     p_command->rel_z = rel_z;
-    p_command->v_x = v_x;
-    p_command->v_y = v_y;
-    p_command->v_z = v_z;
+    p_command->mode  = mode;
+    stepper_bound_envelope(&p_command->envelope_x, p_envelope_x, STEPPER_X_MAX_V, STEPPER_X_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_y, p_envelope_y, STEPPER_Y_MAX_V, STEPPER_Y_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_z, p_envelope_z, STEPPER_Z_MAX_V, STEPPER_Z_MAX_A, true);
 
     return p_command;
 }
@@ -576,30 +881,48 @@ stepper_rel_command_t* stepper_build_rel_command(int16_t rel_x, int16_t rel_y, i
  *
  * @param file The board column to travel to
  * @param rank The board row to travel to
- * @param vel_x Travel velocity for X movement (mm/s)
- * @param vel_y Travel velocity for Y movement (mm/s)
+ * @param p_envelope_x Travel envelope for X movement
+ * @param p_envelope_y Travel envelope for Y movement
+ * @param mode Whether the axes are profiled independently or interpolated together
  * @return Pointer to the command object
  */
-stepper_chess_command_t* stepper_build_chess_xy_command(chess_file_t file, chess_rank_t rank, uint16_t v_x, uint16_t v_y)
+stepper_chess_command_t* stepper_build_chess_xy_command(chess_file_t file, chess_rank_t rank, const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, stepper_motion_mode_t mode)
 {
     // The thing to return
-    stepper_chess_command_t* p_command = (stepper_chess_command_t*) malloc(sizeof(stepper_chess_command_t));
+    stepper_chess_command_t* p_command = (stepper_chess_command_t*) command_pool_alloc(sizeof(stepper_chess_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
+
+    stepper_init_chess_xy_command(p_command, file, rank, p_envelope_x, p_envelope_y, mode);
+
+    return p_command;
+}
 
-    // Functions
-    p_command->command.p_entry   = &stepper_chess_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &stepper_exit;
-    p_command->command.p_is_done = &stepper_is_done;
+/**
+ * @brief Fills in a stepper chess movement command for {X,Y} (used directly by commands which run moves themselves)
+ *
+ * @param p_command The command to fill in
+ * @param file The board column to travel to
+ * @param rank The board row to travel to
+ * @param p_envelope_x Travel envelope for X movement
+ * @param p_envelope_y Travel envelope for Y movement
+ * @param mode Whether the axes are profiled independently or interpolated together
+ */
+void stepper_init_chess_xy_command(stepper_chess_command_t* p_command, chess_file_t file, chess_rank_t rank, const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, stepper_motion_mode_t mode)
+{
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &stepper_chess_ops;
 
     // Data
     p_command->file  = file;
     p_command->rank  = rank;
     p_command->piece = EMPTY_PIECE;
-    p_command->v_x   = v_x;
-    p_command->v_y   = v_y;
-    p_command->v_z   = 0;
-
-    return p_command;
+    p_command->mode  = mode;
+    stepper_bound_envelope(&p_command->envelope_x, p_envelope_x, STEPPER_X_MAX_V, STEPPER_X_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_y, p_envelope_y, STEPPER_Y_MAX_V, STEPPER_Y_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_z, NULL, STEPPER_Z_MAX_V, STEPPER_Z_MAX_A, true);
 }
 
 /**
@@ -608,29 +931,43 @@ stepper_chess_command_t* stepper_build_chess_xy_command(chess_file_t file, chess
  * @param file The board column to travel to
  * @param rank The board row to travel to
  * @param piece The piece type at the given tile
- * @param vel_z Travel velocity for Z movement (mm/s)
+ * @param p_envelope_z Travel envelope for Z movement
  * @return Pointer to the command object
  */
-stepper_chess_command_t* stepper_build_chess_z_command(chess_piece_t piece, uint16_t v_z)
+stepper_chess_command_t* stepper_build_chess_z_command(chess_piece_t piece, const stepper_envelope_t* p_envelope_z)
 {
     // The thing to return
-    stepper_chess_command_t* p_command = (stepper_chess_command_t*) malloc(sizeof(stepper_chess_command_t));
+    stepper_chess_command_t* p_command = (stepper_chess_command_t*) command_pool_alloc(sizeof(stepper_chess_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &stepper_chess_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &stepper_exit;
-    p_command->command.p_is_done = &stepper_is_done;
+    stepper_init_chess_z_command(p_command, piece, p_envelope_z);
+
+    return p_command;
+}
+
+/**
+ * @brief Fills in a stepper chess movement command for {Z} (used directly by commands which run moves themselves)
+ *
+ * @param p_command The command to fill in
+ * @param piece The piece type at the given tile
+ * @param p_envelope_z Travel envelope for Z movement
+ */
+void stepper_init_chess_z_command(stepper_chess_command_t* p_command, chess_piece_t piece, const stepper_envelope_t* p_envelope_z)
+{
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &stepper_chess_ops;
 
     // Data
     p_command->file  = FILE_ERROR;
     p_command->rank  = RANK_ERROR;
     p_command->piece = piece;
-    p_command->v_x   = 0;
-    p_command->v_y   = 0;
-    p_command->v_z   = v_z;
-
-    return p_command;
+    p_command->mode  = STEPPER_MOTION_INDEPENDENT;
+    stepper_bound_envelope(&p_command->envelope_x, NULL, STEPPER_X_MAX_V, STEPPER_X_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_y, NULL, STEPPER_Y_MAX_V, STEPPER_Y_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_z, p_envelope_z, STEPPER_Z_MAX_V, STEPPER_Z_MAX_A, true);
 }
 
 /**
@@ -641,21 +978,23 @@ stepper_chess_command_t* stepper_build_chess_z_command(chess_piece_t piece, uint
 stepper_rel_command_t* stepper_build_home_xy_command(void)
 {
     // The thing to return
-    stepper_rel_command_t* p_command = (stepper_rel_command_t*) malloc(sizeof(stepper_rel_command_t));
+    stepper_rel_command_t* p_command = (stepper_rel_command_t*) command_pool_alloc(sizeof(stepper_rel_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &stepper_home_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &stepper_exit;
-    p_command->command.p_is_done = &stepper_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &stepper_home_ops;
 
     // Data
     p_command->rel_x = STEPPER_HOME_DISTANCE;
     p_command->rel_y = -STEPPER_HOME_DISTANCE;
     p_command->rel_z = 0;
-    p_command->v_x   = STEPPER_HOME_VELOCITY;
-    p_command->v_y   = STEPPER_HOME_VELOCITY;
-    p_command->v_z   = 0;
+    p_command->mode  = STEPPER_MOTION_INDEPENDENT;
+    stepper_bound_envelope(&p_command->envelope_x, &stepper_home_fast_envelope, STEPPER_X_MAX_V, STEPPER_X_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_y, &stepper_home_fast_envelope, STEPPER_Y_MAX_V, STEPPER_Y_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_z, NULL, STEPPER_Z_MAX_V, STEPPER_Z_MAX_A, true);
 
     return p_command;
 }
@@ -668,21 +1007,23 @@ stepper_rel_command_t* stepper_build_home_xy_command(void)
 stepper_rel_command_t* stepper_build_home_z_command(void)
 {
     // The thing to return
-    stepper_rel_command_t* p_command = (stepper_rel_command_t*) malloc(sizeof(stepper_rel_command_t));
+    stepper_rel_command_t* p_command = (stepper_rel_command_t*) command_pool_alloc(sizeof(stepper_rel_command_t));
+    if (p_command == NULL)
+    {
+        return NULL;
+    }
 
-    // Functions
-    p_command->command.p_entry   = &stepper_home_entry;
-    p_command->command.p_action  = &utils_empty_function;
-    p_command->command.p_exit    = &stepper_exit;
-    p_command->command.p_is_done = &stepper_is_done;
+    // Operations (shared by every command of this type)
+    p_command->command.p_ops = &stepper_home_ops;
 
     // Data
     p_command->rel_x = 0;
     p_command->rel_y = 0;
     p_command->rel_z = STEPPER_HOME_DISTANCE;
-    p_command->v_x   = 0;
-    p_command->v_y   = 0;
-    p_command->v_z   = STEPPER_HOME_VELOCITY;
+    p_command->mode  = STEPPER_MOTION_INDEPENDENT;
+    stepper_bound_envelope(&p_command->envelope_x, NULL, STEPPER_X_MAX_V, STEPPER_X_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_y, NULL, STEPPER_Y_MAX_V, STEPPER_Y_MAX_A, false);
+    stepper_bound_envelope(&p_command->envelope_z, &stepper_home_fast_envelope, STEPPER_Z_MAX_V, STEPPER_Z_MAX_A, true);
 
     return p_command;
 }
@@ -695,6 +1036,7 @@ stepper_rel_command_t* stepper_build_home_z_command(void)
 void stepper_rel_entry(command_t* command)
 {
     stepper_rel_command_t* p_stepper_command = (stepper_rel_command_t*) command;
+    uint8_t axes = stepper_get_command_axes(command);
 
     // X-axis
     if (p_stepper_command->rel_x != 0)
@@ -744,13 +1086,22 @@ void stepper_rel_entry(command_t* command)
         }
     }
 
-    // Determine the distances to go
-    p_stepper_motor_x->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_x, false);
-    p_stepper_motor_y->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_y, false);
-    p_stepper_motor_z->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_z, true);
+    // Determine the distances to go (axes this command does not move may still be finishing a blended move)
+    if (axes & (1 << STEPPER_X_ID))
+    {
+        p_stepper_motor_x->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_x, false);
+    }
+    if (axes & (1 << STEPPER_Y_ID))
+    {
+        p_stepper_motor_y->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_y, false);
+    }
+    if (axes & (1 << STEPPER_Z_ID))
+    {
+        p_stepper_motor_z->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_z, true);
+    }
 
     // Update the velocities
-    stepper_update_velocities(p_stepper_command->v_x, p_stepper_command->v_y, p_stepper_command->v_z, STEPPER_X_MAX_A, STEPPER_Y_MAX_A, STEPPER_Z_MAX_A);
+    stepper_update_velocities(&p_stepper_command->envelope_x, &p_stepper_command->envelope_y, &p_stepper_command->envelope_z, p_stepper_command->mode, axes);
 }
 
 /**
@@ -763,9 +1114,12 @@ void stepper_chess_entry(command_t* command)
     int32_t rel_move_x = 0;
     int32_t rel_move_y = 0;
     int32_t rel_move_z = 0;
-    int32_t current_x = stepper_get_current_pos_mm(p_stepper_motor_x);
-    int32_t current_y = stepper_get_current_pos_mm(p_stepper_motor_y);
-    int32_t current_z = stepper_get_current_pos_mm(p_stepper_motor_z);
+    uint8_t axes = stepper_get_command_axes(command);
+
+    // Plan from where each axis will end up (an axis may still be finishing a blended move)
+    int32_t current_x = stepper_get_target_pos_mm(p_stepper_motor_x);
+    int32_t current_y = stepper_get_target_pos_mm(p_stepper_motor_y);
+    int32_t current_z = stepper_get_target_pos_mm(p_stepper_motor_z);
 
     stepper_chess_command_t* p_stepper_command = (stepper_chess_command_t*) command;
 
@@ -827,13 +1181,61 @@ void stepper_chess_entry(command_t* command)
         }
     }
 
-    // Determine the distances to go
-    p_stepper_motor_x->transitions_to_desired_pos = stepper_distance_to_transitions(rel_move_x, false);
-    p_stepper_motor_y->transitions_to_desired_pos = stepper_distance_to_transitions(rel_move_y, false);
-    p_stepper_motor_z->transitions_to_desired_pos = stepper_distance_to_transitions(rel_move_z, true);
+    // Determine the distances to go (axes this command does not move may still be finishing a blended move)
+    if (axes & (1 << STEPPER_X_ID))
+    {
+        p_stepper_motor_x->transitions_to_desired_pos = stepper_distance_to_transitions(rel_move_x, false);
+    }
+    if (axes & (1 << STEPPER_Y_ID))
+    {
+        p_stepper_motor_y->transitions_to_desired_pos = stepper_distance_to_transitions(rel_move_y, false);
+    }
+    if (axes & (1 << STEPPER_Z_ID))
+    {
+        p_stepper_motor_z->transitions_to_desired_pos = stepper_distance_to_transitions(rel_move_z, true);
+    }
 
     // Update the velocities
-    stepper_update_velocities(p_stepper_command->v_x, p_stepper_command->v_y, p_stepper_command->v_z, STEPPER_X_MAX_A, STEPPER_Y_MAX_A, STEPPER_Z_MAX_A);
+    stepper_update_velocities(&p_stepper_command->envelope_x, &p_stepper_command->envelope_y, &p_stepper_command->envelope_z, p_stepper_command->mode, axes);
+}
+
+/**
+ * @brief Starts one stage of the homing sequence on a single axis
+ *
+ * @param p_stepper_motor The stepper motor being homed
+ * @param distance Distance to move (mm, direction determined by the sign)
+ * @param p_envelope The envelope of the move
+ * @param home_state The stage being started
+ */
+static void stepper_home_move(stepper_motors_t* p_stepper_motor, int16_t distance, const stepper_envelope_t* p_envelope, stepper_home_state_t home_state)
+{
+    stepper_enable_motor(p_stepper_motor);
+
+    // Set the direction
+    if (distance > 0)
+    {
+        stepper_set_direction_counterclockwise(p_stepper_motor);
+    }
+    else
+    {
+        stepper_set_direction_clockwise(p_stepper_motor);
+    }
+
+    // Start the move on this axis alone (the other axes keep their own stages)
+    p_stepper_motor->home_state = home_state;
+    p_stepper_motor->transitions_to_desired_pos = stepper_distance_to_transitions(distance, p_stepper_motor->motor_id == STEPPER_Z_ID);
+    stepper_update_velocities(p_envelope, p_envelope, p_envelope, STEPPER_MOTION_INDEPENDENT, (1 << p_stepper_motor->motor_id));
+}
+
+/**
+ * @brief Halts an axis where it is, leaving it enabled so it holds its position (safe from its step interrupt)
+ *
+ * @param p_stepper_motor The stepper motor to halt
+ */
+static void stepper_home_halt(stepper_motors_t* p_stepper_motor)
+{
+    clock_stop_timer(p_stepper_motor->timer);
+    p_stepper_motor->transitions_to_desired_pos = 0;
 }
 
 /**
@@ -844,97 +1246,247 @@ void stepper_chess_entry(command_t* command)
 void stepper_home_entry(command_t* command)
 {
     stepper_rel_command_t* p_stepper_command = (stepper_rel_command_t*) command;
+    uint8_t axes = stepper_get_command_axes(command);
+    const int16_t distances[NUMBER_OF_STEPPER_MOTORS] = {p_stepper_command->rel_x, p_stepper_command->rel_y, p_stepper_command->rel_z};
+    const stepper_envelope_t* p_envelopes[NUMBER_OF_STEPPER_MOTORS] = {&p_stepper_command->envelope_x, &p_stepper_command->envelope_y, &p_stepper_command->envelope_z};
+    uint16_t switch_data = switch_get_reading();
+    uint8_t i = 0;
 
-    // X-axis
-    if (p_stepper_command->rel_x != 0)
-    {
-        stepper_enable_motor(p_stepper_motor_x);
+    // Set the homing flag
+    stepper_is_homing = true;
 
-        // Set the directions
-        if (p_stepper_command->rel_x > 0)
-        {
-            stepper_set_direction_counterclockwise(p_stepper_motor_x);
-        }
-        else
+    // Forget any edges from before this command
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        if (axes & (1 << i))
         {
-            stepper_set_direction_clockwise(p_stepper_motor_x);
+            switch_take_pos_edges(stepper_motors[i].limit_mask);
         }
     }
 
-    // Y-axis
-    if (p_stepper_command->rel_y != 0)
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
     {
-        stepper_enable_motor(p_stepper_motor_y);
+        stepper_motors_t* p_stepper_motor = &stepper_motors[i];
 
-        // Set the direction
-        if (p_stepper_command->rel_y > 0)
+        if (!(axes & (1 << i)))
         {
-            stepper_set_direction_counterclockwise(p_stepper_motor_y);
+            continue;
+        }
+
+        // An axis already on its limit switch has no edge to find, so it backs off first
+        if (switch_data & p_stepper_motor->limit_mask)
+        {
+            stepper_home_move(p_stepper_motor, stepper_home_backoffs[i], &stepper_home_backoff_envelopes[i], STEPPER_HOME_BACKOFF);
         }
         else
         {
-            stepper_set_direction_clockwise(p_stepper_motor_y);
+            stepper_home_move(p_stepper_motor, distances[i], p_envelopes[i], STEPPER_HOME_FAST);
         }
     }
+}
 
-    // Z-axis
-    if (p_stepper_command->rel_z != 0)
+/**
+ * @brief Advances each homing axis through its stages (fast approach, back off, slow approach)
+ *
+ * @param command The stepper command being run
+ */
+void stepper_home_action(command_t* command)
+{
+    uint8_t axes = stepper_get_command_axes(command);
+    uint16_t switch_data = switch_get_reading();
+    bool edge = false;
+    uint8_t i = 0;
+
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
     {
-        stepper_enable_motor(p_stepper_motor_z);
+        stepper_motors_t* p_stepper_motor = &stepper_motors[i];
+        int16_t backoff = stepper_home_backoffs[i];
 
-        // Set the direction
-        if (p_stepper_command->rel_z > 0)
+        // Each stage ends once the axis stops, either on its own or halted on the edge by its step interrupt (which only
+        // halts with the edge latched, so the edge is taken after seeing the axis stopped)
+        if ((!(axes & (1 << i))) || (p_stepper_motor->transitions_to_desired_pos > 0))
         {
-            stepper_set_direction_counterclockwise(p_stepper_motor_z);
+            continue;
         }
-        else
+        edge = (switch_take_pos_edges(p_stepper_motor->limit_mask) != 0);
+
+        switch (p_stepper_motor->home_state)
         {
-            stepper_set_direction_clockwise(p_stepper_motor_z);
+            case STEPPER_HOME_FAST:
+                if (edge)
+                {
+                    // Found the switch, so back off to approach it again slowly
+                    stepper_home_move(p_stepper_motor, backoff, &stepper_home_backoff_envelopes[i], STEPPER_HOME_BACKOFF);
+                }
+                else
+                {
+                    // Never found the switch
+                    p_stepper_motor->home_state = STEPPER_HOME_DONE;
+                }
+                break;
+
+            case STEPPER_HOME_BACKOFF:
+                // Back off again if the switch is still pressed (edges from leaving it were just dropped)
+                if (switch_data & p_stepper_motor->limit_mask)
+                {
+                    stepper_home_move(p_stepper_motor, backoff, &stepper_home_backoff_envelopes[i], STEPPER_HOME_BACKOFF);
+                }
+                else
+                {
+                    stepper_home_move(p_stepper_motor, (backoff > 0) ? -STEPPER_HOME_SLOW_DISTANCE : STEPPER_HOME_SLOW_DISTANCE, &stepper_home_slow_envelope, STEPPER_HOME_SLOW);
+                }
+                break;
+
+            case STEPPER_HOME_SLOW:
+                // The slow edge defines the home position (an axis which lost the switch is left where it is)
+                if (edge)
+                {
+                    p_stepper_motor->current_pos = 0;
+                }
+                p_stepper_motor->home_state = STEPPER_HOME_DONE;
+                break;
+
+            default:
+                break;
         }
     }
+}
 
-    // Determine the distances to go
-    p_stepper_motor_x->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_x, false);
-    p_stepper_motor_y->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_y, false);
-    p_stepper_motor_z->transitions_to_desired_pos = stepper_distance_to_transitions(p_stepper_command->rel_z, true);
+/**
+ * @brief Marks the homing command as done once every axis has finished its stages
+ *
+ * @param command The stepper command being evaluated
+ * @return Whether homing is complete
+ */
+bool stepper_home_is_done(command_t* command)
+{
+    uint8_t axes = stepper_get_command_axes(command);
+    uint8_t i = 0;
 
-    // Update the velocities (max acceleration of zero prevents the speed from changing)
-    stepper_update_velocities(p_stepper_command->v_x, p_stepper_command->v_y, p_stepper_command->v_z, 0, 0, 0);
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        if ((axes & (1 << i)) && (stepper_motors[i].home_state != STEPPER_HOME_DONE))
+        {
+            return false;
+        }
+    }
 
-    // Set the homing flag
-    stepper_is_homing = true;
+    return true;
 }
 
 /**
- * @brief Stops a given motor if its limit switch is pressedMakes sure no limit switch has been pressed
+ * @brief Finds which axes a motion command moves
+ * 
+ * @param command The command in question
+ * @return Bitmask (by motor_id) of the axes moved, 0 if this is not a stepper motion command
  */
-void stepper_home_activity()
+uint8_t stepper_get_command_axes(command_t* command)
 {
-    // Make sure we are homing
-    if (!stepper_is_homing)
+    uint8_t axes = 0;
+
+    if ((command->p_ops == &stepper_rel_ops) || (command->p_ops == &stepper_home_ops))
     {
-        return;
+        stepper_rel_command_t* p_rel_command = (stepper_rel_command_t*) command;
+
+        axes |= (p_rel_command->rel_x != 0) ? (1 << STEPPER_X_ID) : 0;
+        axes |= (p_rel_command->rel_y != 0) ? (1 << STEPPER_Y_ID) : 0;
+        axes |= (p_rel_command->rel_z != 0) ? (1 << STEPPER_Z_ID) : 0;
     }
+    else if (command->p_ops == &stepper_chess_ops)
+    {
+        stepper_chess_command_t* p_chess_command = (stepper_chess_command_t*) command;
 
-    // Check the current switch readings
-    uint16_t switch_data = switch_get_reading();
+        axes |= (p_chess_command->file != FILE_ERROR) ? (1 << STEPPER_X_ID) : 0;
+        axes |= (p_chess_command->rank != RANK_ERROR) ? (1 << STEPPER_Y_ID) : 0;
+        axes |= (p_chess_command->piece != EMPTY_PIECE) ? (1 << STEPPER_Z_ID) : 0;
+    }
 
-    // If a limit switch was pressed, disable the appropriate motor
-    if (switch_data & LIMIT_X_MASK)
+    return axes;
+}
+
+/**
+ * @brief Looks ahead at the next queued motion command to see if it can start while the current move finishes decelerating
+ * 
+ * @return Whether the current command can hand over to the next one early
+ */
+static bool stepper_can_blend(void)
+{
+    command_t* p_next_command;
+
+    // Only a (non-homing) motion command can be blended into. scheduler_peek_next() skips the queued commands which
+    // neither use nor wait for motion (see command_queue.h), since those may run alongside it
+    if (!scheduler_peek_next(COMMAND_RESOURCE_MOTION, &p_next_command) || (p_next_command->p_ops == &stepper_home_ops))
+    {
+        return false;
+    }
+
+    return stepper_can_blend_into(stepper_get_command_axes(p_next_command));
+}
+
+/**
+ * @brief Checks if a move on the given axes can start while the current move finishes decelerating
+ * 
+ * @param next_axes Bitmask (by motor_id) of the axes the next move uses
+ * @return Whether the next move can start now
+ */
+bool stepper_can_blend_into(uint8_t next_axes)
+{
+    uint8_t moving_axes = 0;
+    uint8_t follower_axes = 0;
+    uint8_t i = 0;
+
+    // Homing always runs to completion
+    if (stepper_is_homing)
+    {
+        return false;
+    }
+
+    // Find which axes are still moving, and which of those are driven by a coordinated master
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
     {
-        stepper_x_stop();
-        p_stepper_motor_x->current_pos = 0;
+        if (stepper_motors[i].transitions_to_desired_pos > 0)
+        {
+            moving_axes   |= (1 << i);
+            follower_axes |= stepper_motors[i].coordinated_mask;
+        }
     }
-    if (switch_data & LIMIT_Y_MASK)
+
+    // The next command may only use idle axes (so the junction velocity on every shared axis stays zero)
+    if ((next_axes == 0) || (next_axes & moving_axes))
     {
-        stepper_y_stop();
-        p_stepper_motor_y->current_pos = 0;
+        return false;
     }
-    if (switch_data & LIMIT_Z_MASK)
+
+    // Every moving axis must be close to its target, and every timer-driven axis must already be decelerating
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
     {
-        stepper_z_stop();
-        p_stepper_motor_z->current_pos = 0;
+        stepper_motors_t* p_stepper_motor = &stepper_motors[i];
+
+        if (!(moving_axes & (1 << i)))
+        {
+            continue;
+        }
+        if (p_stepper_motor->transitions_to_desired_pos > (STEPPER_BLEND_DISTANCE * stepper_get_transitions_per_mm(p_stepper_motor)))
+        {
+            return false;
+        }
+        if (!(follower_axes & (1 << i)) && (p_stepper_motor->transitions_to_desired_pos >= (uint32_t) p_stepper_motor->x_2))
+        {
+            return false;
+        }
     }
+
+    return true;
+}
+
+/**
+ * @brief Keeps arriving axes enabled (for a run of moves which owns the motors), or lets them disable themselves again
+ *
+ * @param hold Whether the step interrupts leave an axis enabled once it arrives
+ */
+void stepper_set_hold(bool hold)
+{
+    stepper_hold = hold;
 }
 
 /**
@@ -944,22 +1496,45 @@ void stepper_home_activity()
  */
 void stepper_exit(command_t* command)
 {
+    uint8_t i = 0;
+
+    // When blending, the decelerating axes keep running and stop themselves once they arrive
+    if (stepper_is_blending)
+    {
+        stepper_is_blending = false;
+        return;
+    }
+
     stepper_disable_all_motors();
     clock_stop_timer(STEPPER_X_TIMER);
     clock_stop_timer(STEPPER_Y_TIMER);
     clock_stop_timer(STEPPER_Z_TIMER);
 
-    // Clear the homing flag
+    // Clear the homing flag (an interrupted homing command leaves its axes mid-stage)
     stepper_is_homing = false;
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        stepper_motors[i].home_state = STEPPER_HOME_DONE;
+    }
 }
 
 /**
- * @brief Marks the command as done once all steppers reach their desired position
+ * @brief Stops every motor immediately (the command was preempted, so nothing is blended into)
+ * 
+ * @param command The stepper command being aborted
+ */
+void stepper_abort(command_t* command)
+{
+    stepper_is_blending = false;
+    stepper_exit(command);
+}
+
+/**
+ * @brief Checks if every stepper has reached its desired position
  * 
- * @param command The stepper command being evaluated
  * @return Whether all steppers have reached their desired positions
  */
-bool stepper_is_done(command_t* command)
+bool stepper_has_arrived(void)
 {
     bool arrived = true;
     
@@ -973,20 +1548,85 @@ bool stepper_is_done(command_t* command)
     return arrived;
 }
 
+/**
+ * @brief Marks the command as done once all steppers reach their desired position (or the next motion command can be blended in)
+ * 
+ * @param command The stepper command being evaluated
+ * @return Whether all steppers have reached their desired positions
+ */
+bool stepper_is_done(command_t* command)
+{
+    bool arrived = stepper_has_arrived();
+
+    // Hand over to the next motion command early if it only needs idle axes
+    if (!arrived && stepper_can_blend())
+    {
+        stepper_is_blending = true;
+        return true;
+    }
+
+    return arrived;
+}
+
 /* Interrupts */
 
 /**
- * @brief Helper function to calculate how the period needs to change to match the desired acceleration
- * 
- * @param p_stepper_motor The stepper motor for which period shift is being calculated
+ * @brief Helper function to find how much the period changes on a given transition of a ramp
+ *
+ * @param p_stepper_motor The stepper motor being profiled
+ * @param ramp_index How many transitions into the ramp this is
+ * @param ramp_length The total number of transitions in the ramp
  * @return How much the period needs to change to meet the desired acceleration
  */
-static uint64_t stepper_get_period_shift(stepper_motors_t* p_stepper_motor)
+static uint32_t stepper_get_period_shift(stepper_motors_t* p_stepper_motor, uint32_t ramp_index, uint32_t ramp_length)
+{
+    uint32_t factor = p_stepper_motor->period_factor;
+    uint64_t shift  = 0;
+
+    // Ramp the acceleration up at the start of the ramp and back down at its end
+    if (ramp_index < p_stepper_motor->jerk_transitions)
+    {
+        factor = p_stepper_motor->jerk_factor * (ramp_index + 1);
+    }
+    else if (ramp_index + p_stepper_motor->jerk_transitions >= ramp_length)
+    {
+        factor = p_stepper_motor->jerk_factor * (ramp_length - ramp_index);
+    }
+
+    // Carry the fraction of a cycle over to the next change, so truncation never adds up over a ramp
+    shift = ((uint64_t) p_stepper_motor->current_period * factor) + p_stepper_motor->period_remainder;
+    p_stepper_motor->period_remainder = (uint32_t) (shift & ((((uint64_t) 1) << STEPPER_PERIOD_FACTOR_BITS) - 1));
+
+    return (uint32_t) (shift >> STEPPER_PERIOD_FACTOR_BITS);
+}
+
+/**
+ * @brief Helper function to step the followers of a coordinated master (Bresenham/DDA)
+ *
+ * @param p_master The coordinated master which just performed a transition
+ */
+static void stepper_interpolate_activity(stepper_motors_t* p_master)
 {
-    // This computes the [at] term from the kinematic equation [v_f = v_i + at]. The coefficient [80/9] was determined by trial-and-error
-    uint64_t period_shift = (80 * (uint64_t) (p_stepper_motor->max_accel * clock_get_timer_period(p_stepper_motor->timer)) / (9*SYSCLOCK_FREQUENCY));
+    uint8_t i = 0;
 
-    return (period_shift / (MICROSTEP_LEVEL/2));
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        stepper_motors_t* p_follower = &stepper_motors[i];
+
+        if ((p_master->coordinated_mask & (1 << i)) && (p_follower->transitions_to_desired_pos > 0))
+        {
+            // Transition the follower whenever its error term runs out
+            p_follower->dda_error -= p_follower->transitions_total;
+            if (p_follower->dda_error < 0)
+            {
+                p_follower->dda_error += p_master->transitions_total;
+
+                stepper_edge_transition(p_follower);
+                p_follower->transitions_to_desired_pos -= 1;
+                p_follower->current_pos += p_follower->dir;
+            }
+        }
+    }
 }
 
 /**
@@ -999,43 +1639,80 @@ static void stepper_interrupt_activity(stepper_motors_t* p_stepper_motor)
     // Move each stepper until it reaches its destination, then disable
     if (p_stepper_motor->transitions_to_desired_pos > 0)
     {
-        // Move the motor, update the counter and position
-        stepper_edge_transition(p_stepper_motor);
+        // The handler already toggled STEP, update the counter and position
         p_stepper_motor->transitions_to_desired_pos -= 1;
         p_stepper_motor->current_pos += p_stepper_motor->dir;
 
+        // An approaching homing axis stops dead once the switch interrupt latches its edge (see stepper_home_action)
+        if (((p_stepper_motor->home_state == STEPPER_HOME_FAST) || (p_stepper_motor->home_state == STEPPER_HOME_SLOW)) &&
+            (switch_get_pos_edges(p_stepper_motor->limit_mask)))
+        {
+            stepper_home_halt(p_stepper_motor);
+            event_post(EVENT_STEPPER);
+            return;
+        }
+
+        // Bring any coordinated followers along
+        if (p_stepper_motor->coordinated_mask)
+        {
+            stepper_interpolate_activity(p_stepper_motor);
+        }
+
+        // Wake the main loop once the move is complete (followers arrive on the same transition)
+        if (p_stepper_motor->transitions_to_desired_pos == 0)
+        {
+            event_post(EVENT_STEPPER);
+        }
+
 #ifdef STEPPER_DEBUG
         // Send the data to the laptop
         char data[32];
-        sprintf(data, "(%d,%d,%d)", stepper_get_current_pos_mm(p_stepper_motor), clock_get_timer_period(p_stepper_motor->timer), p_stepper_motor->time_elapsed); // current_pos, the number in the register, time_elapsed
+        sprintf(data, "(%d,%d,%d)", stepper_get_current_pos_mm(p_stepper_motor), p_stepper_motor->current_period, p_stepper_motor->time_elapsed); // current_pos, the number in the register, time_elapsed
         uart_out_string(PROFILING_CHANNEL, data, 32);
 
         // Delay so this is not spamable (we only transmit strings for testing, so this is not an issue for the actual robot)
         utils_delay(150000);
 #endif
 
-        // Update the timer period for smooth motion profiling
-        uint64_t period_shift = stepper_get_period_shift(p_stepper_motor);
-
+        // Queue the next period for smooth motion profiling (the factors were precomputed at command entry). The timer keeps
+        // running, so the period only takes effect at the next time-out and interrupt latency never stretches a step
         if (p_stepper_motor->transitions_to_desired_pos > p_stepper_motor->x_1)      // still accelerating
         {
-            clock_set_timer_period(p_stepper_motor->timer, (clock_get_timer_period(p_stepper_motor->timer) - period_shift));
+            uint32_t ramp_index = p_stepper_motor->transitions_total - p_stepper_motor->transitions_to_desired_pos - 1;
+            p_stepper_motor->current_period -= stepper_get_period_shift(p_stepper_motor, ramp_index, p_stepper_motor->transitions_total - p_stepper_motor->x_1);
+            if (p_stepper_motor->current_period < p_stepper_motor->min_period)
+            {
+                p_stepper_motor->current_period = p_stepper_motor->min_period;
+            }
+            clock_load_timer_period(p_stepper_motor->timer, p_stepper_motor->current_period);
         }
         else if (p_stepper_motor->transitions_to_desired_pos < p_stepper_motor->x_2) // deaccelerating
         {
-            clock_set_timer_period(p_stepper_motor->timer, (clock_get_timer_period(p_stepper_motor->timer) + period_shift));
+            uint32_t ramp_index = p_stepper_motor->x_2 - p_stepper_motor->transitions_to_desired_pos - 1;
+            p_stepper_motor->current_period += stepper_get_period_shift(p_stepper_motor, ramp_index, p_stepper_motor->x_2);
+            clock_load_timer_period(p_stepper_motor->timer, p_stepper_motor->current_period);
         }
-
-        clock_start_timer(p_stepper_motor->timer);
     }
     else
     {
-        // Disable the motor
-        stepper_disable_motor(p_stepper_motor);
-    }
+        uint8_t i = 0;
+
+        // Disable the motor and any coordinated followers (they arrive on the same transition), unless they are held
+        if (!stepper_hold)
+        {
+            stepper_disable_motor(p_stepper_motor);
+            for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+            {
+                if (p_stepper_motor->coordinated_mask & (1 << i))
+                {
+                    stepper_disable_motor(&stepper_motors[i]);
+                }
+            }
+        }
 
-    // Stop a motor if its limit switch is pressed
-    stepper_home_activity();
+        // Stop the timer (a blended move may already have handed the command queue over)
+        clock_stop_timer(p_stepper_motor->timer);
+    }
 }
 
 /**
@@ -1043,11 +1720,21 @@ static void stepper_interrupt_activity(stepper_motors_t* p_stepper_motor)
  */
 __interrupt void STEPPER_X_HANDLER(void)
 {
+    // Toggle STEP before anything else, so the edge only waits on interrupt entry
+    if (p_stepper_motor_x->transitions_to_desired_pos > 0)
+    {
+        stepper_edge_transition(p_stepper_motor_x);
+    }
+
+    ISR_ENTER(TRACE_ISR_STEPPER_X, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(STEPPER_X_TIMER);
 
     // Perform the stepper interrupt activity
     stepper_interrupt_activity(p_stepper_motor_x);
+
+    ISR_EXIT(TRACE_ISR_STEPPER_X, 0);
 }
 
 /**
@@ -1055,11 +1742,21 @@ __interrupt void STEPPER_X_HANDLER(void)
  */
 __interrupt void STEPPER_Y_HANDLER(void)
 {
+    // Toggle STEP before anything else, so the edge only waits on interrupt entry
+    if (p_stepper_motor_y->transitions_to_desired_pos > 0)
+    {
+        stepper_edge_transition(p_stepper_motor_y);
+    }
+
+    ISR_ENTER(TRACE_ISR_STEPPER_Y, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(STEPPER_Y_TIMER);
 
     // Perform the stepper interrupt activity
     stepper_interrupt_activity(p_stepper_motor_y);
+
+    ISR_EXIT(TRACE_ISR_STEPPER_Y, 0);
 }
 
 /**
@@ -1067,11 +1764,21 @@ __interrupt void STEPPER_Y_HANDLER(void)
  */
 __interrupt void STEPPER_Z_HANDLER(void)
 {
+    // Toggle STEP before anything else, so the edge only waits on interrupt entry
+    if (p_stepper_motor_z->transitions_to_desired_pos > 0)
+    {
+        stepper_edge_transition(p_stepper_motor_z);
+    }
+
+    ISR_ENTER(TRACE_ISR_STEPPER_Z, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(STEPPER_Z_TIMER);
 
     // Perform the stepper interrupt activity
     stepper_interrupt_activity(p_stepper_motor_z);
+
+    ISR_EXIT(TRACE_ISR_STEPPER_Z, 0);
 }
 
 /* End steppermotors.c */
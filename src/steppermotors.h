@@ -14,8 +14,16 @@
 // Note on stepper motors:
 //  - Motors are started/stopped by enable rather than sleep
 //      - While sleep might save more power, it also requires delay before the first step after waking
+//      - Each axis is disabled by its step interrupt once it arrives, unless stepper_set_hold() keeps it enabled for
+//        the next move (a motion program holds its axes, and stepper_exit() disables them once it is done)
 //  - Assumes reset and sleep are connected to the same GPIO pin
 //  - Rather than using the home output of the stepper, we drive until a limit switch is pressed, then backoff
+//  - Homing runs in two stages for repeatability (see stepper_home_action):
+//      - Fast approach until the limit switch's rising edge, back off by HOMING_*_BACKOFF, then slow approach to the edge
+//      - An axis which starts on its limit switch skips straight to the back off
+//      - The switch interrupt latches the edges, and an approaching axis' step interrupt stops it on its next step once
+//        its edge is latched. stepper_home_action only moves each axis on to its next stage
+//      - Both approaches run at a constant speed, since the axis stops dead on the switch
 //  - Assumed home position:
 //             _
 //             | ARM
@@ -23,6 +31,14 @@
 //      |------X  <== Home, position (0,0)
 //        BASE
 //
+// Step timing:
+//  - The STEP pins are plain GPIOs (only PD7 has a CCP function, and its timer runs the gantry), so steps stay interrupt-driven
+//  - The stepper timers run freely with TIMER_TAMR_TAILD: the interrupt queues the next period and it loads at time-out
+//      - Step spacing is set by the timer, so interrupt latency adds jitter to a single edge but never accumulates
+//  - The STEP pin is toggled through its masked DATA address first thing in the handler, before the interrupt flag is
+//    cleared, the interrupt is traced, or any profiling math runs
+//  - The stepper interrupts have the highest priority after the UARTs, above the switch and gantry interrupts
+//
 // Transition math:
 //  - Steppers {X,Y} perform 200 steps/revolution. We microstep to M steps, so 200*M microsteps/revolution
 //  - Belt pitch is 2 mm, and rotor has 20 teeth, so 40mm/revolution
@@ -34,6 +50,31 @@
 //  - There are 2 transitions/microstep
 //      ==> (2 transitions/microstep)*(200*M microsteps/revolution)/(50mm/revolution) = 8*M transitions/mm
 //
+// Coordinated motion:
+//  - By default, each axis runs its own trapezoid on its own timer (STEPPER_MOTION_INDEPENDENT)
+//  - In STEPPER_MOTION_COORDINATED, the axis with the most transitions becomes the master and is the only timer running
+//      - Every master transition, a Bresenham/DDA step decides whether each follower axis transitions as well
+//      - All axes start and stop together, so the tool travels in a straight line at the commanded feed rate
+//
+// Velocity envelopes:
+//  - Every axis of every motion command carries a stepper_envelope_t (start speed, cruise speed, acceleration)
+//  - Envelopes are validated against the axis limits (STEPPER_*_MAX_V, STEPPER_*_MAX_A) when the command is built
+//  - A move starts at v_start, ramps at accel up to v_cruise (or halfway, if the move is too short), and ramps back down to v_start
+//  - An acceleration of 0 runs the whole move at v_cruise
+//
+// Blending:
+//  - A motion command finishes early if the next queued command is a motion command that only moves idle axes, and
+//    every moving axis is decelerating and within STEPPER_BLEND_DISTANCE of its target (e.g. Z starts down while XY settles)
+//  - The decelerating axes keep running and stop themselves in their ISR once they arrive
+//  - Anything else queued next (magnet, delay, homing) forces a full stop first
+//
+// Motion profiles (selected per axis):
+//  - STEPPER_PROFILE_TRAPEZOID: the period changes by a constant fraction every transition while ramping
+//  - STEPPER_PROFILE_S_CURVE: the first and last 1/STEPPER_S_CURVE_JERK_DIVISOR of each ramp ramp the acceleration itself
+//    (7 segments: jerk up, accel, jerk down, cruise, jerk up, decel, jerk down)
+//      - The peak acceleration is raised so each ramp still covers the same change in speed over the same distance
+//      - Limiting jerk keeps the belts from ringing and carried pieces from swinging at the corners
+//
 // Microstepping table:
 //  MS2 | MS1 | MS0
 //   0 |   0 |  0    <=> Full step
@@ -46,8 +87,11 @@
 #include "msp.h"
 #include "gpio.h"
 #include "clock.h"
+#include "command_pool.h"
 #include "command_queue.h"
+#include "event.h"
 #include "switch.h"
+#include "cpuload.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -66,9 +110,12 @@
 #define TRANSITIONS_PER_MM                  (10 * MICROSTEP_LEVEL)
 #define TRANSITIONS_PER_MM_Z                (8 * MICROSTEP_LEVEL)
 #define STEPPER_HOME_DISTANCE               (999)       // mm (arbitrary large value)
-#define STEPPER_HOME_VELOCITY               (1)         // mm/s
-#define STEPPER_MIN_SPEED                   (135)       // mm/s
-#define STEPPER_MAX_SPEED                   (250)       // mm/s
+#define STEPPER_HOME_FAST_VELOCITY          (135)       // mm/s (fast approach, constant, bounded per axis)
+#define STEPPER_HOME_SLOW_VELOCITY          (10)        // mm/s (slow approach, constant)
+#define STEPPER_HOME_SLOW_DISTANCE          (20)        // mm (give up on the slow approach after this far)
+#define STEPPER_PERIOD_FACTOR_BITS          (32)        // Fractional bits of the per-transition period factor
+#define STEPPER_S_CURVE_JERK_DIVISOR        (4)         // Fraction (1/N) of each ramp spent changing the acceleration
+#define STEPPER_BLEND_DISTANCE              (20)        // mm (max distance left on a decelerating axis when the next move starts)
 
 // Common and microstepping GPIO
 #define STEPPER_XYZ_NRESET_PORT             (GPIOE)
@@ -102,6 +149,7 @@
 #define STEPPER_X_ID                        (0)
 #define STEPPER_X_MAX_V                     (3000 * MICROSTEP_LEVEL)    // transitions/s
 #define STEPPER_X_MAX_A                     (9500 * MICROSTEP_LEVEL)    // transitions/s/s
+#define STEPPER_X_PROFILE                   (STEPPER_PROFILE_S_CURVE)
 #define STEPPER_X_TIMER                     (TIMER0)
 #define STEPPER_X_HANDLER                   (TIMER0A_IRQHandler)
 #define STEPPER_X_INITIAL_PERIOD            ((48000 / MICROSTEP_LEVEL) - 1)
@@ -120,6 +168,7 @@
 #define STEPPER_Y_ID                        (1)
 #define STEPPER_Y_MAX_V                     (3000 * MICROSTEP_LEVEL)    // transitions/s
 #define STEPPER_Y_MAX_A                     (9500 * MICROSTEP_LEVEL)    // transitions/s/s
+#define STEPPER_Y_PROFILE                   (STEPPER_PROFILE_S_CURVE)
 #define STEPPER_Y_TIMER                     (TIMER1)
 #define STEPPER_Y_HANDLER                   (TIMER1A_IRQHandler)
 #define STEPPER_Y_INITIAL_PERIOD            ((48000 / MICROSTEP_LEVEL) - 1)
@@ -136,12 +185,40 @@
 #define STEPPER_Z_NHOME_PORT                (GPIOB)
 #define STEPPER_Z_NHOME_PIN                 (GPIO_PIN_5)
 #define STEPPER_Z_ID                        (2)
-#define STEPPER_Z_MAX_V                     (500 * MICROSTEP_LEVEL)     // transitions/s
-#define STEPPER_Z_MAX_A                     (2000 * MICROSTEP_LEVEL)    // transitions/s/s
+#define STEPPER_Z_MAX_V                     (1250 * MICROSTEP_LEVEL)    // transitions/s
+#define STEPPER_Z_MAX_A                     (3200 * MICROSTEP_LEVEL)    // transitions/s/s
+#define STEPPER_Z_PROFILE                   (STEPPER_PROFILE_TRAPEZOID)
 #define STEPPER_Z_TIMER                     (TIMER2)
 #define STEPPER_Z_HANDLER                   (TIMER2A_IRQHandler)
 #define STEPPER_Z_INITIAL_PERIOD            ((48000 / MICROSTEP_LEVEL) - 1)
 
+// Stepper motion modes
+typedef enum {
+    STEPPER_MOTION_INDEPENDENT,                         // Each axis is profiled on its own timer
+    STEPPER_MOTION_COORDINATED                          // One master timer interpolates all moving axes
+} stepper_motion_mode_t;
+
+// Stepper motion profiles
+typedef enum {
+    STEPPER_PROFILE_TRAPEZOID,                          // Constant acceleration while ramping
+    STEPPER_PROFILE_S_CURVE                             // Jerk-limited acceleration while ramping
+} stepper_profile_t;
+
+// Stepper homing stages
+typedef enum {
+    STEPPER_HOME_DONE,                                  // Not homing (or homed)
+    STEPPER_HOME_FAST,                                  // Fast approach until the limit switch is pressed
+    STEPPER_HOME_BACKOFF,                               // Back off the limit switch by HOMING_*_BACKOFF
+    STEPPER_HOME_SLOW                                   // Slow approach until the limit switch is pressed again
+} stepper_home_state_t;
+
+// Stepper velocity envelope
+typedef struct stepper_envelope_t {
+    uint16_t v_start;                                   // Speed at the start and end of the move, mm/s
+    uint16_t v_cruise;                                  // Speed once done accelerating, mm/s
+    uint16_t accel;                                     // Acceleration while ramping, mm/s/s
+} stepper_envelope_t;
+
 // Stepper motor struct
 typedef struct {
     TIMER0_Type*           timer;                      // Timer used for motion profiling
@@ -149,20 +226,32 @@ typedef struct {
     uint8_t                dir_pin;                    // Pin used to set the direction
     GPIO_Type*             step_port;                  // Port used to step the motor
     uint8_t                step_pin;                   // Pin used to step the motor
+    volatile uint32_t*     p_step_data;                // Masked DATA address of the STEP pin (toggled from the interrupt)
     GPIO_Type*             nenable_port;               // Port used to enable/disable
     uint8_t                nenable_pin;                // Pin used to enable/disable the motor
     GPIO_Type*             nfault_port;                // Port used by the stepper to indicate a fault
     uint8_t                nfault_pin;                 // Pin used by the stepper to indicate a fault
     GPIO_Type*             nhome_port;                 // Port used by the stepper when home
     uint8_t                nhome_pin;                  // Pin used by the stepper when home
+    uint16_t               limit_mask;                 // Switch mask of the limit switch at the home position
+    stepper_home_state_t   home_state;                 // Stage of the homing sequence
     peripheral_state_t     current_state;              // Whether the motor is enabled/disabled
     uint32_t               transitions_to_desired_pos; // (2)*(#periods to desired position)
+    uint32_t               transitions_total;          // Transitions commanded at the start of the current move
     int8_t                 dir;                        // +/- 1 to indicate direction
     int32_t                current_pos;                // Distance (in transitions) along the axis, from home position
     uint16_t               current_vel;                // Velocity (in CCR values) at the present moment
     int32_t                x_1;                        // Point where the speed plateaus (in transitions)
     int32_t                x_2;                        // Point where the speed starts decreasing (in transitions)
-    uint16_t               max_accel;                  // Max value to adjust the clock period to accel/deccel
+    uint32_t               current_period;             // Timer period (in clock cycles) of the transition being timed
+    uint32_t               min_period;                 // Timer period at the cruise speed (the ramp never goes faster)
+    uint32_t               period_factor;              // Peak fraction of the period to add/remove per transition (fixed-point, STEPPER_PERIOD_FACTOR_BITS)
+    uint32_t               period_remainder;           // Fraction of a cycle left over by the previous period change (fixed-point, STEPPER_PERIOD_FACTOR_BITS)
+    stepper_profile_t      profile;                    // Shape of the acceleration/deceleration ramps
+    uint32_t               jerk_transitions;           // Transitions at each end of a ramp spent changing the acceleration
+    uint32_t               jerk_factor;                // Change in the period factor per transition while jerk-limited
+    uint8_t                coordinated_mask;           // Bitmask (by motor_id) of the followers this motor's timer interpolates
+    int32_t                dda_error;                  // Bresenham error term while following a coordinated master
     uint8_t                motor_id;                   // Unique identifier for each motor
 #ifdef STEPPER_DEBUG
     uint32_t               time_elapsed;
@@ -175,9 +264,10 @@ typedef struct stepper_rel_command_t {
     int16_t rel_x;                                      // Distance to move in X (relative to current position) mm
     int16_t rel_y;                                      // Distance to move in Y (relative to current position) mm
     int16_t rel_z;                                      // Distance to move in Z (relative to current position) mm
-    uint16_t v_x;                                       // Speed in X (direction determined by sign of the distance to move) mm/s
-    uint16_t v_y;                                       // Speed in Y (direction determined by sign of the distance to move) mm/s
-    uint16_t v_z;                                       // Speed in Z (direction determined by sign of the distance to move) mm/s
+    stepper_envelope_t envelope_x;                      // Speeds/acceleration in X (direction determined by sign of the distance to move)
+    stepper_envelope_t envelope_y;                      // Speeds/acceleration in Y (direction determined by sign of the distance to move)
+    stepper_envelope_t envelope_z;                      // Speeds/acceleration in Z (direction determined by sign of the distance to move)
+    stepper_motion_mode_t mode;                         // Whether the axes are profiled independently or interpolated together
 } stepper_rel_command_t;
 
 typedef struct stepper_chess_command_t {
@@ -185,9 +275,10 @@ typedef struct stepper_chess_command_t {
     chess_file_t file;                                  // Location to move to in X mm
     chess_rank_t rank;                                  // Location to move to in Y mm
     chess_piece_t piece;                                // Location to move to in Z mm
-    uint16_t v_x;                                       // Speed in X (direction determined by sign of the distance to move) mm/s
-    uint16_t v_y;                                       // Speed in Y (direction determined by sign of the distance to move) mm/s
-    uint16_t v_z;                                       // Speed in Z (direction determined by sign of the distance to move) mm/s
+    stepper_envelope_t envelope_x;                      // Speeds/acceleration in X (direction determined by sign of the distance to move)
+    stepper_envelope_t envelope_y;                      // Speeds/acceleration in Y (direction determined by sign of the distance to move)
+    stepper_envelope_t envelope_z;                      // Speeds/acceleration in Z (direction determined by sign of the distance to move)
+    stepper_motion_mode_t mode;                         // Whether the axes are profiled independently or interpolated together
 } stepper_chess_command_t;
 
 // Public functions
@@ -198,17 +289,27 @@ void stepper_z_stop(void);
 bool stepper_x_has_fault(void);
 bool stepper_y_has_fault(void);
 bool stepper_z_has_fault(void);
+int32_t stepper_get_position_mm(uint8_t motor_id);
+bool stepper_has_arrived(void);
+bool stepper_can_blend_into(uint8_t next_axes);
+void stepper_set_hold(bool hold);
+uint8_t stepper_get_command_axes(command_t* command);
 
 // Command Functions
-stepper_rel_command_t* stepper_build_rel_command(int16_t rel_x, int16_t rel_y, int16_t rel_z, uint16_t v_x, uint16_t v_y, uint16_t v_z);
-stepper_chess_command_t* stepper_build_chess_xy_command(chess_file_t file, chess_rank_t rank, uint16_t v_x, uint16_t v_y);
-stepper_chess_command_t* stepper_build_chess_z_command(chess_piece_t piece, uint16_t v_z);
+stepper_rel_command_t* stepper_build_rel_command(int16_t rel_x, int16_t rel_y, int16_t rel_z, const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, const stepper_envelope_t* p_envelope_z, stepper_motion_mode_t mode);
+stepper_chess_command_t* stepper_build_chess_xy_command(chess_file_t file, chess_rank_t rank, const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, stepper_motion_mode_t mode);
+stepper_chess_command_t* stepper_build_chess_z_command(chess_piece_t piece, const stepper_envelope_t* p_envelope_z);
+void stepper_init_chess_xy_command(stepper_chess_command_t* p_command, chess_file_t file, chess_rank_t rank, const stepper_envelope_t* p_envelope_x, const stepper_envelope_t* p_envelope_y, stepper_motion_mode_t mode);
+void stepper_init_chess_z_command(stepper_chess_command_t* p_command, chess_piece_t piece, const stepper_envelope_t* p_envelope_z);
 stepper_rel_command_t* stepper_build_home_xy_command(void);
 stepper_rel_command_t* stepper_build_home_z_command(void);
 void stepper_rel_entry(command_t* command);
 void stepper_chess_entry(command_t* command);
 void stepper_home_entry(command_t* command);
+void stepper_home_action(command_t* command);
+bool stepper_home_is_done(command_t* command);
 void stepper_exit(command_t* command);
+void stepper_abort(command_t* command);
 bool stepper_is_done(command_t* command);
 
 #endif /* STEPPER_MOTORS_H_ */
@@ -54,6 +54,36 @@ uint16_t switch_get_reading(void)
     return p_switches->current_inputs;
 }
 
+/**
+ * @brief Reads the latched rising edges of the specified switches, without clearing them (safe from any interrupt)
+ *
+ * @param mask The switches of interest
+ * @return The switches in mask which were pressed since their edges were last taken
+ */
+uint16_t switch_get_pos_edges(uint16_t mask)
+{
+    return (p_switches->latched_pos_transitions & mask);
+}
+
+/**
+ * @brief Takes (reads and clears) the latched rising edges of the specified switches
+ *
+ * @param mask The switches of interest
+ * @return The switches in mask which were pressed since their edges were last taken
+ */
+uint16_t switch_take_pos_edges(uint16_t mask)
+{
+    uint16_t edges;
+
+    // Mask the switch interrupt so an edge cannot be latched between the read and the clear
+    SWITCH_TIMER->IMR &= ~(TIMER_IMR_TATOIM);
+    edges = (p_switches->latched_pos_transitions & mask);
+    p_switches->latched_pos_transitions &= ~edges;
+    SWITCH_TIMER->IMR |=  (TIMER_IMR_TATOIM);
+
+    return edges;
+}
+
 /**
  * @brief Temporary function to test the switch by toggling an LED
  *
@@ -105,6 +135,8 @@ static uint16_t switch_shift_assign(void)
  */
 __interrupt void SWITCH_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_SWITCH, 0);
+
     // Clear the interrupt flag
     clock_clear_interrupt(SWITCH_TIMER);
 
@@ -116,7 +148,16 @@ __interrupt void SWITCH_HANDLER(void)
     p_switches->edges           = (p_switches->current_inputs ^ p_switches->previous_inputs);
     p_switches->pos_transitions = (p_switches->current_inputs & p_switches->edges);
     p_switches->neg_transitions = ((~p_switches->current_inputs) & p_switches->edges);
+    p_switches->latched_pos_transitions |= p_switches->pos_transitions;
     p_switches->previous_inputs = p_switches->current_inputs;
+
+    // Wake the main loop on a new press
+    if (p_switches->pos_transitions)
+    {
+        event_post(EVENT_SWITCH);
+    }
+
+    ISR_EXIT(TRACE_ISR_SWITCH, 0);
 }
 
 /* End buttons.c */
@@ -16,11 +16,14 @@
 //  - Creates a virtual port to access the physical port via imaging
 //  - The SWITCH_HANDLER reads the virtual port and maps it to a local bitfield
 //  - To move switches to different GPIO, change the GPIO macros below, no other changes required
+//  - Rising edges are latched until taken, so a consumer never misses an edge between its checks
 
 #include "msp.h"
 #include "gpio.h"
 #include "utils.h"
 #include "clock.h"
+#include "event.h"
+#include "cpuload.h"
 #include <stdint.h>
 
 // General switch macros
@@ -102,6 +105,7 @@ typedef struct {
     uint16_t pos_transitions;
     uint16_t neg_transitions;
     uint16_t previous_inputs;
+    uint16_t latched_pos_transitions;   // Rising edges since they were last taken (see switch_take_pos_edges)
 } switch_state_t;
 
 // Virtual port for the switches
@@ -110,6 +114,8 @@ union utils_vport16_t switch_vport;
 // Public functions
 void switch_init(void);
 uint16_t switch_get_reading(void);
+uint16_t switch_get_pos_edges(uint16_t mask);
+uint16_t switch_take_pos_edges(uint16_t mask);
 void switch_test(uint16_t mask);
 
 #endif /* SWITCHES_H_ */
@@ -0,0 +1,169 @@
+/**
+ * @file trace.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Records a timeline of command and interrupt activity, stamped with the DWT cycle counter
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "trace.h"
+
+// Private functions
+static uint32_t trace_get_cycles(void);
+
+// Make sure the masking works
+#if ((TRACE_BUFFER_SIZE & TRACE_BUFFER_MASK) != 0) || (TRACE_BUFFER_SIZE > 32768)
+#error "TRACE_BUFFER_SIZE must be a power of two, and at most 32768"
+#endif
+
+static trace_record_t records[TRACE_BUFFER_SIZE];
+static uint16_t head;                           // Free-running count of records written
+static uint16_t count;                          // Records held (at most TRACE_BUFFER_SIZE)
+static uint32_t last_cycles;
+static uint8_t wraps;
+static bool paused;
+
+/**
+ * @brief Initializes the tracer. Starts empty (the cycle counter must already be running)
+ */
+void trace_init(void)
+{
+    uint32_t primask = utils_enter_critical();
+
+    head        = 0;
+    count       = 0;
+    last_cycles = clock_get_cycles();
+    wraps       = 0;
+    paused      = false;
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Adds a record, overwriting the oldest if the ring is full (safe to call from interrupts)
+ *
+ * @param event One of TRACE_EVENT_*
+ * @param id COMMAND_ID_* or TRACE_ISR_*
+ * @param arg Argument of the event
+ */
+void trace_record(uint8_t event, uint8_t id, uint8_t arg)
+{
+    trace_record_t* p_record;
+    uint32_t primask = utils_enter_critical();
+
+    if (!paused)
+    {
+        p_record = &records[head & TRACE_BUFFER_MASK];
+        p_record->cycles = trace_get_cycles();
+        p_record->wraps  = wraps;
+        p_record->event  = event;
+        p_record->id     = id;
+        p_record->arg    = arg;
+
+        head++;
+        if (count < TRACE_BUFFER_SIZE)
+        {
+            count++;
+        }
+    }
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Reads the cycle counter so a wrap is never missed (call at least every 35 s, safe to call from interrupts)
+ */
+void trace_keepalive(void)
+{
+    uint32_t primask = utils_enter_critical();
+    trace_get_cycles();
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Stops recording, so the records can be read out without changing underneath
+ *
+ * @return The number of records held
+ */
+uint16_t trace_pause(void)
+{
+    uint16_t held;
+    uint32_t primask = utils_enter_critical();
+
+    paused = true;
+    held = count;
+
+    utils_exit_critical(primask);
+    return held;
+}
+
+/**
+ * @brief Gets a record (only while paused)
+ *
+ * @param index Position of the record, 0 being the oldest
+ * @param p_record Pointer to where the record will be stored
+ * @return Whether there was a record at that position
+ */
+bool trace_get_record(uint16_t index, trace_record_t* p_record)
+{
+    if (!paused || (index >= count))
+    {
+        return false;
+    }
+
+    *p_record = records[(uint16_t) (head - count + index) & TRACE_BUFFER_MASK];
+    return true;
+}
+
+/**
+ * @brief Packs a record into bytes, as sent to the Pi (cycles little-endian, then wraps, event, ID and argument)
+ *
+ * @param p_record The record
+ * @param bytes Buffer to write the bytes into
+ */
+void trace_serialize(const trace_record_t* p_record, uint8_t bytes[TRACE_RECORD_SIZE])
+{
+    bytes[0] = (uint8_t) (p_record->cycles);
+    bytes[1] = (uint8_t) (p_record->cycles >> 8);
+    bytes[2] = (uint8_t) (p_record->cycles >> 16);
+    bytes[3] = (uint8_t) (p_record->cycles >> 24);
+    bytes[4] = p_record->wraps;
+    bytes[5] = p_record->event;
+    bytes[6] = p_record->id;
+    bytes[7] = p_record->arg;
+}
+
+/**
+ * @brief Empties the ring and starts recording again
+ */
+void trace_resume(void)
+{
+    uint32_t primask = utils_enter_critical();
+
+    count  = 0;
+    paused = false;
+
+    utils_exit_critical(primask);
+}
+
+/**
+ * @brief Reads the cycle counter, counting a wrap if it went backwards (call with interrupts masked)
+ *
+ * @return The cycle count
+ */
+static uint32_t trace_get_cycles(void)
+{
+    uint32_t cycles = clock_get_cycles();
+
+    if (cycles < last_cycles)
+    {
+        wraps++;
+    }
+    last_cycles = cycles;
+
+    return cycles;
+}
+
+/* End trace.c */
@@ -0,0 +1,97 @@
+/**
+ * @file trace.h
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Records a timeline of command and interrupt activity, stamped with the DWT cycle counter
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+// Note on tracing:
+//  - Each record is 8 bytes: a 40-bit timestamp (the DWT cycle count, plus the number of times it wrapped), the event,
+//    an ID (COMMAND_ID_* or TRACE_ISR_*) and an argument (the scheduler slot, or the UART channel)
+//  - Records go into a RAM ring of TRACE_BUFFER_SIZE entries. Once full, the oldest records are overwritten
+//  - The scheduler records the entry, done, exit and abort of every command. Interrupts record their enter and exit
+//    with TRACE_ISR_ENTER()/TRACE_ISR_EXIT() (through ISR_ENTER()/ISR_EXIT(), see cpuload.h), filtered at compile
+//    time by TRACE_ISR_MASK:
+//      - The stepper, switch and gantry interrupts run at 5 kHz or more, and would fill the ring in a fraction of a
+//        second, so only the UART is traced by default. Add the others for short captures of motion timing
+//  - The cycle counter wraps about every 35.8 s. Wraps are counted when the counter is read, so trace_keepalive() must
+//    run more often than that (the gantry interrupt calls it every tick)
+//  - The Pi requests a dump with the TRACE instruction (see raspberrypi.h). Recording pauses while the dump is sent
+//  - tools/trace_to_chrome.py turns a dump into Chrome trace / Perfetto JSON
+//  - Everything but the dump compiles away unless TRACE_ENABLED is defined (see utils.h)
+
+#include "msp.h"
+#include "clock.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Trace defines
+#define TRACE_BUFFER_SIZE           (512) // Must be a power of two
+#define TRACE_BUFFER_MASK           (TRACE_BUFFER_SIZE - 1)
+#define TRACE_RECORD_SIZE           (8)   // Bytes, once serialized
+
+// Interrupts that may be traced
+#define TRACE_ISR_STEPPER_X         (0)
+#define TRACE_ISR_STEPPER_Y         (1)
+#define TRACE_ISR_STEPPER_Z         (2)
+#define TRACE_ISR_SWITCH            (3)
+#define TRACE_ISR_GANTRY            (4)
+#define TRACE_ISR_UART              (5)   // The argument is the channel
+#define TRACE_ISR_DELAY             (6)
+#define TRACE_ISR_LED               (7)
+#define TRACE_ISR_COMM              (8)
+#define TRACE_ISR_SCAN              (9)
+#define TRACE_ISR_COUNT             (10)
+
+// Interrupts traced (mask of BITS16_MASK(TRACE_ISR_*))
+#define TRACE_ISR_MASK              (BITS16_MASK(TRACE_ISR_UART))
+
+// Events
+typedef enum {
+    TRACE_EVENT_COMMAND_ENTRY = 0,
+    TRACE_EVENT_COMMAND_DONE,
+    TRACE_EVENT_COMMAND_EXIT,
+    TRACE_EVENT_COMMAND_ABORT,
+    TRACE_EVENT_ISR_ENTER,
+    TRACE_EVENT_ISR_EXIT
+} trace_event_t;
+
+// A single record
+typedef struct trace_record_t {
+    uint32_t cycles;                // DWT cycle count
+    uint8_t wraps;                  // Times the cycle count wrapped (the upper 8 bits of the timestamp)
+    uint8_t event;                  // trace_event_t
+    uint8_t id;                     // COMMAND_ID_* or TRACE_ISR_*
+    uint8_t arg;
+} trace_record_t;
+
+// Recording macros
+#ifdef TRACE_ENABLED
+#   define TRACE_RECORD(event, id, arg)     trace_record((event), (id), (arg))
+#   define TRACE_KEEPALIVE()                trace_keepalive()
+#   define TRACE_ISR_ENTER(isr, arg)        do { if (TRACE_ISR_MASK & BITS16_MASK(isr)) { trace_record(TRACE_EVENT_ISR_ENTER, (isr), (arg)); } } while (0)
+#   define TRACE_ISR_EXIT(isr, arg)         do { if (TRACE_ISR_MASK & BITS16_MASK(isr)) { trace_record(TRACE_EVENT_ISR_EXIT, (isr), (arg)); } } while (0)
+#else
+#   define TRACE_RECORD(event, id, arg)
+#   define TRACE_KEEPALIVE()
+#   define TRACE_ISR_ENTER(isr, arg)
+#   define TRACE_ISR_EXIT(isr, arg)
+#endif
+
+// Function definitions
+void trace_init(void);
+void trace_record(uint8_t event, uint8_t id, uint8_t arg);
+void trace_keepalive(void);
+uint16_t trace_pause(void);
+bool trace_get_record(uint16_t index, trace_record_t* p_record);
+void trace_serialize(const trace_record_t* p_record, uint8_t bytes[TRACE_RECORD_SIZE]);
+void trace_resume(void);
+
+#endif /* TRACE_H_ */
@@ -9,6 +9,7 @@
  * 
  */
 #include "uart.h"
+#include "cpuload.h"
 
 // Declare the uart fifos
 fifo8_t fifo8s[NUMBER_OF_ACTIVE_UART_CHANNELS*2];
@@ -270,6 +271,7 @@ bool uart_out_byte(uint8_t uart_channel, uint8_t data)
     bool status = true;
     fifo8_t* p_uart_tx_fifo;
     UART0_Type* p_uart_module;
+    uint32_t primask;
 
     // Get pointers for the appropriate UART module
     switch (uart_channel)
@@ -314,15 +316,59 @@ bool uart_out_byte(uint8_t uart_channel, uint8_t data)
     // Load the value to the software FIFO
     status = fifo8_push(p_uart_tx_fifo, data);
 
-    // If the Tx FIFO is empty copy to hardware
+    // If the Tx FIFO is empty copy to hardware (the Tx interrupt also pops the software FIFO, so keep it out)
+    primask = utils_enter_critical();
     if (p_uart_module->FR & UART_FR_TXFE)
     {
         uart_copy_software_to_hardware(uart_channel);
     }
+    utils_exit_critical(primask);
 
     return status;
 }
 
+/**
+ * @brief Gets how many more bytes the specified UART channel can take for transmission right now
+ *
+ * @param uart_channel One of UART_CHANNEL_X for X={0,1,2,3,6}
+ * @return Free space in the software Tx FIFO (0 for an invalid channel)
+ */
+uint16_t uart_get_tx_space(uint8_t uart_channel)
+{
+    fifo8_t* p_uart_tx_fifo;
+
+    // Get a pointer to the appropriate software FIFO
+    switch (uart_channel)
+    {
+        case UART_CHANNEL_0:
+            p_uart_tx_fifo = uart_0_tx;
+        break;
+
+        case UART_CHANNEL_1:
+            p_uart_tx_fifo = uart_1_tx;
+        break;
+
+        case UART_CHANNEL_2:
+            p_uart_tx_fifo = uart_2_tx;
+        break;
+
+        case UART_CHANNEL_3:
+            p_uart_tx_fifo = uart_3_tx;
+        break;
+
+        case UART_CHANNEL_6:
+            p_uart_tx_fifo = uart_6_tx;
+        break;
+
+        default:
+            // Invalid channel provided
+            return 0;
+    }
+
+    // One slot always stays empty, to tell a full FIFO from an empty one
+    return (FIFO8_SIZE - 1) - fifo8_get_size(p_uart_tx_fifo);
+}
+
 /**
  * @brief Sends a string to the specified UART channel
  *
@@ -411,11 +457,14 @@ bool uart_read_byte(uint8_t uart_channel, uint8_t* byte)
     // Read the appropriate channel
     while (!status)
     {
-        // Short circuit if a fault occurs
-        if (sys_fault)
+        // Short circuit if a fault or reset occurs (so the command waiting on this byte can be preempted)
+        if (sys_fault || sys_reset)
         {
             return false;
         }
+
+        // Clear the receive event first, so a byte arriving after the check below still ends the sleep
+        event_take(EVENT_UART_RX);
         
         // Try to read a byte
         switch (uart_channel)
@@ -445,8 +494,16 @@ bool uart_read_byte(uint8_t uart_channel, uint8_t* byte)
                 status = false;
             break;
         }
+
+        // Sleep until a byte arrives (or any other interrupt, which may be a fault or reset)
+        if (!status)
+        {
+            event_wait(EVENT_UART_RX);
+        }
     }
 
+    // Other readers may be waiting on the event this took
+    event_post(EVENT_UART_RX);
 
     return status;
 }
@@ -771,11 +828,13 @@ static void uart_interrupt_activity(uint8_t uart_channel)
     {
         p_uart_module->ICR |= UART_ICR_RXIC;        // Clear the interrupt
         uart_copy_hardware_to_software(uart_channel);
+        event_post(EVENT_UART_RX);
     }
     else if (p_uart_module->MIS & UART_MIS_RTMIS)   // Rx timeout interrupt
     {
         p_uart_module->ICR |= UART_ICR_RTIC;        // Clear the interrupt
         uart_copy_hardware_to_software(uart_channel);
+        event_post(EVENT_UART_RX);
     }
     else {                                          // Some other interrupt, possibly a fault
         // For debugging purposes
@@ -788,8 +847,12 @@ static void uart_interrupt_activity(uint8_t uart_channel)
  */
 __interrupt void UART0_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_UART, UART_CHANNEL_0);
+
     // Perform the UART interrupt activity (also clears interrupt)
     uart_interrupt_activity(UART_CHANNEL_0);
+
+    ISR_EXIT(TRACE_ISR_UART, UART_CHANNEL_0);
 }
 
 /**
@@ -797,8 +860,12 @@ __interrupt void UART0_HANDLER(void)
  */
 __interrupt void UART1_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_UART, UART_CHANNEL_1);
+
     // Perform the UART interrupt activity (also clears interrupt)
     uart_interrupt_activity(UART_CHANNEL_1);
+
+    ISR_EXIT(TRACE_ISR_UART, UART_CHANNEL_1);
 }
 
 /**
@@ -806,8 +873,12 @@ __interrupt void UART1_HANDLER(void)
  */
 __interrupt void UART2_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_UART, UART_CHANNEL_2);
+
     // Perform the UART interrupt activity (also clears interrupt)
     uart_interrupt_activity(UART_CHANNEL_2);
+
+    ISR_EXIT(TRACE_ISR_UART, UART_CHANNEL_2);
 }
 
 /**
@@ -815,8 +886,12 @@ __interrupt void UART2_HANDLER(void)
  */
 __interrupt void UART3_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_UART, UART_CHANNEL_3);
+
     // Perform the UART interrupt activity (also clears interrupt)
     uart_interrupt_activity(UART_CHANNEL_3);
+
+    ISR_EXIT(TRACE_ISR_UART, UART_CHANNEL_3);
 }
 
 /**
@@ -824,8 +899,12 @@ __interrupt void UART3_HANDLER(void)
  */
 __interrupt void UART6_HANDLER(void)
 {
+    ISR_ENTER(TRACE_ISR_UART, UART_CHANNEL_6);
+
     // Perform the UART interrupt activity (also clears interrupt)
     uart_interrupt_activity(UART_CHANNEL_6);
+
+    ISR_EXIT(TRACE_ISR_UART, UART_CHANNEL_6);
 }
 
 /* End uart.c */
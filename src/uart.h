@@ -30,6 +30,7 @@
 #include "fifo.h"
 #include "gpio.h"
 #include "utils.h"
+#include "event.h"
 
 // General UART macros
 #define NUMBER_OF_ACTIVE_UART_CHANNELS      (5)
@@ -100,6 +101,7 @@
 // Public functions
 void uart_init(uint8_t uart_channel);
 bool uart_out_byte(uint8_t uart_channel, uint8_t byte);
+uint16_t uart_get_tx_space(uint8_t uart_channel);
 bool uart_read_byte(uint8_t uart_channel, uint8_t* byte);
 bool uart_read_byte_unblocked(uint8_t uart_channel, uint8_t* byte);
 bool uart_read_string(uint8_t uart_channel, char *data, uint8_t num_chars);
@@ -224,6 +224,28 @@ void utils_set_nvic(uint8_t interrupt_num, uint8_t priority)
     NVIC->IP[interrupt_num] |= (priority << 5);
 }
 
+/**
+ * @brief Masks all configurable interrupts (critical sections may nest)
+ *
+ * @return The previous interrupt mask, to pass to utils_exit_critical()
+ */
+uint32_t utils_enter_critical(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+/**
+ * @brief Restores the interrupt mask from before the matching utils_enter_critical()
+ *
+ * @param primask The value returned by utils_enter_critical()
+ */
+void utils_exit_critical(uint32_t primask)
+{
+    __set_PRIMASK(primask);
+}
+
 /**
  * @brief A general purpose empty function for a command {entry, action, exit} that does nothing
  */
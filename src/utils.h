@@ -15,10 +15,13 @@
 #define PERIPHERALS_ENABLED         // Enable electromagent and sensor network
 //#define GANTRY_DEBUG                // Run specific gantry commands
 //#define STEPPER_DEBUG               // Debug motion profiling
+//#define TRACE_ENABLED               // Record the command/interrupt timeline (see trace.h)
+//#define CPULOAD_ENABLED             // Measure interrupt and idle time (see cpuload.h)
 
 // Game mode select (define at most one at a time)
 //#define THREE_PARTY_MODE            // User sends moves to MSP, which sends moves to RPi, which sends moves back
 #define FINAL_IMPLEMENTATION_MODE   // Final implementation w/ board reading
+//#define AUTO_TURN_ENABLED           // Final implementation only: end the human's turn from the board, w/o buttons (see autoturn.h)
 
 // Notes on vports: 
 //  - A virtual port (vport) is a means of accessing a physical port via imaging and a bitfield
@@ -54,10 +57,9 @@
 #define HOMING_X_BACKOFF                    (-6)        // mm
 #define HOMING_Y_BACKOFF                    (6)         // mm
 #define HOMING_Z_BACKOFF                    (-6)        // mm
-#define HOMING_X_VELOCITY                   (1)         // mm
-#define HOMING_Y_VELOCITY                   (1)         // mm
-#define HOMING_Z_VELOCITY                   (1)         // mm
-#define HOMING_DELAY_MS                     (100)       // ms
+#define HOMING_X_VELOCITY                   (50)        // mm/s
+#define HOMING_Y_VELOCITY                   (50)        // mm/s
+#define HOMING_Z_VELOCITY                   (50)        // mm/s
 
 // Shared flags
 extern bool sys_fault;
@@ -175,6 +177,8 @@ void utils_uart_clock_enable(uint8_t uart_channel);
 void utils_timer_clock_enable(TIMER0_Type* timer);
 void utils_delay(uint32_t ticks);
 void utils_set_nvic(uint8_t interrupt_num, uint8_t priority);
+uint32_t utils_enter_critical(void);
+void utils_exit_critical(uint32_t primask);
 void utils_empty_function(command_t* command);
 
 // Math and bit manipulation utils
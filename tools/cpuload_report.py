@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+@file cpuload_report.py
+@author Eli Jelesko (ebj5hec@virginia.edu)
+@brief Prints the CPU load measured by the MSP432 (see src/cpuload.h)
+@version 0.1
+@date 2026-10-16
+
+@copyright Copyright (c) 2022
+
+Usage:
+    Request the load over the Pi UART (while the MSP432 waits for a robot move):
+        python3 cpuload_report.py --port /dev/serial0
+    Print a response captured earlier (raw bytes, as sent by the MSP432):
+        python3 cpuload_report.py --input load.bin
+
+Each request covers the time since the previous one, so request once to start a window, run the scenario (e.g. a move
+at maximum velocity), then request again.
+"""
+
+import argparse
+import struct
+
+from trace_to_chrome import ACK_BYTE, ISR_NAMES, START_BYTE, SYSCLOCK_FREQUENCY, fl16_check_bytes
+
+# Frame format (see src/raspberrypi.h)
+LOAD_INSTR_AND_LEN = 0x80
+LOAD_RECORD_INSTR_AND_LEN = 0x8E
+LOAD_RECORD_LENGTH = 14
+ID_IDLE = 0xFE
+ID_WINDOW = 0xFF
+
+USAGE_NAMES = dict(ISR_NAMES)
+USAGE_NAMES[ID_IDLE] = "idle"
+
+
+def parse_records(data):
+    """Returns {id: (count, cycles, max_cycles)} for each valid record, up to the window record"""
+    records = {}
+    i = 0
+    while i + 4 + LOAD_RECORD_LENGTH <= len(data):
+        frame = data[i:i + 4 + LOAD_RECORD_LENGTH]
+        if (frame[0] != START_BYTE) or (frame[1] != LOAD_RECORD_INSTR_AND_LEN) or \
+           (fl16_check_bytes(frame[:-2]) != frame[-2:]):
+            i += 1
+            continue
+
+        ident, count, cycles_low, cycles_high, max_cycles = struct.unpack("<BIIBI", frame[2:-2])
+        records[ident] = (count, (cycles_high << 32) | cycles_low, max_cycles)
+        if ident == ID_WINDOW:
+            break
+        i += len(frame)
+
+    return records
+
+
+def read_port(port, baud):
+    """Requests the load over the Pi UART, and reads every record"""
+    import serial
+
+    request = bytes([START_BYTE, LOAD_INSTR_AND_LEN])
+    request += fl16_check_bytes(request)
+
+    with serial.Serial(port, baud, timeout=10) as uart:
+        uart.reset_input_buffer()
+        uart.write(request)
+        data = uart.read(1 + (4 + LOAD_RECORD_LENGTH) * (len(USAGE_NAMES) + 1))
+
+    # Drop the ACK
+    if data[:1] == bytes([ACK_BYTE]):
+        data = data[1:]
+    return data
+
+
+def report(records):
+    """Prints a table of the load of each interrupt, and of the idle loop"""
+    if ID_WINDOW not in records:
+        raise SystemExit("No window record received")
+
+    window = records[ID_WINDOW][1]
+    print("Window: %.3f s" % (window / SYSCLOCK_FREQUENCY))
+    print("%-10s %10s %8s %12s %12s" % ("", "count", "load %", "mean (us)", "max (us)"))
+
+    for ident, name in sorted(USAGE_NAMES.items()):
+        if ident not in records:
+            continue
+        count, cycles, max_cycles = records[ident]
+        load = 100.0 * cycles / window if window else 0
+        mean = (cycles / count) * 1e6 / SYSCLOCK_FREQUENCY if count else 0
+        print("%-10s %10d %8.2f %12.2f %12.2f" % (name, count, load, mean, max_cycles * 1e6 / SYSCLOCK_FREQUENCY))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port connected to the MSP432 (requires pyserial)")
+    source.add_argument("--input", help="file holding a raw response")
+    parser.add_argument("--baud", type=int, default=9600)
+    args = parser.parse_args()
+
+    if args.port:
+        data = read_port(args.port, args.baud)
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+
+    report(parse_records(data))
+
+
+if __name__ == "__main__":
+    main()
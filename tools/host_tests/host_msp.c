@@ -0,0 +1,100 @@
+/**
+ * @file host_msp.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Peripheral memory and core intrinsics for the host tests (see msp.h)
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "msp.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Peripherals
+GPIO_Type host_gpio[15];
+TIMER0_Type host_timer[8];
+UART0_Type host_uart[8];
+SYSCTL_Type host_sysctl = {.PLLSTAT = SYSCTL_PLLSTAT_LOCK, .PRGPIO = 0xFFFFFFFF, .PRTIMER = 0xFFFFFFFF, .PRUART = 0xFFFFFFFF, .PRPWM = 0xFFFFFFFF};
+PWM0_Type host_pwm0;
+NVIC_Type host_nvic;
+SysTick_Type host_systick;
+SCB_Type host_scb;
+CoreDebug_Type host_coredebug;
+DWT_Type host_dwt;
+
+// Interrupt masking (one lock for the whole "core", held by the thread which masked interrupts)
+static pthread_mutex_t host_primask_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread uint32_t host_primask = 0;
+
+void __disable_irq(void)
+{
+    if (!host_primask)
+    {
+        pthread_mutex_lock(&host_primask_lock);
+        host_primask = 1;
+    }
+}
+
+void __enable_irq(void)
+{
+    if (host_primask)
+    {
+        host_primask = 0;
+        pthread_mutex_unlock(&host_primask_lock);
+    }
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    return host_primask;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+    if (primask)
+    {
+        __disable_irq();
+    }
+    else
+    {
+        __enable_irq();
+    }
+}
+
+void host_isr_enter(void)
+{
+    __disable_irq();
+}
+
+void host_isr_exit(void)
+{
+    __enable_irq();
+}
+
+// Barriers and sleep
+void __DMB(void)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void __DSB(void)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void __ISB(void)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void __WFI(void)
+{
+}
+
+void __WFE(void)
+{
+}
+
+/* End host_msp.c */
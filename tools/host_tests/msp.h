@@ -0,0 +1,275 @@
+/**
+ * @file msp.h
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Host stand-in for the MSP432E401Y device header, so the firmware modules build and run on a PC
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef HOST_MSP_H_
+#define HOST_MSP_H_
+
+// Note on the host build:
+//  - Only used by the host tests (see run.sh), which put this directory ahead of the device headers
+//  - Every peripheral is a plain block of RAM (see host_msp.c), so register writes are kept and can be read back, but
+//    nothing happens on its own (timers never count, UARTs never receive). The PLL and peripheral ready bits read as set
+//  - Only the register fields and bit values the firmware uses are declared. Bit values follow the device header where a
+//    module masks with them; the rest only need to exist
+//  - PRIMASK is emulated with a lock held by whichever thread masked "interrupts" (see host_isr_enter()), so a test
+//    thread standing in for an interrupt can never run in the middle of a critical section
+//  - __DMB() is a C11 sequentially consistent fence
+
+#include <stdint.h>
+
+#define __IO volatile
+
+// Peripheral register blocks
+typedef struct {
+    __IO uint32_t RESERVED0[255];                       // Masked DATA addresses (see gpio_get_masked_data())
+    __IO uint32_t DATA;
+    __IO uint32_t DIR, IS, IBE, IEV, IM, RIS, MIS, ICR, AFSEL;
+    __IO uint32_t DR2R, DR4R, DR8R, ODR, PUR, PDR, SLR, DEN, LOCK, CR, AMSEL, PCTL;
+} GPIO_Type;
+
+typedef struct {
+    __IO uint32_t CFG, TAMR, TBMR, CTL, SYNC, RESERVED0, IMR, RIS, MIS, ICR, TAILR, TBILR, TAMATCHR, TBMATCHR, TAPR, TBPR;
+    __IO uint32_t TAPMR, TBPMR, TAR, TBR, TAV, TBV;
+} TIMER0_Type;
+
+typedef struct {
+    __IO uint32_t DR, RSR, RESERVED0[4], FR, RESERVED1, ILPR, IBRD, FBRD, LCRH, CTL, IFLS, IM, RIS, MIS, ICR, DMACTL;
+    __IO uint32_t CC;
+} UART0_Type;
+
+typedef struct {
+    __IO uint32_t MEMTIM0, PLLFREQ0, PLLFREQ1, PLLSTAT, RSCLKCFG;
+    __IO uint32_t PRGPIO, PRTIMER, PRUART, PRPWM;
+    __IO uint32_t RCGCGPIO, RCGCTIMER, RCGCUART, RCGCPWM;
+} SYSCTL_Type;
+
+typedef struct {
+    __IO uint32_t CTL, ENABLE, CC;
+    __IO uint32_t _3_CTL, _3_LOAD, _3_CMPA, _3_CMPB, _3_GENA, _3_GENB;
+} PWM0_Type;
+
+typedef struct {
+    __IO uint32_t ISER[8];
+    __IO uint8_t  IP[240];
+} NVIC_Type;
+
+typedef struct {
+    __IO uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+typedef struct {
+    __IO uint32_t SHP[12];
+    __IO uint32_t SCR;
+} SCB_Type;
+
+typedef struct {
+    __IO uint32_t DHCSR, DCRSR, DCRDR, DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    __IO uint32_t CTRL, CYCCNT;
+} DWT_Type;
+
+// Interrupt numbers
+typedef enum {
+    SysTick_IRQn = -1,
+    UART0_IRQn   = 5,
+    UART1_IRQn   = 6,
+    TIMER0A_IRQn = 19,
+    TIMER1A_IRQn = 21,
+    TIMER2A_IRQn = 23,
+    UART2_IRQn   = 33,
+    TIMER3A_IRQn = 35,
+    UART3_IRQn   = 56,
+    UART6_IRQn   = 59,
+    TIMER4A_IRQn = 70,
+    TIMER5A_IRQn = 92,
+    TIMER6A_IRQn = 98,
+    TIMER7A_IRQn = 100
+} IRQn_Type;
+
+// Peripherals (see host_msp.c)
+extern GPIO_Type host_gpio[15];
+#define GPIOA                           (&host_gpio[0])
+#define GPIOB                           (&host_gpio[1])
+#define GPIOC                           (&host_gpio[2])
+#define GPIOD                           (&host_gpio[3])
+#define GPIOE                           (&host_gpio[4])
+#define GPIOF                           (&host_gpio[5])
+#define GPIOG                           (&host_gpio[6])
+#define GPIOH                           (&host_gpio[7])
+#define GPIOJ                           (&host_gpio[8])
+#define GPIOK                           (&host_gpio[9])
+#define GPIOL                           (&host_gpio[10])
+#define GPIOM                           (&host_gpio[11])
+#define GPION                           (&host_gpio[12])
+#define GPIOP                           (&host_gpio[13])
+#define GPIOQ                           (&host_gpio[14])
+
+extern TIMER0_Type host_timer[8];
+#define TIMER0                          (&host_timer[0])
+#define TIMER1                          (&host_timer[1])
+#define TIMER2                          (&host_timer[2])
+#define TIMER3                          (&host_timer[3])
+#define TIMER4                          (&host_timer[4])
+#define TIMER5                          (&host_timer[5])
+#define TIMER6                          (&host_timer[6])
+#define TIMER7                          (&host_timer[7])
+
+extern UART0_Type host_uart[8];
+#define UART0                           (&host_uart[0])
+#define UART1                           (&host_uart[1])
+#define UART2                           (&host_uart[2])
+#define UART3                           (&host_uart[3])
+#define UART4                           (&host_uart[4])
+#define UART5                           (&host_uart[5])
+#define UART6                           (&host_uart[6])
+#define UART7                           (&host_uart[7])
+
+extern SYSCTL_Type host_sysctl;
+extern PWM0_Type host_pwm0;
+extern NVIC_Type host_nvic;
+extern SysTick_Type host_systick;
+extern SCB_Type host_scb;
+extern CoreDebug_Type host_coredebug;
+extern DWT_Type host_dwt;
+#define SYSCTL                          (&host_sysctl)
+#define PWM0                            (&host_pwm0)
+#define NVIC                            (&host_nvic)
+#define SysTick                         (&host_systick)
+#define SCB                             (&host_scb)
+#define CoreDebug                       (&host_coredebug)
+#define DWT                             (&host_dwt)
+
+// Core intrinsics
+void __WFI(void);
+void __WFE(void);
+void __DSB(void);
+void __DMB(void);
+void __ISB(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+    NVIC->IP[(irq < 0) ? 0 : irq] = (uint8_t) priority;
+}
+
+// Host only: run a test thread as if it were an interrupt (masks the others until host_isr_exit())
+void host_isr_enter(void);
+void host_isr_exit(void);
+
+// Core bits
+#define SysTick_CTRL_ENABLE_Msk         (0x00000001)
+#define SysTick_CTRL_TICKINT_Msk        (0x00000002)
+#define SysTick_CTRL_CLKSOURCE_Msk      (0x00000004)
+#define CoreDebug_DEMCR_TRCENA_Msk      (0x01000000)
+#define DWT_CTRL_CYCCNTENA_Msk          (0x00000001)
+#define NVIC_ST_RELOAD_S                (0)
+
+// GPIO bits
+#define GPIO_LOCK_KEY                   (0x4C4F434B)
+
+// Timer bits
+#define TIMER_CTL_TAEN                  (0x00000001)
+#define TIMER_IMR_TATOIM                (0x00000001)
+#define TIMER_ICR_TATOCINT              (0x00000001)
+#define TIMER_TAMR_TAMR_PERIOD          (0x00000002)
+#define TIMER_TAMR_TAILD                (0x00000100)
+
+// UART bits
+#define UART_DR_DATA_M                  (0x000000FF)
+#define UART_FR_RXFE                    (0x00000010)
+#define UART_FR_TXFF                    (0x00000020)
+#define UART_FR_TXFE                    (0x00000080)
+#define UART_IBRD_DIVINT_S              (0)
+#define UART_FBRD_DIVFRAC_S             (0)
+#define UART_LCRH_FEN                   (0x00000010)
+#define UART_LCRH_WLEN_8                (0x00000060)
+#define UART_CTL_UARTEN                 (0x00000001)
+#define UART_IFLS_RX1_8                 (0x00000000)
+#define UART_IFLS_TX1_8                 (0x00000000)
+#define UART_IM_RXIM                    (0x00000010)
+#define UART_IM_TXIM                    (0x00000020)
+#define UART_IM_RTIM                    (0x00000040)
+#define UART_MIS_RXMIS                  (0x00000010)
+#define UART_MIS_TXMIS                  (0x00000020)
+#define UART_MIS_RTMIS                  (0x00000040)
+#define UART_ICR_RXIC                   (0x00000010)
+#define UART_ICR_TXIC                   (0x00000020)
+#define UART_ICR_RTIC                   (0x00000040)
+#define UART_CC_CS_PIOSC                (0x00000005)
+
+// PWM bits
+#define PWM_CC_USEPWM                   (0x00000100)
+#define PWM_CC_PWMDIV_8                 (0x00000002)
+#define PWM_0_CTL_ENABLE                (0x00000001)
+#define PWM_3_CTL_ENABLE                (0x00000001)
+#define PWM_0_GENA_ACTLOAD_ONE          (0x0000000C)
+#define PWM_0_GENA_ACTCMPAD_ZERO        (0x00000080)
+#define PWM_0_GENB_ACTLOAD_ONE          (0x0000000C)
+#define PWM_0_GENB_ACTCMPBD_ZERO        (0x00000800)
+#define PWM_ENABLE_PWM6EN               (0x00000040)
+#define PWM_ENABLE_PWM7EN               (0x00000080)
+
+// System control bits
+#define SYSCTL_RCGCGPIO_R0              (0x00000001)
+#define SYSCTL_RCGCGPIO_R1              (0x00000002)
+#define SYSCTL_RCGCGPIO_R2              (0x00000004)
+#define SYSCTL_RCGCGPIO_R3              (0x00000008)
+#define SYSCTL_RCGCGPIO_R4              (0x00000010)
+#define SYSCTL_RCGCGPIO_R5              (0x00000020)
+#define SYSCTL_RCGCGPIO_R6              (0x00000040)
+#define SYSCTL_RCGCGPIO_R7              (0x00000080)
+#define SYSCTL_RCGCGPIO_R8              (0x00000100)
+#define SYSCTL_RCGCGPIO_R9              (0x00000200)
+#define SYSCTL_RCGCGPIO_R10             (0x00000400)
+#define SYSCTL_RCGCGPIO_R11             (0x00000800)
+#define SYSCTL_RCGCGPIO_R12             (0x00001000)
+#define SYSCTL_RCGCGPIO_R13             (0x00002000)
+#define SYSCTL_RCGCGPIO_R14             (0x00004000)
+#define SYSCTL_RCGCTIMER_R0             (0x00000001)
+#define SYSCTL_RCGCTIMER_R1             (0x00000002)
+#define SYSCTL_RCGCTIMER_R2             (0x00000004)
+#define SYSCTL_RCGCTIMER_R3             (0x00000008)
+#define SYSCTL_RCGCTIMER_R4             (0x00000010)
+#define SYSCTL_RCGCTIMER_R5             (0x00000020)
+#define SYSCTL_RCGCTIMER_R6             (0x00000040)
+#define SYSCTL_RCGCTIMER_R7             (0x00000080)
+#define SYSCTL_RCGCUART_R0              (0x00000001)
+#define SYSCTL_RCGCUART_R1              (0x00000002)
+#define SYSCTL_RCGCUART_R2              (0x00000004)
+#define SYSCTL_RCGCUART_R3              (0x00000008)
+#define SYSCTL_RCGCUART_R4              (0x00000010)
+#define SYSCTL_RCGCUART_R5              (0x00000020)
+#define SYSCTL_RCGCUART_R6              (0x00000040)
+#define SYSCTL_RCGCUART_R7              (0x00000080)
+#define SYSCTL_RCGCPWM_R0               (0x00000001)
+#define SYSCTL_MEMTIM0_FWS_S            (0)
+#define SYSCTL_MEMTIM0_FBCE             (0x00000020)
+#define SYSCTL_MEMTIM0_FBCHT_3_5        (0x000001C0)
+#define SYSCTL_MEMTIM0_EWS_S            (16)
+#define SYSCTL_MEMTIM0_EBCE             (0x00200000)
+#define SYSCTL_MEMTIM0_EBCHT_3_5        (0x01C00000)
+#define SYSCTL_PLLFREQ0_MINT_S          (0)
+#define SYSCTL_PLLFREQ0_MFRAC_S         (10)
+#define SYSCTL_PLLFREQ0_PLLPWR          (0x00800000)
+#define SYSCTL_PLLFREQ1_N_S             (0)
+#define SYSCTL_PLLFREQ1_Q_S             (8)
+#define SYSCTL_PLLSTAT_LOCK             (0x00000001)
+#define SYSCTL_RSCLKCFG_PSYSDIV_S       (0)
+#define SYSCTL_RSCLKCFG_OSCSRC_PIOSC    (0x00000000)
+#define SYSCTL_RSCLKCFG_PLLSRC_PIOSC    (0x00000000)
+#define SYSCTL_RSCLKCFG_USEPLL          (0x10000000)
+#define SYSCTL_RSCLKCFG_NEWFREQ         (0x40000000)
+#define SYSCTL_RSCLKCFG_MEMTIMU         (0x80000000)
+
+#endif /* HOST_MSP_H_ */
@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# @file run.sh
+# @author Eli Jelesko (ebj5hec@virginia.edu)
+# @brief Builds and runs the host tests (firmware logic checked on a PC, without the board)
+# @version 0.1
+# @date 2026-10-16
+#
+# @copyright Copyright (c) 2022
+#
+# Usage:
+#     sh tools/host_tests/run.sh              (every test_*.c)
+#     sh tools/host_tests/run.sh test_x.c     (only the given tests)
+#
+# Each test links against every firmware module except main.c, using the msp.h stand-in in this directory. A test that
+# needs a module's private functions includes that module's .c file directly, and the module is left out of its link.
+# Needs gcc, libm, and pthreads. Exits non-zero if any test fails.
+
+set -u
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+SRC="$HERE/../../src"
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+CC=${CC:-gcc}
+CFLAGS="-std=gnu99 -O2 -fcommon -Wall -D__interrupt= -I$HERE -I$SRC"
+
+if [ $# -gt 0 ]; then
+    TESTS="$*"
+else
+    TESTS=$(cd "$HERE" && ls test_*.c)
+fi
+
+failed=0
+for test in $TESTS; do
+    name=$(basename "$test" .c)
+    included=$(sed -n 's/^#include "\.\.\/\.\.\/src\/\([a-z_]*\)\.c".*/\1.c/p' "$HERE/$test" | tr '\n' ' ')
+    modules=""
+    for module in "$SRC"/*.c; do
+        base=$(basename "$module")
+        case " main.c $included " in
+            *" $base "*) ;;
+            *) modules="$modules $module" ;;
+        esac
+    done
+
+    if ! $CC $CFLAGS -o "$OUT/$name" "$HERE/$test" "$HERE/host_msp.c" $modules -lm -pthread; then
+        echo "BUILD FAILED $name"
+        failed=1
+        continue
+    fi
+
+    if "$OUT/$name"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name"
+        failed=1
+    fi
+done
+
+exit $failed
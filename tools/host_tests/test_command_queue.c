@@ -0,0 +1,204 @@
+/**
+ * @file test_command_queue.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Stress tests the command queue's ring and mailbox with a producer and a consumer on separate threads
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+// Note on the command queue test:
+//  - The ring: a producer thread pushes QUEUE_TEST_RING_COUNT numbered commands into the normal lane while the main
+//    thread pops them. The head and tail wrap (uint16_t) many times over, and the ring is kept full most of the time
+//  - The commands come from an array of 2*COMMAND_QUEUE_SIZE, so a command is only renumbered once the consumer has
+//    certainly read it. Every command popped must carry the next number: nothing lost, duplicated or reordered
+//  - The mailbox: an "interrupt" thread (host_isr_enter()/host_isr_exit()) posts numbered pool commands with
+//    command_queue_post_from_isr() while the main thread pops. The numbers popped must only increase, and every post
+//    that was accepted must be popped exactly once
+//  - __DMB() is a C11 fence on the host (see msp.h), so the queue's barriers are what keep each test in order
+
+#include "../../src/command_queue.h"
+#include "../../src/command_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#define QUEUE_TEST_RING_COUNT           (1000000)
+#define QUEUE_TEST_MAILBOX_COUNT        (200000)
+#define QUEUE_TEST_ITEMS                (2 * COMMAND_QUEUE_SIZE)
+
+// A numbered command
+typedef struct queue_test_command_t {
+    command_t super;
+    uint32_t sequence;
+} queue_test_command_t;
+
+static queue_test_command_t ring_items[QUEUE_TEST_ITEMS];
+static uint32_t mailbox_accepted = 0;
+static atomic_bool mailbox_done = false;
+
+/**
+ * @brief Pushes the numbered commands into the normal lane, waiting whenever it is full
+ *
+ * @param p_arg Unused
+ * @return NULL
+ */
+static void* queue_test_ring_producer(void* p_arg)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < QUEUE_TEST_RING_COUNT; i++)
+    {
+        queue_test_command_t* p_item = &ring_items[i % QUEUE_TEST_ITEMS];
+
+        p_item->sequence = i;
+        while (!command_queue_push(&p_item->super))
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Posts numbered pool commands to the mailbox from an "interrupt"
+ *
+ * @param p_arg Unused
+ * @return NULL
+ */
+static void* queue_test_mailbox_producer(void* p_arg)
+{
+    uint32_t i = 0;
+
+    for (i = 1; i <= QUEUE_TEST_MAILBOX_COUNT; i++)
+    {
+        queue_test_command_t* p_item;
+
+        host_isr_enter();
+        p_item = (queue_test_command_t*) command_pool_alloc(sizeof(queue_test_command_t));
+        if (p_item != NULL)
+        {
+            p_item->sequence = i;
+            mailbox_accepted += command_queue_post_from_isr(&p_item->super);
+        }
+        host_isr_exit();
+
+        // Give the consumer a chance, so that some posts land in an empty mailbox and some do not
+        if (i & 0x01)
+        {
+            sched_yield();
+        }
+    }
+    atomic_store(&mailbox_done, true);
+
+    return NULL;
+}
+
+/**
+ * @brief Pops the numbered commands from the normal lane, and checks that they arrive in order
+ *
+ * @return Whether every command arrived once, in order
+ */
+static bool queue_test_ring(void)
+{
+    pthread_t producer;
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+
+    command_queue_init();
+    pthread_create(&producer, NULL, &queue_test_ring_producer, NULL);
+
+    while (expected < QUEUE_TEST_RING_COUNT)
+    {
+        command_t* p_command;
+
+        if (!command_queue_pop(&p_command))
+        {
+            sched_yield();
+            continue;
+        }
+
+        if (((queue_test_command_t*) p_command)->sequence != expected)
+        {
+            if (errors++ < 10)
+            {
+                printf("  ring: popped %u, expected %u\n", (unsigned) ((queue_test_command_t*) p_command)->sequence, (unsigned) expected);
+            }
+            expected = ((queue_test_command_t*) p_command)->sequence;
+        }
+        expected++;
+    }
+
+    pthread_join(producer, NULL);
+    errors += !command_queue_is_empty();
+
+    printf("  ring: %u commands through %u slots, %u errors\n", (unsigned) QUEUE_TEST_RING_COUNT, (unsigned) COMMAND_QUEUE_SIZE, (unsigned) errors);
+    return (errors == 0);
+}
+
+/**
+ * @brief Pops the commands posted to the mailbox, and checks that each accepted post arrives once, in order
+ *
+ * @return Whether every accepted post arrived once, in order
+ */
+static bool queue_test_mailbox(void)
+{
+    pthread_t producer;
+    command_pool_stats_t stats;
+    uint32_t last = 0;
+    uint32_t consumed = 0;
+    uint32_t errors = 0;
+    bool producing = true;
+
+    command_queue_init();
+    command_pool_init();
+    pthread_create(&producer, NULL, &queue_test_mailbox_producer, NULL);
+
+    while (producing || !command_queue_is_empty())
+    {
+        command_t* p_command;
+
+        // Stop once the producer is done and the last post has been taken
+        producing = !atomic_load(&mailbox_done);
+
+        if (!command_queue_pop(&p_command))
+        {
+            sched_yield();
+            continue;
+        }
+
+        if (((queue_test_command_t*) p_command)->sequence <= last)
+        {
+            if (errors++ < 10)
+            {
+                printf("  mailbox: popped %u after %u\n", (unsigned) ((queue_test_command_t*) p_command)->sequence, (unsigned) last);
+            }
+        }
+        last = ((queue_test_command_t*) p_command)->sequence;
+        consumed++;
+        command_pool_free(p_command);
+    }
+
+    pthread_join(producer, NULL);
+    command_pool_get_stats(&stats);
+    errors += (consumed != mailbox_accepted) + (stats.in_use != 0);
+
+    printf("  mailbox: %u posted, %u accepted, %u popped, %u still allocated, %u errors\n", (unsigned) QUEUE_TEST_MAILBOX_COUNT,
+           (unsigned) mailbox_accepted, (unsigned) consumed, (unsigned) stats.in_use, (unsigned) errors);
+    return (errors == 0);
+}
+
+int main(void)
+{
+    uint8_t failures = 0;
+
+    failures += !queue_test_ring();
+    failures += !queue_test_mailbox();
+
+    return (failures != 0);
+}
+
+/* End test_command_queue.c */
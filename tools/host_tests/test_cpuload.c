@@ -0,0 +1,195 @@
+/**
+ * @file test_cpuload.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Runs the step interrupts of all three axes at maximum velocity through the load monitor, and reports the load
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+// Note on the CPU load test:
+//  - X, Y and Z each make one long move, all at once, with the envelope bounded to STEPPER_*_MAX_V and STEPPER_*_MAX_A.
+//    The step handlers are compiled with CPULOAD_ENABLED, so ISR_ENTER()/ISR_EXIT() time them exactly as on the board
+//  - The interrupts run in the order their timers would expire. Between interrupts the cycle counter follows that
+//    simulated timeline (120 MHz), and the timer rule is the one test_stepper_profile.c follows
+//  - Inside a handler the cycle counter advances with the time the handler takes on this PC, counted at 120 MHz. That is
+//    far less than the board takes, so those cycles only show how the handler's cost is spread. The board's come from
+//    the LOAD dump (tools/cpuload_report.py)
+//  - The invocation counts and the window are exact, so they are checked: one interrupt per transition plus the one
+//    which stops the timer, and a window as long as the simulated run. From them, the report gives each axis' interrupt
+//    rate, and the cycles the board has for each step interrupt before the three axes alone saturate it
+
+#define CPULOAD_ENABLED
+#include "../../src/steppermotors.c"
+
+// The test keeps the cycle counter (see below)
+#define clock_get_cycles clock_get_cycles_dwt
+#include "../../src/clock.c"
+#undef clock_get_cycles
+
+#include <stdio.h>
+#include <time.h>
+
+#define CPULOAD_TEST_SPEED              (0xFFFF)        // mm/s and mm/s/s, bounded to the axis limits
+
+// Test case (one per axis, all running at once)
+typedef struct {
+    const char* name;
+    uint8_t motor_id;
+    uint8_t isr;                                        // TRACE_ISR_*
+    int16_t distance;                                   // mm
+    void (*p_handler)(void);
+} cpuload_case_t;
+
+void STEPPER_X_HANDLER(void);
+void STEPPER_Y_HANDLER(void);
+void STEPPER_Z_HANDLER(void);
+
+static const cpuload_case_t cpuload_cases[NUMBER_OF_STEPPER_MOTORS] = {
+    {"x", STEPPER_X_ID, TRACE_ISR_STEPPER_X, 400, &STEPPER_X_HANDLER},
+    {"y", STEPPER_Y_ID, TRACE_ISR_STEPPER_Y, 400, &STEPPER_Y_HANDLER},
+    {"z", STEPPER_Z_ID, TRACE_ISR_STEPPER_Z, 120, &STEPPER_Z_HANDLER}
+};
+
+// Simulated cycle counter
+static uint64_t cpuload_test_cycles = 0;
+static bool cpuload_test_in_isr = false;
+static struct timespec cpuload_test_isr_start;
+
+/**
+ * @brief Stands in for the DWT cycle counter: the simulated time, plus the time on this PC inside a handler
+ *
+ * @return The cycle count
+ */
+uint32_t clock_get_cycles(void)
+{
+    struct timespec now;
+    uint64_t elapsed_ns;
+
+    if (!cpuload_test_in_isr)
+    {
+        return (uint32_t) cpuload_test_cycles;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed_ns = (uint64_t) ((now.tv_sec - cpuload_test_isr_start.tv_sec) * 1000000000LL + (now.tv_nsec - cpuload_test_isr_start.tv_nsec));
+    return (uint32_t) (cpuload_test_cycles + (elapsed_ns * (SYSCLOCK_FREQUENCY / 1000000)) / 1000);
+}
+
+/**
+ * @brief Plans and starts one axis' move the way stepper_update_velocities() does
+ *
+ * @param p_case The axis
+ * @return The number of transitions in the move
+ */
+static uint32_t cpuload_test_start(const cpuload_case_t* p_case)
+{
+    static const stepper_envelope_t requested = {CPULOAD_TEST_SPEED, CPULOAD_TEST_SPEED, CPULOAD_TEST_SPEED};
+    stepper_motors_t* p_stepper_motor = &stepper_motors[p_case->motor_id];
+    bool z_axis = (p_case->motor_id == STEPPER_Z_ID);
+    uint32_t total = stepper_distance_to_transitions(p_case->distance, z_axis);
+    stepper_envelope_t envelope;
+
+    // Start at a fifth of the top speed, so the run includes both ramps
+    stepper_bound_envelope(&envelope, &requested, z_axis ? STEPPER_Z_MAX_V : STEPPER_X_MAX_V, z_axis ? STEPPER_Z_MAX_A : STEPPER_X_MAX_A, z_axis);
+    envelope.v_start = envelope.v_cruise / 5;
+
+    p_stepper_motor->profile                    = STEPPER_PROFILE_TRAPEZOID;
+    p_stepper_motor->transitions_to_desired_pos = total;
+    p_stepper_motor->transitions_total          = total;
+    p_stepper_motor->coordinated_mask           = 0;
+    stepper_plan_ramp(p_stepper_motor, &envelope);
+    stepper_start_motor(p_stepper_motor, &envelope);
+
+    return total;
+}
+
+int main(void)
+{
+    static cpuload_snapshot_t snapshot;
+    uint64_t next_cycles[NUMBER_OF_STEPPER_MOTORS];
+    uint32_t totals[NUMBER_OF_STEPPER_MOTORS];
+    uint32_t min_interval[NUMBER_OF_STEPPER_MOTORS];
+    uint64_t stepper_cycles = 0;
+    double window_s = 0;
+    bool passed = true;
+    uint8_t i = 0;
+
+    stepper_init_motors();
+    cpuload_init();
+
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        totals[i]       = cpuload_test_start(&cpuload_cases[i]);
+        next_cycles[i]  = stepper_motors[i].timer->TAILR + 1;
+        min_interval[i] = UINT32_MAX;
+    }
+
+    // Run the interrupts in the order the timers expire, until every axis has stopped
+    while (true)
+    {
+        const cpuload_case_t* p_case = NULL;
+        uint32_t interval;
+
+        for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+        {
+            if (clock_active(stepper_motors[i].timer) && ((p_case == NULL) || (next_cycles[i] < next_cycles[p_case->motor_id])))
+            {
+                p_case = &cpuload_cases[i];
+            }
+        }
+        if (p_case == NULL)
+        {
+            break;
+        }
+
+        // The interval after this time-out is the one already loaded, whatever the handler queues next
+        cpuload_test_cycles = next_cycles[p_case->motor_id];
+        interval = stepper_motors[p_case->motor_id].timer->TAILR + 1;
+
+        host_isr_enter();
+        clock_gettime(CLOCK_MONOTONIC, &cpuload_test_isr_start);
+        cpuload_test_in_isr = true;
+        p_case->p_handler();
+        cpuload_test_in_isr = false;
+        host_isr_exit();
+
+        next_cycles[p_case->motor_id] += interval;
+        if (interval < min_interval[p_case->motor_id])
+        {
+            min_interval[p_case->motor_id] = interval;
+        }
+    }
+
+    cpuload_take_snapshot(&snapshot);
+    window_s = (double) snapshot.window_cycles / SYSCLOCK_FREQUENCY;
+
+    // The window ends on the last interrupt
+    passed &= (snapshot.window_cycles == cpuload_test_cycles);
+    printf("  window: %llu cycles (%.3f s) %s\n", (unsigned long long) snapshot.window_cycles, window_s,
+           (snapshot.window_cycles == cpuload_test_cycles) ? "ok" : "FAILED (the run took a different time)");
+
+    for (i = 0; i < NUMBER_OF_STEPPER_MOTORS; i++)
+    {
+        const cpuload_usage_t* p_usage = &snapshot.isr[cpuload_cases[i].isr];
+        bool counted = (p_usage->count == totals[i] + 1);
+
+        passed &= counted;
+        stepper_cycles += p_usage->cycles;
+
+        printf("  %s step: %u interrupts (%s), %.0f/s, %u cycles apart at top speed, host-timed mean %.1f max %u cycles, %.3f%% of the window\n",
+               cpuload_cases[i].name, (unsigned) p_usage->count, counted ? "ok" : "FAILED, expected one per transition and one to stop",
+               p_usage->count / window_s, (unsigned) min_interval[i], (p_usage->count != 0) ? (double) p_usage->cycles / p_usage->count : 0.0,
+               (unsigned) p_usage->max_cycles, 100.0 * p_usage->cycles / snapshot.window_cycles);
+    }
+
+    // With every axis at top speed, the interrupts come closest together
+    printf("  all steps: %.3f%% of the window host-timed; at top speed on every axis the board has %.0f cycles per step "
+           "interrupt before they alone saturate the core\n", 100.0 * stepper_cycles / snapshot.window_cycles,
+           (double) SYSCLOCK_FREQUENCY / (STEPPER_X_MAX_V + STEPPER_Y_MAX_V + STEPPER_Z_MAX_V));
+
+    return !passed;
+}
+
+/* End test_cpuload.c */
@@ -0,0 +1,303 @@
+/**
+ * @file test_moveplanner.c
+ * @author Nick Cooney (npc4crc@virginia.edu)
+ * @brief Checks the move planner's time estimates, and the order it picks for captures, promotions and castling
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+// Note on the move planner test:
+//  - moveplanner_get_move_time() is checked against hand-computed times for each profile shape (constant, triangular,
+//    trapezoidal), and for continuity where the triangle becomes a trapezoid
+//  - moveplanner_get_plan_time() is checked against the sum of the legs of a single relocation, listed by hand
+//  - For each multi-piece move, the test tries every ordering itself, and checks that the compiled program runs a valid
+//    ordering (no piece put down on a square which is still occupied) with the shortest estimated time, and that only
+//    its last relocation raises back to HOME_PIECE
+//  - Each multi-piece case lists its relocations in the order the old hard-coded gantry_robot_exit() ran them, and is
+//    also timed the way that sequence ran: in that order, with every relocation raising back to HOME_PIECE. Both use
+//    today's envelopes and graveyard slots, so only the order and the heights differ. The time the planner saves over
+//    it is reported per case (the magnet delays are the same in both, so they are left out)
+
+#include "../../src/moveplanner.c"
+#include "../../src/gantry.h"
+#include "../../src/graveyard.h"
+#include <stdio.h>
+
+#define PLANNER_TIME_TOLERANCE          (1e-4f)     // s
+
+// The gantry position the planner starts from (see steppermotors.c)
+extern stepper_motors_t stepper_motors[NUMBER_OF_STEPPER_MOTORS];
+
+// Test case for a multi-piece move
+typedef struct {
+    const char* name;
+    chess_file_t start_file;                            // Where the gantry starts
+    chess_rank_t start_rank;
+    uint8_t count;
+    moveplanner_relocation_t relocations[MOVEPLANNER_MAX_RELOCATIONS];
+} planner_case_t;
+
+/**
+ * @brief Places the gantry (as far as the planner can tell)
+ *
+ * @param file The file (mm)
+ * @param rank The rank (mm)
+ * @param piece The height (mm)
+ */
+static void planner_set_position(chess_file_t file, chess_rank_t rank, chess_piece_t piece)
+{
+    stepper_motors[STEPPER_X_ID].current_pos = file * TRANSITIONS_PER_MM;
+    stepper_motors[STEPPER_Y_ID].current_pos = rank * TRANSITIONS_PER_MM;
+    stepper_motors[STEPPER_Z_ID].current_pos = piece * TRANSITIONS_PER_MM_Z;
+}
+
+/**
+ * @brief Compares a time against its expected value
+ *
+ * @param name What is being checked
+ * @param time The time (s)
+ * @param expected The expected time (s)
+ * @return Whether the time matched
+ */
+static bool planner_check_time(const char* name, float time, float expected)
+{
+    if (fabsf(time - expected) > PLANNER_TIME_TOLERANCE)
+    {
+        printf("  %-40s %.6f s, expected %.6f s\n", name, time, expected);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks the single move estimates
+ *
+ * @return Whether every check passed
+ */
+static bool planner_check_move_times(void)
+{
+    static const stepper_envelope_t constant_envelope = {10, 10, 0};
+    static const stepper_envelope_t no_ramp_envelope  = {135, 135, 400};
+    float boundary = 0;
+    bool passed = true;
+
+    // Constant speed: [d/v]
+    passed &= planner_check_time("constant 20 mm", moveplanner_get_move_time(20, &constant_envelope), 2.0f);
+    passed &= planner_check_time("no ramp 27 mm", moveplanner_get_move_time(27, &no_ramp_envelope), 0.2f);
+    passed &= planner_check_time("no distance", moveplanner_get_move_time(0, &gantry_travel_envelope), 0);
+
+    // Trapezoid (travel 300 mm): ramp of (300^2 - 135^2)/(2*900) = 39.875 mm, [2*(300 - 135)/900 + (300 - 79.75)/300]
+    passed &= planner_check_time("travel 300 mm (trapezoid)", moveplanner_get_move_time(300, &gantry_travel_envelope), 1.1008333f);
+
+    // Triangle (carry 20 mm): peak of sqrt(135^2 + 650*20), [2*(176.706 - 135)/650]
+    passed &= planner_check_time("carry 20 mm (triangle)", moveplanner_get_move_time(20, &gantry_carry_envelope), 0.1283261f);
+
+    // Both shapes agree where the ramps just meet (lowering, 2*(135^2 - 60^2)/(2*400) = 36.5625 mm)
+    boundary = 36.5625f;
+    passed &= planner_check_time("lower at the ramp boundary", moveplanner_get_move_time(boundary - 0.001f, &gantry_lower_envelope),
+                                 moveplanner_get_move_time(boundary + 0.001f, &gantry_lower_envelope));
+    passed &= planner_check_time("lower at the ramp boundary (exact)", moveplanner_get_move_time(boundary, &gantry_lower_envelope),
+                                 2 * (135.0f - 60.0f) / 400.0f);
+
+    return passed;
+}
+
+/**
+ * @brief Checks a single relocation's estimate against the sum of its legs
+ *
+ * @return Whether the check passed
+ */
+static bool planner_check_plan_time(void)
+{
+    moveplanner_plan_t plan;
+    uint8_t order[1] = {0};
+    float expected = 0;
+
+    // Pawn e2 to e4, starting parked at home with the magnet raised
+    planner_set_position(HOME_FILE, HOME_RANK, HOME_PIECE);
+    moveplanner_init(&plan);
+    moveplanner_add(&plan, E, SECOND, E, FOURTH, PAWN);
+
+    expected += moveplanner_get_move_time(hypotf(E - HOME_FILE, SECOND - HOME_RANK), &gantry_travel_envelope);  // Travel to e2
+    expected += moveplanner_get_move_time(HOME_PIECE - PAWN, &gantry_lower_envelope);                           // Lower onto the pawn
+    expected += moveplanner_get_move_time(HOME_PIECE - PAWN, &gantry_lift_envelope);                            // Lift it
+    expected += moveplanner_get_move_time(SECOND - FOURTH, &gantry_carry_envelope);                             // Carry it to e4
+    expected += moveplanner_get_move_time(HOME_PIECE - PAWN, &gantry_lower_envelope);                           // Put it down
+    expected += moveplanner_get_move_time(HOME_PIECE - PAWN, &gantry_lift_envelope);                            // Raise to park
+
+    return planner_check_time("e2e4 from home", moveplanner_get_plan_time(&plan, order), expected);
+}
+
+/**
+ * @brief Estimates the time of the old hard-coded sequence: the relocations in the listed order, each raising to HOME_PIECE
+ *
+ * @param p_plan The plan, in the order gantry_robot_exit() used to run it
+ * @return The estimated time (s)
+ */
+static float planner_get_baseline_time(moveplanner_plan_t* p_plan)
+{
+    float pos_x = (float) stepper_get_position_mm(STEPPER_X_ID);
+    float pos_y = (float) stepper_get_position_mm(STEPPER_Y_ID);
+    float pos_z = (float) stepper_get_position_mm(STEPPER_Z_ID);
+    float time = 0;
+    uint8_t i = 0;
+
+    for (i = 0; i < p_plan->count; i++)
+    {
+        moveplanner_relocation_t* p_relocation = &p_plan->relocations[i];
+        float piece_z = (float) p_relocation->piece;
+
+        // Travel to the piece and pick it up
+        time += moveplanner_get_move_time(hypotf(p_relocation->from_file - pos_x, p_relocation->from_rank - pos_y), &gantry_travel_envelope);
+        time += moveplanner_get_move_time(fabsf(pos_z - piece_z), &gantry_lower_envelope);
+        time += moveplanner_get_move_time(fabsf(HOME_PIECE - piece_z), &gantry_lift_envelope);
+
+        // Carry it to its destination, put it down, and raise all the way back up
+        time += moveplanner_get_move_time(hypotf((float) p_relocation->to_file - p_relocation->from_file, (float) p_relocation->to_rank - p_relocation->from_rank), &gantry_carry_envelope);
+        time += moveplanner_get_move_time(fabsf(HOME_PIECE - piece_z), &gantry_lower_envelope);
+        time += moveplanner_get_move_time(fabsf(HOME_PIECE - piece_z), &gantry_lift_envelope);
+
+        pos_x = (float) p_relocation->to_file;
+        pos_y = (float) p_relocation->to_rank;
+        pos_z = (float) HOME_PIECE;
+    }
+
+    return time;
+}
+
+/**
+ * @brief Compiles a multi-piece move and checks the order the planner picked
+ *
+ * @param p_case The test case
+ * @return Whether every check passed
+ */
+static bool planner_check_order(const planner_case_t* p_case)
+{
+    static const uint8_t permutations[6][MOVEPLANNER_MAX_RELOCATIONS] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+    moveplanner_plan_t plan;
+    motionprogram_t* p_program = motionprogram_alloc();
+    uint8_t chosen[MOVEPLANNER_MAX_RELOCATIONS];
+    uint8_t moves_xy = 0;
+    uint8_t raises_home = 0;
+    float best_time = INFINITY;
+    float chosen_time = 0;
+    float baseline_time = 0;
+    uint8_t i = 0;
+    uint8_t j = 0;
+    bool passed = true;
+
+    planner_set_position(p_case->start_file, p_case->start_rank, HOME_PIECE);
+    moveplanner_init(&plan);
+    for (i = 0; i < p_case->count; i++)
+    {
+        const moveplanner_relocation_t* p_relocation = &p_case->relocations[i];
+        moveplanner_add(&plan, p_relocation->from_file, p_relocation->from_rank, p_relocation->to_file, p_relocation->to_rank, p_relocation->piece);
+    }
+
+    baseline_time = planner_get_baseline_time(&plan);
+
+    // Time every valid ordering (the permutations of fewer relocations are the ones starting with the unused indices last)
+    for (i = 0; i < 6; i++)
+    {
+        bool in_range = true;
+
+        for (j = 0; j < p_case->count; j++)
+        {
+            in_range &= (permutations[i][j] < p_case->count);
+        }
+        if (in_range && moveplanner_order_is_valid(&plan, permutations[i]))
+        {
+            float time = moveplanner_get_plan_time(&plan, permutations[i]);
+            best_time = (time < best_time) ? time : best_time;
+        }
+    }
+
+    // Recover the order from the compiled program (each relocation moves to its source, then to its destination)
+    moveplanner_compile(&plan, p_program);
+    for (i = 0; i < p_program->count; i++)
+    {
+        motionprogram_step_t* p_step = &p_program->steps[i];
+
+        if ((p_step->op == MOTIONPROGRAM_MOVE_XY) && (!(moves_xy & 0x01)))
+        {
+            chosen[moves_xy / 2] = 0xFF;
+            for (j = 0; j < plan.count; j++)
+            {
+                if ((plan.relocations[j].from_file == p_step->arg_0) && (plan.relocations[j].from_rank == p_step->arg_1))
+                {
+                    chosen[moves_xy / 2] = j;
+                }
+            }
+        }
+        moves_xy    += (p_step->op == MOTIONPROGRAM_MOVE_XY);
+        raises_home += ((p_step->op == MOTIONPROGRAM_MOVE_Z) && (p_step->arg_0 == HOME_PIECE));
+    }
+
+    passed &= (moves_xy == 2 * plan.count);
+    passed &= moveplanner_order_is_valid(&plan, chosen);
+    chosen_time = moveplanner_get_plan_time(&plan, chosen);
+    passed &= (fabsf(chosen_time - best_time) <= PLANNER_TIME_TOLERANCE);
+    passed &= (chosen_time <= baseline_time + PLANNER_TIME_TOLERANCE);     // Never slower than the old sequence
+
+    // Every relocation lifts its piece to HOME_PIECE, and only the last one raises back to it once empty
+    passed &= (raises_home == plan.count + 1);
+    passed &= (p_program->steps[p_program->count - 1].op == MOTIONPROGRAM_MOVE_Z) && (p_program->steps[p_program->count - 1].arg_0 == HOME_PIECE);
+
+    printf("  %-40s order", p_case->name);
+    for (i = 0; i < plan.count; i++)
+    {
+        printf(" %u", chosen[i]);
+    }
+    printf(", %.3f s (best valid %.3f s), saves %.3f s (%.1f%%) over the old order's %.3f s%s\n", chosen_time, best_time,
+           baseline_time - chosen_time, 100 * (baseline_time - chosen_time) / baseline_time, baseline_time, passed ? "" : " FAILED");
+
+    motionprogram_free(p_program);
+    return passed;
+}
+
+int main(void)
+{
+    chess_file_t grave_file[2];
+    chess_rank_t grave_rank[2];
+    uint8_t failures = 0;
+    uint8_t i = 0;
+
+    stepper_init_motors();
+    graveyard_reset();
+
+    // Graveyard slots as the gantry would get them (a capture on d5, then a promotion from g7)
+    graveyard_allocate_slot(D, FIFTH, &grave_file[0], &grave_rank[0]);
+    graveyard_allocate_slot(G, SEVENTH, &grave_file[1], &grave_rank[1]);
+
+    {
+        const planner_case_t planner_cases[] = {
+            // Each case lists its relocations in the order gantry_robot_exit() used to run them
+            // Capture: the victim must leave before the mover lands (only one valid order)
+            {"capture e4xd5",                HOME_FILE, HOME_RANK, 2, {{D, FIFTH, grave_file[0], grave_rank[0], PAWN}, {E, FOURTH, D, FIFTH, PAWN}}},
+
+            // Promotion: either order is valid, so the planner picks by distance (from home, and from above the pawn)
+            {"promotion g7g8 from home",     HOME_FILE, HOME_RANK, 2, {{G, SEVENTH, grave_file[1], grave_rank[1], PAWN}, {QUEEN_FILE, QUEEN_RANK, G, EIGHTH, QUEEN}}},
+            {"promotion g7g8 from g7",       G, SEVENTH, 2, {{G, SEVENTH, grave_file[1], grave_rank[1], PAWN}, {QUEEN_FILE, QUEEN_RANK, G, EIGHTH, QUEEN}}},
+
+            // Capture promotion: the victim must leave before the queen lands, the pawn can go at any point
+            {"capture promotion g7xh8",      HOME_FILE, HOME_RANK, 3, {{H, EIGHTH, grave_file[0], grave_rank[0], ROOK}, {G, SEVENTH, grave_file[1], grave_rank[1], PAWN}, {QUEEN_FILE, QUEEN_RANK, H, EIGHTH, QUEEN}}},
+
+            // Castling: the king and rook squares never overlap, so either order is valid
+            {"castling e1g1",                HOME_FILE, HOME_RANK, 2, {{E, FIRST, G, FIRST, KING}, {H, FIRST, F, FIRST, ROOK}}},
+            {"castling e8c8",                HOME_FILE, HOME_RANK, 2, {{E, EIGHTH, C, EIGHTH, KING}, {A, EIGHTH, D, EIGHTH, ROOK}}}
+        };
+
+        failures += !planner_check_move_times();
+        failures += !planner_check_plan_time();
+        for (i = 0; i < sizeof(planner_cases) / sizeof(planner_cases[0]); i++)
+        {
+            failures += !planner_check_order(&planner_cases[i]);
+        }
+    }
+
+    return (failures != 0);
+}
+
+/* End test_moveplanner.c */
@@ -0,0 +1,259 @@
+/**
+ * @file test_scheduler.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Checks that a Pi command runs alongside a stepper command, and still waits for motion queued ahead of it
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+// Note on the scheduler test:
+//  - Alongside: a comm command is queued ahead of a stepper move. The comm command only holds COMMAND_RESOURCE_RPI, so
+//    the move must start while the comm command waits for its ACK, and finish (stepped by calling the X interrupt
+//    handler) before the ACK arrives. The comm command must have queued its message without waiting
+//  - Ordered: the same two commands queued the other way round. The comm command waits for motion (after), so it must
+//    not start, or transmit, until the move is done
+//  - Non-blocking: rpi_transmit() must queue a whole message or nothing, and return straight away when the Tx FIFO is
+//    full
+//  - The host UART never drains (UART_FR_TXFE is never set), so the bytes a command transmits stay in the software Tx
+//    FIFO where they can be counted. The ACK is pushed into the software Rx FIFO of UART_CHANNEL_3 (RPI_UART_CHANNEL),
+//    the way the Rx interrupt would, followed by EVENT_UART_RX
+
+#include "../../src/scheduler.c"
+#include "../../src/uart.c"
+#include "../../src/gantry.h"
+#include <stdio.h>
+
+#define SCHEDULER_TEST_DISTANCE         (50)            // mm, on X
+#define SCHEDULER_TEST_MAX_PASSES       (1000000)
+
+void STEPPER_X_HANDLER(void);
+
+static const stepper_envelope_t scheduler_test_envelope = GANTRY_TRAVEL_ENVELOPE;
+
+/**
+ * @brief Checks if a command of the given type is running
+ *
+ * @param id COMMAND_ID_*
+ * @return Whether a slot holds such a command
+ */
+static bool scheduler_test_is_active(uint8_t id)
+{
+    uint8_t i = 0;
+
+    for (i = 0; i < SCHEDULER_MAX_ACTIVE; i++)
+    {
+        if ((slots[i].p_command != NULL) && (slots[i].p_command->p_ops->id == id))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Counts the bytes waiting in the Pi's software Tx FIFO
+ *
+ * @return Bytes queued for transmission
+ */
+static uint16_t scheduler_test_get_tx_queued(void)
+{
+    return (FIFO8_SIZE - 1) - uart_get_tx_space(RPI_UART_CHANNEL);
+}
+
+/**
+ * @brief Runs scheduler passes, stepping the X axis between them, until the move is done
+ *
+ * @param p_passes_with_comm Where to count the passes on which the comm command was also running
+ * @return Whether the move finished within SCHEDULER_TEST_MAX_PASSES
+ */
+static bool scheduler_test_run_move(uint32_t* p_passes_with_comm)
+{
+    uint32_t passes = 0;
+
+    *p_passes_with_comm = 0;
+    while (scheduler_test_is_active(COMMAND_ID_STEPPER_REL) && (passes++ < SCHEDULER_TEST_MAX_PASSES))
+    {
+        *p_passes_with_comm += scheduler_test_is_active(COMMAND_ID_COMM);
+
+        if (clock_active(STEPPER_X_TIMER))
+        {
+            host_isr_enter();
+            STEPPER_X_HANDLER();
+            host_isr_exit();
+        }
+        scheduler_run();
+    }
+
+    return !scheduler_test_is_active(COMMAND_ID_STEPPER_REL);
+}
+
+/**
+ * @brief Delivers an ACK from the Pi, and runs the scheduler until nothing is left running
+ *
+ * @return Whether every command finished
+ */
+static bool scheduler_test_ack(void)
+{
+    uint8_t i = 0;
+
+    host_isr_enter();
+    fifo8_push(uart_3_rx, ACK_BYTE);
+    event_post(EVENT_UART_RX);
+    host_isr_exit();
+
+    for (i = 0; i < 4; i++)
+    {
+        scheduler_run();
+    }
+
+    return !scheduler_test_is_active(COMMAND_ID_COMM) && !scheduler_test_is_active(COMMAND_ID_STEPPER_REL);
+}
+
+/**
+ * @brief Resets the queue, the pool, the scheduler and the Pi's FIFOs between cases
+ */
+static void scheduler_test_reset(void)
+{
+    command_queue_init();
+    command_pool_init();
+    scheduler_init();
+    uart_reset(RPI_UART_CHANNEL);
+}
+
+/**
+ * @brief Builds a comm command carrying a human move
+ *
+ * @return The command
+ */
+static command_t* scheduler_test_build_comm(void)
+{
+    char message[HUMAN_MOVE_INSTR_LENGTH];
+
+    rpi_build_human_move_msg("e2e4_", message);
+    return (command_t*) gantry_comm_build_command(message, HUMAN_MOVE_INSTR_LENGTH);
+}
+
+/**
+ * @brief Builds a move along X
+ *
+ * @return The command
+ */
+static command_t* scheduler_test_build_move(void)
+{
+    return (command_t*) stepper_build_rel_command(SCHEDULER_TEST_DISTANCE, 0, 0, &scheduler_test_envelope, &scheduler_test_envelope,
+                                                  &scheduler_test_envelope, STEPPER_MOTION_INDEPENDENT);
+}
+
+/**
+ * @brief Queues a comm command ahead of a move, and checks that they run at the same time
+ *
+ * @return Whether the move ran while the comm command waited for its ACK
+ */
+static bool scheduler_test_alongside(void)
+{
+    uint32_t passes_with_comm = 0;
+    uint16_t queued = 0;
+    bool both_started = false;
+    bool passed = true;
+
+    scheduler_test_reset();
+    command_queue_push(scheduler_test_build_comm());
+    command_queue_push(scheduler_test_build_move());
+
+    // One command starts per pass
+    scheduler_run();
+    scheduler_run();
+    both_started = scheduler_test_is_active(COMMAND_ID_COMM) && scheduler_test_is_active(COMMAND_ID_STEPPER_REL);
+    queued = scheduler_test_get_tx_queued();
+
+    passed &= both_started && (queued == HUMAN_MOVE_INSTR_LENGTH);
+    passed &= scheduler_test_run_move(&passes_with_comm);
+    passed &= scheduler_test_is_active(COMMAND_ID_COMM) && (passes_with_comm > 0);
+    passed &= scheduler_test_ack();
+
+    printf("  alongside: both started %s, %u bytes queued, %u passes with both running, %s\n", both_started ? "yes" : "no",
+           (unsigned) queued, (unsigned) passes_with_comm, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+/**
+ * @brief Queues a move ahead of a comm command, and checks that the comm command waits for it
+ *
+ * @return Whether the comm command only started once the move was done
+ */
+static bool scheduler_test_ordered(void)
+{
+    uint32_t passes_with_comm = 0;
+    uint16_t queued_during = 0;
+    bool passed = true;
+
+    scheduler_test_reset();
+    command_queue_push(scheduler_test_build_move());
+    command_queue_push(scheduler_test_build_comm());
+
+    scheduler_run();
+    scheduler_run();
+    passed &= scheduler_test_run_move(&passes_with_comm);
+    queued_during = scheduler_test_get_tx_queued();
+    passed &= (passes_with_comm == 0) && (queued_during == 0);
+
+    // The comm command starts once the move is done
+    scheduler_run();
+    passed &= scheduler_test_is_active(COMMAND_ID_COMM) && (scheduler_test_get_tx_queued() == HUMAN_MOVE_INSTR_LENGTH);
+    passed &= scheduler_test_ack();
+
+    printf("  ordered: %u passes with both running, %u bytes queued during the move, %s\n", (unsigned) passes_with_comm,
+           (unsigned) queued_during, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+/**
+ * @brief Fills the Tx FIFO, and checks that a transmit neither waits nor queues part of its message
+ *
+ * @return Whether a message which does not fit is refused whole, and one which fits is queued whole
+ */
+static bool scheduler_test_transmit(void)
+{
+    char message[HUMAN_MOVE_INSTR_LENGTH] = {START_BYTE, HUMAN_MOVE_INSTR_AND_LEN, 'e', '2', 'e', '4', '_', 0, 0};
+    uint16_t space_before = 0;
+    bool refused = false;
+    bool accepted = false;
+
+    scheduler_test_reset();
+    while (uart_get_tx_space(RPI_UART_CHANNEL) >= HUMAN_MOVE_INSTR_LENGTH)
+    {
+        uart_out_byte(RPI_UART_CHANNEL, 0);
+    }
+    space_before = uart_get_tx_space(RPI_UART_CHANNEL);
+    refused = !rpi_transmit_binary(message, HUMAN_MOVE_INSTR_LENGTH) && (uart_get_tx_space(RPI_UART_CHANNEL) == space_before);
+
+    uart_reset(RPI_UART_CHANNEL);
+    accepted = rpi_transmit_binary(message, HUMAN_MOVE_INSTR_LENGTH) && (scheduler_test_get_tx_queued() == HUMAN_MOVE_INSTR_LENGTH);
+
+    printf("  transmit: refused when full %s, queued when empty %s\n", refused ? "yes" : "no", accepted ? "yes" : "no");
+    return refused && accepted;
+}
+
+int main(void)
+{
+    command_pool_stats_t stats;
+    uint8_t failures = 0;
+
+    led_init();
+    rpi_init();
+    stepper_init_motors();
+
+    failures += !scheduler_test_alongside();
+    failures += !scheduler_test_ordered();
+    failures += !scheduler_test_transmit();
+
+    command_pool_get_stats(&stats);
+    failures += (stats.in_use != 0);
+
+    return (failures != 0);
+}
+
+/* End test_scheduler.c */
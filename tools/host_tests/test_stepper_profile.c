@@ -0,0 +1,315 @@
+/**
+ * @file test_stepper_profile.c
+ * @author Eli Jelesko (ebj5hec@virginia.edu)
+ * @brief Checks the stepper period factor and the step intervals it produces against the ideal trapezoid
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+// Note on the stepper profile test:
+//  - Each case plans a move on one axis exactly as stepper_update_velocities() does, then runs the step interrupt until
+//    the move is done. The timer runs with TIMER_TAMR_TAILD, so the period queued by one interrupt times the interval
+//    after the next time-out, and the simulation follows the same rule
+//  - The speeds are checked against the geometric ramp the period factor describes: the period shrinks by the same
+//    fraction every transition, so a full ramp ends at v_cruise and a ramp cut short at the midpoint ends at
+//    [v_start*(v_cruise/v_start)^(ramp/N)]. The ramp down ends back at v_start
+//  - The edge times are checked against a reference copy of the baseline stepper_get_period_shift() recurrence, run
+//    alongside the interrupt in doubles: on every transition the shift is worked out from the current period, the way
+//    the baseline ISR did, with nothing precomputed and nothing truncated. Only the fraction of the period differs from
+//    the baseline's trial-and-error [80*a/(9*f)] term: it is the envelope's [1 - (v_start/v_cruise)^(1/N)], worked out
+//    here independently of stepper_get_period_factor(), and ramped in and out over the jerk transitions for an s-curve.
+//    The timer counts whole cycles, so each reference interval is the whole part of the reference period. The interval
+//    bound is a few ticks (the period is whole cycles and the fixed-point factor is truncated), and the edge time bound
+//    is what a fraction of a cycle per transition adds up to over a long cruise
+//  - The edge times are also compared against the ideal trapezoid of the same envelope (constant acceleration from
+//    v_start to v_cruise, or to the midpoint if the move is too short). A geometric ramp spends longer at low speed
+//    than a constant acceleration, so that comparison only bounds how far the shape is from the ideal (up to ~8% slow)
+//  - Tolerances:
+//      - Reference interval: PROFILE_INTERVAL_TOLERANCE, in timer cycles, against the reference recurrence
+//      - Reference edge:     PROFILE_REFERENCE_TOLERANCE, of the ideal move time, against the reference recurrence
+//      - Peak speed:         PROFILE_PEAK_TOLERANCE, of the geometric ramp's peak
+//      - Final speed:        PROFILE_FINAL_TOLERANCE, of v_start
+//      - Move time:          PROFILE_TIME_TOLERANCE, of the ideal move time
+//      - Worst edge time:    PROFILE_EDGE_TOLERANCE, of the ideal move time
+
+#include "../../src/steppermotors.c"
+#include "../../src/gantry.h"
+#include <stdio.h>
+
+// Recorded tolerances
+#define PROFILE_FACTOR_TOLERANCE        (1e-6)      // Relative error of (1 - factor)^N against v_start/v_cruise
+#define PROFILE_INTERVAL_TOLERANCE      (4)         // Timer cycles
+#define PROFILE_REFERENCE_TOLERANCE     (2.5e-4)
+#define PROFILE_PEAK_TOLERANCE          (0.01)
+#define PROFILE_FINAL_TOLERANCE         (0.01)
+#define PROFILE_TIME_TOLERANCE          (0.10)
+#define PROFILE_EDGE_TOLERANCE          (0.10)
+
+// Test case
+typedef struct {
+    const char* name;
+    uint8_t motor_id;
+    int16_t distance;                                   // mm
+    stepper_envelope_t envelope;
+    stepper_profile_t profile;
+} profile_case_t;
+
+static const profile_case_t profile_cases[] = {
+    {"x travel, trapezoid",         STEPPER_X_ID, 300, GANTRY_TRAVEL_ENVELOPE, STEPPER_PROFILE_TRAPEZOID},
+    {"x travel, s-curve",           STEPPER_X_ID, 300, GANTRY_TRAVEL_ENVELOPE, STEPPER_PROFILE_S_CURVE},
+    {"y carry, s-curve",            STEPPER_Y_ID, 144, GANTRY_CARRY_ENVELOPE,  STEPPER_PROFILE_S_CURVE},
+    {"y carry short, trapezoid",    STEPPER_Y_ID, 20,  GANTRY_CARRY_ENVELOPE,  STEPPER_PROFILE_TRAPEZOID},
+    {"y carry short, s-curve",      STEPPER_Y_ID, 20,  GANTRY_CARRY_ENVELOPE,  STEPPER_PROFILE_S_CURVE},
+    {"z lift, trapezoid",           STEPPER_Z_ID, 60,  GANTRY_LIFT_ENVELOPE,   STEPPER_PROFILE_TRAPEZOID},
+    {"z lower, trapezoid",          STEPPER_Z_ID, -60, GANTRY_LOWER_ENVELOPE,  STEPPER_PROFILE_TRAPEZOID}
+};
+
+/**
+ * @brief Finds when the ideal trapezoid reaches a position
+ *
+ * @param s The position (transitions)
+ * @param total The length of the move (transitions)
+ * @param v_start The start speed (transitions/s)
+ * @param v_cruise The cruise speed (transitions/s)
+ * @param accel The acceleration (transitions/s/s)
+ * @return The time (s)
+ */
+static double profile_ideal_time(double s, double total, double v_start, double v_cruise, double accel)
+{
+    double ramp   = (v_cruise*v_cruise - v_start*v_start) / (2 * accel);
+    double v_peak = v_cruise;
+    double t_ramp = 0;
+
+    // Triangular profile
+    if (2 * ramp > total)
+    {
+        ramp   = total / 2;
+        v_peak = sqrt(v_start*v_start + 2*accel*ramp);
+    }
+    t_ramp = (v_peak - v_start) / accel;
+
+    if (s <= ramp)
+    {
+        return (sqrt(v_start*v_start + 2*accel*s) - v_start) / accel;
+    }
+    if (s <= total - ramp)
+    {
+        return t_ramp + (s - ramp) / v_peak;
+    }
+    return 2*t_ramp + (total - 2*ramp) / v_peak - (sqrt(v_start*v_start + 2*accel*(total - s)) - v_start) / accel;
+}
+
+/**
+ * @brief Reference copy of the baseline stepper_get_period_shift(), in full precision
+ *
+ * @param period The current period (cycles)
+ * @param fraction The fraction of the period changed per transition at full acceleration
+ * @param ramp_index How many transitions into the ramp this is
+ * @param ramp_length The total number of transitions in the ramp
+ * @param jerk_transitions The transitions at each end of the ramp spent changing the acceleration (0 for a trapezoid)
+ * @return How much the period needs to change on this transition (cycles)
+ */
+static double profile_reference_shift(double period, double fraction, uint32_t ramp_index, uint32_t ramp_length, uint32_t jerk_transitions)
+{
+    // Ramp the acceleration up at the start of the ramp and back down at its end
+    if (ramp_index < jerk_transitions)
+    {
+        fraction = fraction * (ramp_index + 1) / jerk_transitions;
+    }
+    else if (ramp_index + jerk_transitions >= ramp_length)
+    {
+        fraction = fraction * (ramp_length - ramp_index) / jerk_transitions;
+    }
+
+    return period * fraction;
+}
+
+/**
+ * @brief Checks that the period factor shrinks the period from v_start to v_cruise over the ramp
+ *
+ * @param p_case The test case
+ * @return Whether the check passed
+ */
+static bool profile_check_factor(const profile_case_t* p_case)
+{
+    stepper_motors_t* p_stepper_motor = &stepper_motors[p_case->motor_id];
+    bool z_axis = (p_case->motor_id == STEPPER_Z_ID);
+    stepper_envelope_t envelope;
+    uint32_t ramp_transitions;
+    double factor, ratio, error;
+
+    stepper_bound_envelope(&envelope, &p_case->envelope, z_axis ? STEPPER_Z_MAX_V : STEPPER_X_MAX_V, z_axis ? STEPPER_Z_MAX_A : STEPPER_X_MAX_A, z_axis);
+    ramp_transitions = stepper_get_ramp_transitions(p_stepper_motor, &envelope);
+    factor = ldexp(stepper_get_period_factor(&envelope, ramp_transitions), -STEPPER_PERIOD_FACTOR_BITS);
+    ratio  = pow(1 - factor, ramp_transitions);
+    error  = fabs(ratio / ((double) envelope.v_start / envelope.v_cruise) - 1);
+
+    if (error > PROFILE_FACTOR_TOLERANCE)
+    {
+        printf("  %-28s factor: (1 - f)^%u = %.6f, expected %.6f\n", p_case->name, (unsigned) ramp_transitions, ratio, (double) envelope.v_start / envelope.v_cruise);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs a move through the step interrupt and compares it against the ideal trapezoid
+ *
+ * @param p_case The test case
+ * @return Whether every check passed
+ */
+static bool profile_check_move(const profile_case_t* p_case)
+{
+    stepper_motors_t* p_stepper_motor = &stepper_motors[p_case->motor_id];
+    bool z_axis = (p_case->motor_id == STEPPER_Z_ID);
+    double transitions_per_mm = stepper_get_transitions_per_mm(p_stepper_motor);
+    stepper_envelope_t envelope;
+    uint32_t total = stepper_distance_to_transitions(p_case->distance, z_axis);
+    uint32_t ramp_transitions = 0;
+    uint32_t interval = 0;
+    uint32_t min_interval = UINT32_MAX;
+    uint32_t last_interval = 0;
+    uint64_t cycles = 0;
+    uint32_t jerk_transitions = 0;
+    double reference_period, reference_interval, reference_cycles, reference_fraction = 0;
+    double reference_error = 0;
+    double interval_error = 0;
+    double v_start, v_cruise, accel, v_peak;
+    double t_ideal, t_move, edge_error = 0;
+    double time_error, peak_error, final_error;
+    bool passed = true;
+
+    // Plan and start the move the way stepper_update_velocities() does
+    stepper_bound_envelope(&envelope, &p_case->envelope, z_axis ? STEPPER_Z_MAX_V : STEPPER_X_MAX_V, z_axis ? STEPPER_Z_MAX_A : STEPPER_X_MAX_A, z_axis);
+    p_stepper_motor->profile                    = p_case->profile;
+    p_stepper_motor->transitions_to_desired_pos = total;
+    p_stepper_motor->transitions_total          = total;
+    p_stepper_motor->coordinated_mask           = 0;
+    stepper_plan_ramp(p_stepper_motor, &envelope);
+    stepper_start_motor(p_stepper_motor, &envelope);
+    ramp_transitions = stepper_get_ramp_transitions(p_stepper_motor, &envelope);
+
+    v_start  = envelope.v_start * transitions_per_mm;
+    v_cruise = envelope.v_cruise * transitions_per_mm;
+    accel    = envelope.accel * transitions_per_mm;
+
+    // The reference starts from the same period, with its own fraction (raised for an s-curve the way the ramp is shaped)
+    if (ramp_transitions > 0)
+    {
+        reference_fraction = 1 - pow((double) envelope.v_start / envelope.v_cruise, 1.0 / ramp_transitions);
+    }
+    if (p_case->profile == STEPPER_PROFILE_S_CURVE)
+    {
+        jerk_transitions = p_stepper_motor->x_2 / STEPPER_S_CURVE_JERK_DIVISOR;
+    }
+    if (jerk_transitions > 0)
+    {
+        reference_fraction = reference_fraction * p_stepper_motor->x_2 / (p_stepper_motor->x_2 - jerk_transitions);
+    }
+    reference_period   = p_stepper_motor->timer->TAILR;
+    reference_interval = reference_period + 1;
+
+    // The first interval is the one loaded at the start, then each time-out loads what the previous interrupt queued
+    cycles = p_stepper_motor->timer->TAILR + 1;
+    reference_cycles = cycles;
+    while (p_stepper_motor->transitions_to_desired_pos > 0)
+    {
+        uint32_t left = p_stepper_motor->transitions_to_desired_pos - 1;
+        double t_edge;
+
+        interval = p_stepper_motor->timer->TAILR + 1;
+        stepper_interrupt_activity(p_stepper_motor);
+
+        // Step the reference recurrence on the same transition (its period is queued behind the interval already loaded)
+        if (fabs(cycles - reference_cycles) > reference_error)
+        {
+            reference_error = fabs(cycles - reference_cycles);
+        }
+        if (left > p_stepper_motor->x_1)
+        {
+            reference_period -= profile_reference_shift(reference_period, reference_fraction, total - left - 1, total - p_stepper_motor->x_1, jerk_transitions);
+            reference_period  = fmax(reference_period, p_stepper_motor->min_period);
+        }
+        else if (left < p_stepper_motor->x_2)
+        {
+            reference_period += profile_reference_shift(reference_period, reference_fraction, p_stepper_motor->x_2 - left - 1, p_stepper_motor->x_2, jerk_transitions);
+        }
+        if (fabs(interval - reference_interval) > interval_error)
+        {
+            interval_error = fabs(interval - reference_interval);
+        }
+        reference_cycles  += reference_interval;
+        reference_interval = floor(reference_period) + 1;
+
+        // This edge completes transition (total - left)
+        t_edge  = (double) cycles / SYSCLOCK_FREQUENCY;
+        t_ideal = profile_ideal_time(total - p_stepper_motor->transitions_to_desired_pos, total, v_start, v_cruise, accel);
+        if (fabs(t_edge - t_ideal) > edge_error)
+        {
+            edge_error = fabs(t_edge - t_ideal);
+        }
+
+        // Intervals between edges
+        if (p_stepper_motor->transitions_to_desired_pos > 0)
+        {
+            if (interval < min_interval)
+            {
+                min_interval = interval;
+            }
+            last_interval = interval;
+            cycles += interval;
+        }
+    }
+    stepper_interrupt_activity(p_stepper_motor);
+
+    // Compare against the ideal trapezoid (which starts moving at v_start, one interval before the first edge)
+    t_move  = (double) cycles / SYSCLOCK_FREQUENCY;
+    t_ideal = profile_ideal_time(total, total, v_start, v_cruise, accel);
+    v_peak  = (ramp_transitions == 0) ? v_cruise : v_start * pow(v_cruise / v_start, (double) p_stepper_motor->x_2 / ramp_transitions);
+
+    time_error  = fabs(t_move - t_ideal) / t_ideal;
+    edge_error  = edge_error / t_ideal;
+    reference_error = reference_error / (t_ideal * SYSCLOCK_FREQUENCY);
+    peak_error  = ((double) SYSCLOCK_FREQUENCY / min_interval) / v_peak - 1;
+    final_error = fabs(((double) SYSCLOCK_FREQUENCY / last_interval) / v_start - 1);
+
+    printf("  %-28s time %.4f s (ideal %.4f s, %+.2f%%), worst edge %.2f%%, peak %+.2f%%, final %.2f%%\n", p_case->name, t_move,
+           t_ideal, 100 * (t_move - t_ideal) / t_ideal, 100 * edge_error, 100 * peak_error, 100 * final_error);
+    printf("  %-28s reference: worst interval %.0f cycles, worst edge %.4f%%\n", "", interval_error, 100 * reference_error);
+
+    passed &= (interval_error <= PROFILE_INTERVAL_TOLERANCE);
+    passed &= (reference_error <= PROFILE_REFERENCE_TOLERANCE);
+    passed &= (time_error <= PROFILE_TIME_TOLERANCE);
+    passed &= (edge_error <= PROFILE_EDGE_TOLERANCE);
+    passed &= (fabs(peak_error) <= PROFILE_PEAK_TOLERANCE);
+    passed &= (final_error <= PROFILE_FINAL_TOLERANCE);
+    passed &= (p_stepper_motor->current_state == disabled) && (!clock_active(p_stepper_motor->timer));
+
+    return passed;
+}
+
+int main(void)
+{
+    uint8_t i = 0;
+    uint8_t failures = 0;
+
+    stepper_init_motors();
+
+    for (i = 0; i < sizeof(profile_cases) / sizeof(profile_cases[0]); i++)
+    {
+        bool passed = profile_check_factor(&profile_cases[i]);
+
+        passed &= profile_check_move(&profile_cases[i]);
+        if (!passed)
+        {
+            printf("  %-28s FAILED\n", profile_cases[i].name);
+            failures++;
+        }
+    }
+
+    return (failures != 0);
+}
+
+/* End test_stepper_profile.c */
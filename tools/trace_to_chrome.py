@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""
+@file trace_to_chrome.py
+@author Eli Jelesko (ebj5hec@virginia.edu)
+@brief Converts a trace dump from the MSP432 (see src/trace.h) into Chrome trace / Perfetto JSON
+@version 0.1
+@date 2026-10-16
+
+@copyright Copyright (c) 2022
+
+Usage:
+    Request a dump over the Pi UART and convert it:
+        python3 trace_to_chrome.py --port /dev/serial0 -o turn.json
+    Convert a dump captured earlier (raw bytes, as sent by the MSP432):
+        python3 trace_to_chrome.py --input dump.bin -o turn.json
+
+Open the output in chrome://tracing or https://ui.perfetto.dev. Commands appear under "Commands" (one row per
+scheduler slot), and traced interrupts under "Interrupts".
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+# Frame format (see src/raspberrypi.h)
+START_BYTE = 0x0A
+ACK_BYTE = 0x0F
+TRACE_INSTR_AND_LEN = 0x60
+TRACE_RECORD_INSTR_AND_LEN = 0x68
+RECORD_SIZE = 8
+
+SYSCLOCK_FREQUENCY = 120000000
+
+# Must match command_id_t (src/command_queue.h)
+COMMAND_NAMES = {
+    0: "none",
+    1: "delay",
+    2: "electromagnet",
+    3: "stepper_rel",
+    4: "stepper_chess",
+    5: "stepper_home",
+    6: "start_state",
+    7: "reset",
+    8: "human (scan)",
+    9: "comm",
+    10: "robot (engine wait)",
+    11: "home",
+    12: "motionprogram (motion)",
+    13: "metrics",
+}
+
+# Must match TRACE_ISR_* (src/trace.h)
+ISR_UART = 5
+ISR_NAMES = {
+    0: "STEPPER_X",
+    1: "STEPPER_Y",
+    2: "STEPPER_Z",
+    3: "SWITCH",
+    4: "GANTRY",
+    5: "UART",
+    6: "DELAY",
+    7: "LED",
+    8: "COMM",
+    9: "SCAN",
+}
+
+# Must match trace_event_t (src/trace.h)
+EVENT_COMMAND_ENTRY = 0
+EVENT_COMMAND_DONE = 1
+EVENT_COMMAND_EXIT = 2
+EVENT_COMMAND_ABORT = 3
+EVENT_ISR_ENTER = 4
+EVENT_ISR_EXIT = 5
+
+PID_COMMANDS = 1
+PID_INTERRUPTS = 2
+
+
+def fl16_check_bytes(data):
+    """Fletcher-16 check bytes, as computed by utils_fl16_data_to_checkbytes()"""
+    sum1 = 0
+    sum2 = 0
+    for byte in data:
+        sum1 += byte
+        if sum1 > 255:
+            sum1 -= 255
+        sum2 += sum1
+        if sum2 > 255:
+            sum2 -= 255
+    c0 = 0xFF - ((sum1 + sum2) % 0xFF)
+    c1 = 0xFF - ((sum1 + c0) % 0xFF)
+    return bytes([c0, c1])
+
+
+def parse_frames(data):
+    """Yields each valid record in a dump, skipping corrupt frames. Stops at the end frame"""
+    i = 0
+    while i + 4 <= len(data):
+        if data[i] != START_BYTE:
+            i += 1
+            continue
+
+        instr_and_len = data[i + 1]
+        length = instr_and_len & 0x0F
+        frame = data[i:i + 2 + length + 2]
+        if (len(frame) < 4 + length) or (fl16_check_bytes(frame[:2 + length]) != frame[2 + length:]):
+            i += 1
+            continue
+
+        if instr_and_len == TRACE_INSTR_AND_LEN:
+            return
+        if instr_and_len == TRACE_RECORD_INSTR_AND_LEN:
+            yield struct.unpack("<IBBBB", frame[2:2 + RECORD_SIZE])
+        i += len(frame)
+
+
+def read_port(port, baud):
+    """Requests a dump over the Pi UART, and reads it up to the end frame"""
+    import serial
+
+    request = bytes([START_BYTE, TRACE_INSTR_AND_LEN])
+    request += fl16_check_bytes(request)
+    end = request
+
+    with serial.Serial(port, baud, timeout=30) as uart:
+        uart.reset_input_buffer()
+        uart.write(request)
+        data = uart.read_until(end)
+
+    # Drop the ACK
+    if data[:1] == bytes([ACK_BYTE]):
+        data = data[1:]
+    return data
+
+
+def to_chrome(records):
+    """Converts records to Chrome trace events (timestamps in microseconds from the first record)"""
+    events = [
+        {"ph": "M", "pid": PID_COMMANDS, "name": "process_name", "args": {"name": "Commands"}},
+        {"ph": "M", "pid": PID_INTERRUPTS, "name": "process_name", "args": {"name": "Interrupts"}},
+    ]
+    start = None
+    last_timestamp = 0
+    epoch = 0
+
+    for cycles, wraps, event, ident, arg in records:
+        # 40-bit timestamps, unwrapped in case the wrap count itself wrapped
+        timestamp = (wraps << 32) | cycles
+        timestamp += epoch
+        if timestamp < last_timestamp:
+            epoch += 1 << 40
+            timestamp += 1 << 40
+        last_timestamp = timestamp
+        if start is None:
+            start = timestamp
+        ts = (timestamp - start) * 1e6 / SYSCLOCK_FREQUENCY
+
+        if event in (EVENT_COMMAND_ENTRY, EVENT_COMMAND_EXIT, EVENT_COMMAND_ABORT, EVENT_COMMAND_DONE):
+            name = COMMAND_NAMES.get(ident, "command %d" % ident)
+            base = {"pid": PID_COMMANDS, "tid": arg, "ts": ts, "name": name}
+            if event == EVENT_COMMAND_ENTRY:
+                events.append(dict(base, ph="B"))
+            elif event == EVENT_COMMAND_DONE:
+                events.append(dict(base, ph="i", s="t", name=name + " done"))
+            else:
+                events.append(dict(base, ph="E", args={"aborted": event == EVENT_COMMAND_ABORT}))
+        elif event in (EVENT_ISR_ENTER, EVENT_ISR_EXIT):
+            name = ISR_NAMES.get(ident, "isr %d" % ident)
+            if ident == ISR_UART:
+                name += str(arg)
+            events.append({"pid": PID_INTERRUPTS, "tid": name, "ts": ts, "name": name,
+                           "ph": "B" if event == EVENT_ISR_ENTER else "E"})
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port connected to the MSP432 (requires pyserial)")
+    source.add_argument("--input", help="file holding a raw dump")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("-o", "--output", default="-", help="JSON file to write (default: stdout)")
+    args = parser.parse_args()
+
+    if args.port:
+        data = read_port(args.port, args.baud)
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+
+    trace = to_chrome(parse_frames(data))
+
+    if args.output == "-":
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+
+
+if __name__ == "__main__":
+    main()